@@ -180,7 +180,7 @@ void Backlight::processKext(KernelPatcher &patcher, size_t id, mach_vm_address_t
         if (patcher.routeMultiple(kextBacklight.loadIndex, &request, 1, slide, size)) {
             static const UInt8 find[] = "F%uT%04x";
             static const UInt8 replace[] = "F%uTxxxx";
-            const LookupPatchPlus patch {&kextBacklight, find, replace, 1};
+            const LookupPatchPlus patch {&kextBacklight, PatcherPlus::Section::Data, find, replace, 1};
             SYSLOG_COND(!patch.apply(patcher, slide, size), "Backlight", "Failed to apply backlight patch");
         }
         patcher.clearError();
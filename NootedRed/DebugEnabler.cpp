@@ -146,7 +146,7 @@ void DebugEnabler::processX6000FB(KernelPatcher &patcher, size_t id, mach_vm_add
     // Enable all DalDmLogger logs
     // TODO: Maybe replace this with some simpler patches?
     auto *logEnableMaskMinors =
-        patcher.solveSymbol<void *>(id, "__ZN14AmdDalDmLogger19LogEnableMaskMinorsE", slide, size);
+        PatcherPlus::solveSymbol<void *>(patcher, id, "__ZN14AmdDalDmLogger19LogEnableMaskMinorsE", slide, size);
     patcher.clearError();
     if (logEnableMaskMinors == nullptr) {
         size_t offset = 0;
@@ -158,10 +158,7 @@ void DebugEnabler::processX6000FB(KernelPatcher &patcher, size_t id, mach_vm_add
         // inst + instSize + imm32 = addr
         logEnableMaskMinors = instAddr + 7 + *reinterpret_cast<SInt32 *>(instAddr + 3);
     }
-    PANIC_COND(MachInfo::setKernelWriting(true, KernelPatcher::kernelWriteLock) != KERN_SUCCESS, "DebugEnabler",
-        "Failed to enable kernel writing");
-    memset(logEnableMaskMinors, 0xFF, 0x80);
-    MachInfo::setKernelWriting(false, KernelPatcher::kernelWriteLock);
+    KernelWriteTransaction::singleton().fill(logEnableMaskMinors, 0xFF, 0x80);
 
     // Enable all Display Core logs
     if (NRed::singleton().getAttributes().isCatalina()) {
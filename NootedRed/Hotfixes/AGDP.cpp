@@ -56,7 +56,8 @@ void Hotfixes::AGDP::init() {
 void Hotfixes::AGDP::processKext(KernelPatcher &patcher, size_t id, mach_vm_address_t slide, size_t size) {
     if (kextAGDP.loadIndex != id) { return; }
 
-    const LookupPatchPlus boardIdPatch {&kextAGDP, kAGDPBoardIDKeyOriginal, kAGDPBoardIDKeyPatched, 1};
+    const LookupPatchPlus boardIdPatch {&kextAGDP, PatcherPlus::Section::Data, kAGDPBoardIDKeyOriginal,
+        kAGDPBoardIDKeyPatched, 1};
     SYSLOG_COND(!boardIdPatch.apply(patcher, slide, size), "AGDP", "Failed to apply AGDP board-id patch");
 
     if (NRed::singleton().getAttributes().isVentura()) {
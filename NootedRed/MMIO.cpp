@@ -0,0 +1,105 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+#include <Headers/kern_util.hpp>
+#include <IOKit/IOLib.h>
+#include <PrivateHeaders/MMIO.hpp>
+#include <PrivateHeaders/MMIOAccess.hpp>
+#include <PrivateHeaders/iVega/Regs/NBIO.hpp>
+#include <kern/clock.h>
+
+void MMIO::init() {
+    PE_parse_boot_argn("NRedSMUSpin", &this->spinUsec, sizeof(this->spinUsec));
+    PE_parse_boot_argn("NRedSMUBackoff", &this->maxBackoffUsec, sizeof(this->maxBackoffUsec));
+    PE_parse_boot_argn("NRedSMUTimeout", &this->timeoutUsec, sizeof(this->timeoutUsec));
+    if (this->maxBackoffUsec == 0) { this->maxBackoffUsec = 1; }
+
+    this->indirectLock = IOSimpleLockAlloc();
+    PANIC_COND(this->indirectLock == nullptr, "MMIO", "Failed to allocate the indirect register lock");
+}
+
+void MMIO::map(volatile UInt32 *base, UInt32 regs) {
+    this->base = base;
+    this->regs = regs;
+}
+
+UInt32 MMIO::readReg32(UInt32 reg) const {
+    if (reg < this->regs) { return mmioRead32(this->base, reg); }
+
+    auto state = IOSimpleLockLockDisableInterrupt(this->indirectLock);
+    mmioWrite32(this->base, mmPCIE_INDEX2, reg);
+    auto ret = mmioRead32(this->base, mmPCIE_DATA2);
+    IOSimpleLockUnlockEnableInterrupt(this->indirectLock, state);
+    return ret;
+}
+
+void MMIO::writeReg32(UInt32 reg, UInt32 val) const {
+    if (reg < this->regs) {
+        mmioWrite32(this->base, reg, val);
+        return;
+    }
+
+    auto state = IOSimpleLockLockDisableInterrupt(this->indirectLock);
+    mmioWrite32(this->base, mmPCIE_INDEX2, reg);
+    mmioWrite32(this->base, mmPCIE_DATA2, val);
+    IOSimpleLockUnlockEnableInterrupt(this->indirectLock, state);
+}
+
+void MMIO::modifyRegs32(const RegRMW *ops, size_t count) const {
+    IOInterruptState state {};
+    bool locked = false, indexed = false;
+    UInt32 index = 0;
+    for (size_t i = 0; i < count; i++) {
+        const auto &op = ops[i];
+        auto slot = op.reg;
+        if (op.reg >= this->regs) {
+            if (!locked) {
+                state = IOSimpleLockLockDisableInterrupt(this->indirectLock);
+                locked = true;
+                indexed = false;
+            }
+            if (!indexed || index != op.reg) {
+                mmioWrite32(this->base, mmPCIE_INDEX2, op.reg);
+                indexed = true;
+                index = op.reg;
+            }
+            slot = mmPCIE_DATA2;
+        } else if (locked) {
+            IOSimpleLockUnlockEnableInterrupt(this->indirectLock, state);
+            locked = false;
+        }
+        mmioWrite32(this->base, slot,
+            op.mask == 0xFFFFFFFF ? op.value : ((mmioRead32(this->base, slot) & ~op.mask) | (op.value & op.mask)));
+    }
+    if (locked) { IOSimpleLockUnlockEnableInterrupt(this->indirectLock, state); }
+}
+
+UInt32 MMIO::waitForReg32(UInt32 reg, UInt32 mask, UInt32 timeoutUsec) const {
+    const auto start = mach_absolute_time();
+    UInt64 spinEnd, deadline;
+    nanoseconds_to_absolutetime(static_cast<UInt64>(this->spinUsec) * NSEC_PER_USEC, &spinEnd);
+    nanoseconds_to_absolutetime(static_cast<UInt64>(timeoutUsec ? timeoutUsec : this->timeoutUsec) * NSEC_PER_USEC,
+        &deadline);
+    spinEnd += start;
+    deadline += start;
+
+    UInt32 backoff = 1;
+    while (true) {
+        const auto value = this->readReg32(reg);
+        if ((value & mask) != 0) { return value; }
+
+        const auto now = mach_absolute_time();
+        if (now >= deadline) { return value; }
+        if (now < spinEnd) {
+            IODelay(1);
+            continue;
+        }
+
+        backoff = backoff < this->maxBackoffUsec / 2 ? backoff * 2 : this->maxBackoffUsec;
+        if (backoff >= 1000) {
+            IOSleep(backoff / 1000);
+        } else {
+            IODelay(backoff);
+        }
+    }
+}
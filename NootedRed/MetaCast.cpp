@@ -0,0 +1,110 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+#include <Headers/kern_util.hpp>
+#include <PrivateHeaders/MetaCast.hpp>
+#include <PrivateHeaders/NRed.hpp>
+#include <kern/clock.h>
+
+//------ Module Logic ------//
+
+static MetaCast instance {};
+
+MetaCast &MetaCast::singleton() { return instance; }
+
+void MetaCast::init() {
+    PANIC_COND(this->initialised, "MetaCast", "Attempted to initialise module twice!");
+    this->initialised = true;
+
+    this->publishCall = thread_call_allocate(publishCounters, this);
+    PANIC_COND(this->publishCall == nullptr, "MetaCast", "Failed to allocate the counter publishing call");
+}
+
+// Only remaps between classes that both have been solved, so nothing is published until X5000 and X6000 are loaded.
+void MetaCast::rebuildFilter() {
+    const OSMetaClass *from[arrsize(this->classMap) * 2], *to[arrsize(this->classMap) * 2];
+    size_t count = 0;
+    for (const auto &ent : this->classMap) {
+        if (ent[0] == nullptr || ent[1] == nullptr) { continue; }
+        from[count] = ent[0];
+        to[count++] = ent[1];
+        from[count] = ent[1];
+        to[count++] = ent[0];
+    }
+    if (count == 0) { return; }
+
+    PANIC_COND(this->filterCount == arrsize(this->filters), "MetaCast", "Too many filter rebuilds");
+    auto *filter = &this->filters[this->filterCount++];
+    constexpr UInt32 maxShift = sizeof(uintptr_t) * 8 - __builtin_ctzl(Filter::Size);
+    bool collided = true;
+    for (UInt32 shift = 3; collided && shift <= maxShift; shift += 1) {
+        filter->shift = shift;
+        bzero(filter->entries, sizeof(filter->entries));
+        collided = false;
+        for (size_t i = 0; i < count && !collided; i += 1) {
+            auto &entry = filter->entries[filter->slot(from[i])];
+            collided = entry.from != nullptr;
+            entry.from = from[i];
+            entry.to = to[i];
+        }
+    }
+    PANIC_COND(collided, "MetaCast", "No collision-free layout for the filter");
+
+    __atomic_store_n(&this->filter, filter, __ATOMIC_RELEASE);
+    DBGLOG("MetaCast", "Filter holds %zu classes, shift %u", count, filter->shift);
+    this->publish();
+}
+
+void MetaCast::count(UInt64 &counter) {
+    __atomic_fetch_add(&counter, 1, __ATOMIC_RELAXED);
+
+    // The casts of a burst are published together. Loaded first, so the flag is only written once per burst.
+    if (__atomic_load_n(&this->publishScheduled, __ATOMIC_RELAXED) ||
+        __atomic_exchange_n(&this->publishScheduled, true, __ATOMIC_RELAXED)) {
+        return;
+    }
+    UInt64 delay;
+    nanoseconds_to_absolutetime(static_cast<UInt64>(PublishDelaySecs) * NSEC_PER_SEC, &delay);
+    thread_call_enter_delayed(this->publishCall, mach_absolute_time() + delay);
+}
+
+void MetaCast::publishCounters(thread_call_param_t param0, thread_call_param_t) {
+    static_cast<MetaCast *>(param0)->publish();
+}
+
+static void publishCounter(const char *key, UInt64 value) {
+    auto *number = OSNumber::withNumber(value, 64);
+    if (number == nullptr) { return; }
+    NRed::singleton().setProp(key, number);
+    number->release();
+}
+
+// Cleared before the counters are read, so a cast counted meanwhile schedules another publish.
+void MetaCast::publish() {
+    __atomic_store_n(&this->publishScheduled, false, __ATOMIC_RELAXED);
+    publishCounter("NRed,MetaCastRemaps", __atomic_load_n(&this->hits, __ATOMIC_RELAXED));
+#ifdef DEBUG
+    publishCounter("NRed,MetaCastMisses", __atomic_load_n(&this->misses, __ATOMIC_RELAXED));
+#endif
+}
+
+// TODO: Remove this unholy mess.
+OSMetaClassBase *MetaCast::wrapSafeMetaCast(const OSMetaClassBase *anObject, const OSMetaClass *toMeta) {
+    auto &metaCast = singleton();
+    auto ret = FunctionCast(wrapSafeMetaCast, metaCast.orgSafeMetaCast)(anObject, toMeta);
+
+    if (LIKELY(ret)) { return ret; }
+
+    const auto *filter = __atomic_load_n(&metaCast.filter, __ATOMIC_ACQUIRE);
+    const auto &entry = filter->entries[filter->slot(toMeta)];
+    // An empty slot only matches a null target.
+    if (LIKELY(entry.from != toMeta) || UNLIKELY(toMeta == nullptr)) {
+#ifdef DEBUG
+        metaCast.count(metaCast.misses);
+#endif
+        return nullptr;
+    }
+
+    metaCast.count(metaCast.hits);
+    return FunctionCast(wrapSafeMetaCast, metaCast.orgSafeMetaCast)(anObject, entry.to);
+}
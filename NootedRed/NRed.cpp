@@ -9,20 +9,25 @@
 #include <PrivateHeaders/DebugEnabler.hpp>
 #include <PrivateHeaders/Firmware.hpp>
 #include <PrivateHeaders/GPUDriversAMD/Driver.hpp>
+#include <PrivateHeaders/Hash.hpp>
 #include <PrivateHeaders/Hotfixes/AGDP.hpp>
 #include <PrivateHeaders/Hotfixes/X6000FB.hpp>
+#include <PrivateHeaders/MetaCast.hpp>
 #include <PrivateHeaders/Model.hpp>
 #include <PrivateHeaders/NRed.hpp>
+#include <PrivateHeaders/OffsetCache.hpp>
+#include <PrivateHeaders/PatchTelemetry.hpp>
 #include <PrivateHeaders/PatcherPlus.hpp>
+#include <PrivateHeaders/SMU.hpp>
 #include <PrivateHeaders/iVega/AppleGFXHDA.hpp>
 #include <PrivateHeaders/iVega/HWLibs.hpp>
 #include <PrivateHeaders/iVega/IPOffset.hpp>
 #include <PrivateHeaders/iVega/Regs/GC.hpp>
 #include <PrivateHeaders/iVega/Regs/NBIO.hpp>
-#include <PrivateHeaders/iVega/Regs/SMU.hpp>
 #include <PrivateHeaders/iVega/X5000.hpp>
 #include <PrivateHeaders/iVega/X6000.hpp>
 #include <PrivateHeaders/iVega/X6000FB.hpp>
+#include <kern/clock.h>
 
 //------ Module Logic ------//
 
@@ -36,45 +41,9 @@ void NRed::init() {
 
     SYSLOG("NRed", "Copyright 2022-2024 ChefKiss. If you've paid for this, you've been scammed.");
 
-    switch (getKernelVersion()) {
-        case KernelVersion::Catalina:
-            this->attributes.setCatalina();
-            break;
-        case KernelVersion::BigSur:
-            this->attributes.setBigSurAndLater();
-            break;
-        case KernelVersion::Monterey:
-            this->attributes.setBigSurAndLater();
-            this->attributes.setMonterey();
-            this->attributes.setMontereyAndLater();
-            break;
-        case KernelVersion::Ventura:
-            this->attributes.setBigSurAndLater();
-            this->attributes.setMontereyAndLater();
-            this->attributes.setVentura();
-            this->attributes.setVenturaAndLater();
-            if (getKernelMinorVersion() >= 5) {
-                this->attributes.setVentura1304Based();
-                this->attributes.setVentura1304AndLater();
-            }
-            break;
-        case KernelVersion::Sonoma:
-            this->attributes.setBigSurAndLater();
-            this->attributes.setMontereyAndLater();
-            this->attributes.setVenturaAndLater();
-            this->attributes.setVentura1304AndLater();
-            if (getKernelMinorVersion() >= 4) { this->attributes.setSonoma1404AndLater(); }
-            break;
-        case KernelVersion::Sequoia:
-            this->attributes.setBigSurAndLater();
-            this->attributes.setMontereyAndLater();
-            this->attributes.setVenturaAndLater();
-            this->attributes.setVentura1304AndLater();
-            this->attributes.setSonoma1404AndLater();
-            break;
-        default:
-            PANIC("NRed", "Unknown kernel version %d", getKernelVersion());
-    }
+    this->attributes.setKernelVersion(getKernelVersion(), getKernelMinorVersion());
+
+    this->mmio.init();
 
     SYSLOG("NRed", "Module initialised.");
     DBGLOG("NRed", "catalina = %s", this->attributes.isCatalina() ? "yes" : "no");
@@ -88,6 +57,8 @@ void NRed::init() {
     DBGLOG("NRed", "sonoma1404AndLater = %s", this->attributes.isSonoma1404AndLater() ? "yes" : "no");
     DBGLOG("NRed", "If any of the above values look incorrect, please report this to the developers.");
 
+    SMU::singleton().init();
+    MetaCast::singleton().init();
     Hotfixes::AGDP::singleton().init();
     Hotfixes::X6000FB::singleton().init();
     Backlight::singleton().init();
@@ -98,6 +69,14 @@ void NRed::init() {
     iVega::X6000::singleton().init();
     iVega::X5000::singleton().init();
 
+    // Registered after every module, so the table writes they queued for a kext share a single write window.
+    lilu.onKextLoadForce(nullptr, 0, [](void *, KernelPatcher &, size_t, mach_vm_address_t, size_t) {
+        PANIC_COND(!KernelWriteTransaction::singleton().commit(), "NRed", "Failed to commit kernel writes");
+        PatcherPlus::releaseSymbolIndex();
+    });
+    OffsetCache::singleton().init();
+    PatchTelemetry::singleton().init();
+
     lilu.onPatcherLoadForce(
         [](void *user, KernelPatcher &patcher) { static_cast<NRed *>(user)->processPatcher(patcher); }, this);
 }
@@ -121,27 +100,21 @@ void NRed::hwLateInit() {
     this->rmmio =
         this->iGPU->mapDeviceMemoryWithRegister(kIOPCIConfigBaseAddress5, kIOMapInhibitCache | kIOMapAnywhere);
     PANIC_COND(this->rmmio == nullptr || this->rmmio->getLength() == 0, "NRed", "Failed to map RMMIO");
-    this->rmmioPtr = reinterpret_cast<UInt32 *>(this->rmmio->getVirtualAddress());
+    this->mmio.map(reinterpret_cast<UInt32 *>(this->rmmio->getVirtualAddress()),
+        static_cast<UInt32>(this->rmmio->getLength() / sizeof(UInt32)));
 
     this->fbOffset = static_cast<UInt64>(this->readReg32(GC_BASE_0 + mmMC_VM_FB_OFFSET)) << 24;
     this->devRevision =
         (this->readReg32(NBIO_BASE_2 + mmRCC_DEV0_EPF0_STRAP0) & RCC_DEV0_EPF0_STRAP0_ATI_REV_ID_MASK) >>
         RCC_DEV0_EPF0_STRAP0_ATI_REV_ID_SHIFT;
 
-    if (this->attributes.isRaven()) {
-        if (this->devRevision >= 0x8) {
-            this->attributes.setRaven2();
-            this->enumRevision = 0x79;
-        } else if (this->attributes.isPicasso()) {
-            this->enumRevision = 0x41;
-        } else if (this->devRevision == 1) {
-            this->enumRevision = 0x20;
-        } else {
-            this->enumRevision = 0x1;
-        }
-    } else if (this->attributes.isRenoir() && !this->attributes.isGreenSardine() && this->devRevision == 0 &&
-               this->pciRevision >= 0x80 && this->pciRevision <= 0x84) {
-        this->attributes.setRenoirE();
+    this->attributes.setRevision(this->devRevision, this->pciRevision);
+    if (this->attributes.isRaven2()) {
+        this->enumRevision = 0x79;
+    } else if (this->attributes.isPicasso()) {
+        this->enumRevision = 0x41;
+    } else if (this->attributes.isRaven()) {
+        this->enumRevision = this->devRevision == 1 ? 0x20 : 0x1;
     }
 
     DBGLOG("NRed", "deviceID = 0x%X", this->deviceID);
@@ -157,6 +130,23 @@ void NRed::hwLateInit() {
     DBGLOG("NRed", "If any of the above values look incorrect, please report this to the developers.");
 }
 
+// Makes lookups of the firmware groups none of `asics` use panic, so a wrong ASIC check cannot load another ASIC's
+// files. Nothing is freed: the groups stay in the kext's `__nred_fw` section.
+// `firmwareDisabledGroups` is read without a lock by every lookup, so it is written once, here, before any module
+// processes a kext and so before anything looks firmware up.
+void NRed::disableFirmware(UInt8 asics) {
+    PANIC_COND(this->firmwareDisabled, "NRed", "Attempted to disable firmware twice!");
+    this->firmwareDisabled = true;
+    UInt32 groups = 0;
+    for (size_t i = 0; i < firmwareGroupCount; i++) {
+        if ((firmwareGroups[i].asics & asics) == 0) { groups |= (1U << i); }
+    }
+    firmwareDisabledGroups = groups;
+
+    DBGLOG("NRed", "Disabled firmware groups 0x%X, unused by this ASIC.", groups);
+    this->setProp32("NRed,FirmwareDisabled", groups);
+}
+
 static void updatePropertiesForDevice(IOPCIDevice *device) {
     UInt8 builtIn[] = {0x00};
     device->setProperty("built-in", builtIn, arrsize(builtIn));
@@ -199,30 +189,22 @@ void NRed::processPatcher(KernelPatcher &patcher) {
     updatePropertiesForDevice(this->iGPU);
 
     this->deviceID = WIOKit::readPCIConfigValue(this->iGPU, WIOKit::kIOPCIConfigDeviceID);
-    switch (this->deviceID) {
-        case 0x15D8:
-            this->attributes.setRaven();
-            this->attributes.setPicasso();
-            break;
-        case 0x15DD:
-            this->attributes.setRaven();
-            break;
-        case 0x164C:
-        case 0x1636:
-            this->attributes.setRenoir();
-            this->enumRevision = 0x91;
-            break;
-        case 0x15E7:
-        case 0x1638:
-            this->attributes.setRenoir();
-            this->attributes.setGreenSardine();
-            this->enumRevision = 0xA1;
-            break;
-        default:
-            PANIC("NRed", "Unknown device ID: 0x%X", this->deviceID);
+    PANIC_COND(!this->attributes.setDevice(this->deviceID), "NRed", "Unknown device ID: 0x%X", this->deviceID);
+    if (this->attributes.isGreenSardine()) {
+        this->enumRevision = 0xA1;
+    } else if (this->attributes.isRenoir()) {
+        this->enumRevision = 0x91;
     }
     this->pciRevision = WIOKit::readPCIConfigValue(this->iGPU, WIOKit::kIOPCIConfigRevisionID);
 
+    if (this->attributes.isRenoir()) {
+        this->disableFirmware(kFWASICRenoir);
+    } else {
+        // Raven 2 shares both device IDs and is only told apart in `hwLateInit`, so its files are kept.
+        this->disableFirmware(kFWASICRaven2 | (this->attributes.isPicasso() ? kFWASICPicasso : kFWASICRaven));
+    }
+    SMU::singleton().publish();
+
     char name[128];
     bzero(name, sizeof(name));
     for (size_t i = 0, ii = 0; i < devInfo->videoExternal.size(); i++) {
@@ -238,56 +220,30 @@ void NRed::processPatcher(KernelPatcher &patcher) {
     DeviceInfo::deleter(devInfo);
 
     KernelPatcher::RouteRequest requests[] = {
-        {"__ZN15OSMetaClassBase12safeMetaCastEPKS_PK11OSMetaClass", wrapSafeMetaCast, this->orgSafeMetaCast},
+        {"__ZN15OSMetaClassBase12safeMetaCastEPKS_PK11OSMetaClass", MetaCast::wrapSafeMetaCast,
+            MetaCast::singleton().orgSafeMetaCast},
         {"__ZN11IOCatalogue10addDriversEP7OSArrayb", wrapAddDrivers, this->orgAddDrivers},
     };
     PANIC_COND(!patcher.routeMultipleLong(KernelPatcher::KernelID, requests), "NRed", "Failed to route kernel symbols");
 }
 
-void NRed::setProp32(const char *key, UInt32 value) { this->iGPU->setProperty(key, value, 32); }
-
-UInt32 NRed::readReg32(UInt32 reg) const {
-    if ((reg * sizeof(UInt32)) < this->rmmio->getLength()) {
-        return this->rmmioPtr[reg];
-    } else {
-        this->rmmioPtr[mmPCIE_INDEX2] = reg;
-        return this->rmmioPtr[mmPCIE_DATA2];
-    }
+void NRed::setProp32(const char *key, UInt32 value) {
+    if (this->iGPU) { this->iGPU->setProperty(key, value, 32); }
 }
 
-void NRed::writeReg32(UInt32 reg, UInt32 val) const {
-    if ((reg * sizeof(UInt32)) < this->rmmio->getLength()) {
-        this->rmmioPtr[reg] = val;
-    } else {
-        this->rmmioPtr[mmPCIE_INDEX2] = reg;
-        this->rmmioPtr[mmPCIE_DATA2] = val;
-    }
+void NRed::setProp(const char *key, OSObject *value) {
+    if (this->iGPU) { this->iGPU->setProperty(key, value); }
 }
 
-UInt32 NRed::smuWaitForResponse() const {
-    UInt32 ret = AMDSMUFWResponse::kSMUFWResponseNoResponse;
-    for (UInt32 i = 0; i < AMD_MAX_USEC_TIMEOUT; i++) {
-        ret = this->readReg32(MP_BASE + mmMP1_SMN_C2PMSG_90);
-        if (ret != AMDSMUFWResponse::kSMUFWResponseNoResponse) { break; }
-
-        IOSleep(1);
-    }
-
-    return ret;
+void NRed::setNumber(OSDictionary *dict, const char *key, UInt64 value) {
+    auto *number = OSNumber::withNumber(value, 64);
+    if (!number) { return; }
+    dict->setObject(key, number);
+    number->release();
 }
 
 CAILResult NRed::sendMsgToSmc(UInt32 msg, UInt32 param, UInt32 *outParam) const {
-    this->smuWaitForResponse();
-
-    this->writeReg32(MP_BASE + mmMP1_SMN_C2PMSG_82, param);
-    this->writeReg32(MP_BASE + mmMP1_SMN_C2PMSG_90, 0);
-    this->writeReg32(MP_BASE + mmMP1_SMN_C2PMSG_66, msg);
-
-    const auto resp = this->smuWaitForResponse();
-
-    if (outParam != nullptr) { *outParam = this->readReg32(MP_BASE + mmMP1_SMN_C2PMSG_82); }
-
-    return processSMUFWResponse(resp);
+    return SMU::singleton().send(msg, param, outParam);
 }
 
 static bool checkAtomBios(const UInt8 *bios, size_t size) {
@@ -477,33 +433,90 @@ bool NRed::getVBIOS() {
     return true;
 }
 
-static const char *getDriverXMLForBundle(const char *bundleIdentifier, size_t *len) {
-    const auto identifierLen = strlen(bundleIdentifier);
-    const auto totalLen = identifierLen + 5;
-    auto *filename = new char[totalLen];
-    memcpy(filename, bundleIdentifier, identifierLen);
-    strlcat(filename, ".xml", totalLen);
-
-    const auto &driversXML = getFWByName(filename);
-    delete[] filename;
+static FWView getDriverDataForBundle(const char *bundleIdentifier, const char *extension) {
+    char filename[128];
+    snprintf(filename, sizeof(filename), "%s%s", bundleIdentifier, extension);
+    return getFWByName(filename);
+}
 
-    *len = driversXML.length;
-    return reinterpret_cast<const char *>(driversXML.data);
+// The personalities are stored pre-serialised by GenerateFirmware.py, which spares parsing the XML at boot.
+static OSObject *unserializeDriversForBundle(const char *bundleIdentifier, OSString **errStr) {
+#ifdef DEBUG
+    const auto start = mach_absolute_time();
+#endif
+    auto *drivers = [&] {
+        const auto binary = getDriverDataForBundle(bundleIdentifier, ".osb");
+        return OSUnserializeBinary(reinterpret_cast<const char *>(binary.data), binary.length, errStr);
+    }();
+#ifdef DEBUG
+    if (drivers == nullptr) {
+        SYSLOG("NRed", "Binary driver data for %s was rejected (%s), falling back to XML", bundleIdentifier,
+            *errStr ? (*errStr)->getCStringNoCopy() : "(nil)");
+        OSSafeReleaseNULL(*errStr);
+        const auto xml = getDriverDataForBundle(bundleIdentifier, ".xml");
+        drivers = OSUnserializeXML(reinterpret_cast<const char *>(xml.data), xml.length, errStr);
+    }
+    UInt64 nanoseconds;
+    absolutetime_to_nanoseconds(mach_absolute_time() - start, &nanoseconds);
+    DBGLOG("NRed", "Unserialised the drivers of %s in %llu ns", bundleIdentifier, nanoseconds);
+#endif
+    return drivers;
 }
 
-static const char *DriverBundleIdentifiers[] = {
+struct DriverBundle {
+    const char *identifier;
+    UInt32 hash;
+
+    constexpr DriverBundle(const char *identifier) : identifier {identifier}, hash {fnv1a(identifier)} {}
+};
+
+// Sorted by hash, for `findDriverBundle`.
+static constexpr DriverBundle DriverBundles[] = {
     "com.apple.kext.AMDRadeonX5000",
-    "com.apple.kext.AMDRadeonX5000HWServices",
-    "com.apple.kext.AMDRadeonX6000",
     "com.apple.kext.AMDRadeonX6000Framebuffer",
     "com.apple.driver.AppleGFXHDA",
+    "com.apple.kext.AMDRadeonX6000",
+    "com.apple.kext.AMDRadeonX5000HWServices",
 };
 
+static constexpr bool driverBundlesSorted() {
+    for (size_t i = 1; i < arrsize(DriverBundles); i += 1) {
+        if (DriverBundles[i - 1].hash >= DriverBundles[i].hash) { return false; }
+    }
+    return true;
+}
+static_assert(driverBundlesSorted(), "DriverBundles must be sorted by hash");
+
+static constexpr UInt8 AllDriverBundles = (1U << arrsize(DriverBundles)) - 1;
 static UInt8 matchedDrivers = 0;
 
+static size_t findDriverBundle(const char *bundleIdentifier) {
+    auto hash = fnv1a(bundleIdentifier);
+    size_t low = 0, high = arrsize(DriverBundles);
+    while (low < high) {
+        auto middle = (low + high) / 2;
+        if (DriverBundles[middle].hash < hash) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low < arrsize(DriverBundles) && DriverBundles[low].hash == hash &&
+        strcmp(bundleIdentifier, DriverBundles[low].identifier) == 0) {
+        return low;
+    }
+    return arrsize(DriverBundles);
+}
+
+// The route stays in place, as its prologue cannot be rewritten atomically while other CPUs may be calling it; once
+// every bundle has been injected, calls go straight on to the original.
 bool NRed::wrapAddDrivers(void *that, OSArray *array, bool doNubMatching) {
+    if (matchedDrivers == AllDriverBundles) {
+        return FunctionCast(wrapAddDrivers, singleton().orgAddDrivers)(that, array, doNubMatching);
+    }
+
     UInt32 driverCount = array->getCount();
-    for (UInt32 driverIndex = 0; driverIndex < driverCount; driverIndex += 1) {
+    for (UInt32 driverIndex = 0; driverIndex < driverCount && matchedDrivers != AllDriverBundles; driverIndex += 1) {
         OSObject *object = array->getObject(driverIndex);
         PANIC_COND(object == nullptr, "NRed", "Critical error in addDrivers: Index is out of bounds.");
         auto *dict = OSDynamicCast(OSDictionary, object);
@@ -513,58 +526,33 @@ bool NRed::wrapAddDrivers(void *that, OSArray *array, bool doNubMatching) {
         auto *bundleIdentifierCStr = bundleIdentifier->getCStringNoCopy();
         if (bundleIdentifierCStr == nullptr) { continue; }
 
-        for (size_t identifierIndex = 0; identifierIndex < arrsize(DriverBundleIdentifiers); identifierIndex += 1) {
-            if ((matchedDrivers & (1U << identifierIndex)) != 0) { continue; }
-
-            if (strcmp(bundleIdentifierCStr, DriverBundleIdentifiers[identifierIndex]) == 0) {
-                matchedDrivers |= (1U << identifierIndex);
-
-                DBGLOG("NRed", "Matched %s, injecting.", bundleIdentifierCStr);
+        auto bundleIndex = findDriverBundle(bundleIdentifierCStr);
+        if (bundleIndex == arrsize(DriverBundles) || (matchedDrivers & (1U << bundleIndex)) != 0) { continue; }
+        matchedDrivers |= (1U << bundleIndex);
 
-                size_t len;
-                auto *driverXML = getDriverXMLForBundle(bundleIdentifierCStr, &len);
+        DBGLOG("NRed", "Matched %s, injecting.", bundleIdentifierCStr);
 
-                OSString *errStr = nullptr;
-                auto *dataUnserialized = OSUnserializeXML(driverXML, len, &errStr);
+        OSString *errStr = nullptr;
+        auto *dataUnserialized = unserializeDriversForBundle(bundleIdentifierCStr, &errStr);
 
-                PANIC_COND(dataUnserialized == nullptr, "NRed", "Failed to unserialize driver XML for %s: %s",
-                    bundleIdentifierCStr, errStr ? errStr->getCStringNoCopy() : "(nil)");
+        PANIC_COND(dataUnserialized == nullptr, "NRed", "Failed to unserialize driver data for %s: %s",
+            bundleIdentifierCStr, errStr ? errStr->getCStringNoCopy() : "(nil)");
 
-                auto *drivers = OSDynamicCast(OSArray, dataUnserialized);
-                PANIC_COND(drivers == nullptr, "NRed", "Failed to cast %s driver data", bundleIdentifierCStr);
-                UInt32 injectedDriverCount = drivers->getCount();
+        auto *drivers = OSDynamicCast(OSArray, dataUnserialized);
+        PANIC_COND(drivers == nullptr, "NRed", "Failed to cast %s driver data", bundleIdentifierCStr);
+        UInt32 injectedDriverCount = drivers->getCount();
 
-                array->ensureCapacity(driverCount + injectedDriverCount);
+        array->ensureCapacity(driverCount + injectedDriverCount);
 
-                for (UInt32 injectedDriverIndex = 0; injectedDriverIndex < injectedDriverCount;
-                     injectedDriverIndex += 1) {
-                    array->setObject(driverIndex, drivers->getObject(injectedDriverIndex));
-                    driverIndex += 1;
-                    driverCount += 1;
-                }
-
-                dataUnserialized->release();
-                break;
-            }
+        // Inserted before the matched personality, which is skipped together with them.
+        for (UInt32 injectedDriverIndex = 0; injectedDriverIndex < injectedDriverCount; injectedDriverIndex += 1) {
+            array->setObject(driverIndex, drivers->getObject(injectedDriverIndex));
+            driverIndex += 1;
+            driverCount += 1;
         }
-    }
 
-    return FunctionCast(wrapAddDrivers, singleton().orgAddDrivers)(that, array, doNubMatching);
-}
-
-// TODO: Remove this unholy mess.
-OSMetaClassBase *NRed::wrapSafeMetaCast(const OSMetaClassBase *anObject, const OSMetaClass *toMeta) {
-    auto ret = FunctionCast(wrapSafeMetaCast, singleton().orgSafeMetaCast)(anObject, toMeta);
-
-    if (LIKELY(ret)) { return ret; }
-
-    for (const auto &ent : singleton().metaClassMap) {
-        if (UNLIKELY(ent[0] == toMeta)) {
-            return FunctionCast(wrapSafeMetaCast, singleton().orgSafeMetaCast)(anObject, ent[1]);
-        } else if (UNLIKELY(ent[1] == toMeta)) {
-            return FunctionCast(wrapSafeMetaCast, singleton().orgSafeMetaCast)(anObject, ent[0]);
-        }
+        dataUnserialized->release();
     }
 
-    return nullptr;
+    return FunctionCast(wrapAddDrivers, singleton().orgAddDrivers)(that, array, doNubMatching);
 }
@@ -0,0 +1,271 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+#include <Headers/kern_api.hpp>
+#include <Headers/kern_nvram.hpp>
+#include <PrivateHeaders/OffsetCache.hpp>
+#include <kern/clock.h>
+
+static const char *offsetCacheKey = NVRAM_PREFIX(LILU_VENDOR_GUID, "nred-offset-cache");
+
+//------ Module Logic ------//
+
+static OffsetCache instance {};
+
+OffsetCache &OffsetCache::singleton() { return instance; }
+
+void OffsetCache::init() {
+    PANIC_COND(this->initialised, "OffsetCache", "Attempted to initialise module twice!");
+    this->initialised = true;
+
+    if (checkKernelArgument("-NRedNoOffsetCache")) {
+        SYSLOG("OffsetCache", "Disabled by boot argument.");
+        return;
+    }
+
+    this->storeLock = IOLockAlloc();
+    this->storeCall = thread_call_allocate(store, this);
+    PANIC_COND(this->storeLock == nullptr || this->storeCall == nullptr, "OffsetCache",
+        "Failed to allocate the store call");
+    this->enabled = true;
+
+    SYSLOG("OffsetCache", "Module initialised.");
+
+    // Registered after every other module, so this runs once they are all done with the kext.
+    lilu.onKextLoadForce(
+        nullptr, 0,
+        [](void *user, KernelPatcher &, size_t, mach_vm_address_t, size_t) {
+            static_cast<OffsetCache *>(user)->flush();
+        },
+        this);
+}
+
+size_t OffsetCache::serialise(const OffsetCacheRecord *const *records, size_t recordCount, UInt8 *out,
+    size_t outSize) {
+    size_t size = sizeof(UInt32) + sizeof(UInt16) * 2;
+    for (size_t i = 0; i < recordCount; i++) {
+        size += sizeof(records[i]->uuid) + sizeof(UInt32) + records[i]->entries.size() * sizeof(OffsetCacheEntry);
+    }
+    if (!out || outSize < size) { return size; }
+
+    auto put = [&out](const void *src, size_t len) {
+        lilu_os_memcpy(out, src, len);
+        out += len;
+    };
+    UInt32 magic = Magic;
+    UInt16 version = Version, count = static_cast<UInt16>(recordCount);
+    put(&magic, sizeof(magic));
+    put(&version, sizeof(version));
+    put(&count, sizeof(count));
+    for (size_t i = 0; i < recordCount; i++) {
+        auto &record = *records[i];
+        UInt32 entryCount = static_cast<UInt32>(record.entries.size());
+        put(record.uuid, sizeof(record.uuid));
+        put(&entryCount, sizeof(entryCount));
+        if (entryCount) { put(record.entries.data(), entryCount * sizeof(OffsetCacheEntry)); }
+    }
+    return size;
+}
+
+bool OffsetCache::deserialise(const UInt8 *data, size_t size, OffsetCacheRecord *records, size_t maxRecords,
+    size_t &recordCount) {
+    recordCount = 0;
+    size_t off = 0;
+    auto get = [&](void *dst, size_t len) {
+        if (size - off < len) { return false; }
+        lilu_os_memcpy(dst, data + off, len);
+        off += len;
+        return true;
+    };
+
+    UInt32 magic;
+    UInt16 version, count;
+    if (!get(&magic, sizeof(magic)) || !get(&version, sizeof(version)) || !get(&count, sizeof(count)) ||
+        magic != Magic || version != Version || count > maxRecords) {
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        auto &record = records[i];
+        UInt32 entryCount;
+        if (!get(record.uuid, sizeof(record.uuid)) || !get(&entryCount, sizeof(entryCount)) ||
+            entryCount > MaxEntries || (size - off) / sizeof(OffsetCacheEntry) < entryCount) {
+            for (size_t j = 0; j < i; j++) { records[j].entries.deinit(); }
+            return false;
+        }
+        record.used = record.dirty = false;
+        for (UInt32 j = 0; j < entryCount; j++) {
+            OffsetCacheEntry entry {};
+            get(&entry, sizeof(entry));
+            if (!record.entries.push_back(entry)) {
+                for (size_t k = 0; k <= i; k++) { records[k].entries.deinit(); }
+                return false;
+            }
+        }
+    }
+
+    if (off != size) {
+        for (size_t i = 0; i < count; i++) { records[i].entries.deinit(); }
+        return false;
+    }
+    recordCount = count;
+    return true;
+}
+
+void OffsetCache::load() {
+    if (this->loaded) { return; }
+    this->loaded = true;
+
+    NVStorage storage;
+    if (!storage.init()) {
+        DBGLOG("OffsetCache", "NVRAM is unavailable");
+        return;
+    }
+    UInt32 size = 0;
+    auto *data = storage.read(offsetCacheKey, size, NVStorage::OptChecksum);
+    storage.deinit();
+    if (!data) {
+        DBGLOG("OffsetCache", "No records stored");
+        return;
+    }
+    if (!deserialise(data, size, this->records, arrsize(this->records), this->recordCount)) {
+        SYSLOG("OffsetCache", "Stored records are malformed, ignoring them");
+    } else {
+        DBGLOG("OffsetCache", "Loaded %zu records (%u bytes)", this->recordCount, size);
+    }
+    Buffer::deleter(data);
+}
+
+OffsetCacheRecord *OffsetCache::getRecord(const UInt8 *uuid, bool create) {
+    this->load();
+    for (size_t i = 0; i < this->recordCount; i++) {
+        if (!memcmp(this->records[i].uuid, uuid, sizeof(this->records[i].uuid))) {
+            this->records[i].used = true;
+            return &this->records[i];
+        }
+    }
+    if (!create) { return nullptr; }
+
+    // Evict a record that was not used this boot; those belong to kexts that have since been updated.
+    size_t i = this->recordCount;
+    if (i == arrsize(this->records)) {
+        for (i = 0; i < this->recordCount && this->records[i].used; i++) {}
+        if (i == this->recordCount) { return nullptr; }
+        this->records[i].entries.deinit();
+    } else {
+        this->recordCount += 1;
+    }
+    auto &record = this->records[i];
+    lilu_os_memcpy(record.uuid, uuid, sizeof(record.uuid));
+    record.used = record.dirty = true;
+    return &record;
+}
+
+const OffsetCacheEntry *OffsetCache::lookup(const UInt8 *uuid, UInt32 key, size_t &count) {
+    count = 0;
+    if (!this->enabled) { return nullptr; }
+    auto *record = this->getRecord(uuid, false);
+    if (!record) { return nullptr; }
+    for (size_t i = 0; i < record->entries.size(); i++) {
+        if (record->entries[i].key != key) { continue; }
+        while (i + count < record->entries.size() && record->entries[i + count].key == key) { count++; }
+        return &record->entries[i];
+    }
+    return nullptr;
+}
+
+void OffsetCache::update(const UInt8 *uuid, UInt32 key, const size_t *offsets, size_t count) {
+    if (!this->enabled) { return; }
+    auto *record = this->getRecord(uuid, count != 0);
+    if (!record) { return; }
+
+    size_t existing = 0;
+    auto *entries = this->lookup(uuid, key, existing);
+    if (existing == count) {
+        size_t i = 0;
+        while (i < count && entries[i].offset == offsets[i]) { i++; }
+        if (i == count) { return; }
+    }
+    if (existing) {
+        auto first = static_cast<size_t>(entries - &record->entries[0]);
+        for (size_t i = 0; i < existing; i++) { record->entries.erase(first); }
+    }
+    if (record->entries.size() + count > MaxEntries) {
+        DBGLOG("OffsetCache", "Not caching %zu offsets for 0x%X, record is full", count, key);
+        count = 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        OffsetCacheEntry entry {.key = key, .offset = static_cast<UInt32>(offsets[i])};
+        record->entries.push_back(entry);
+    }
+    record->dirty = true;
+}
+
+void OffsetCache::flush() {
+    if (!this->enabled || !this->loaded) { return; }
+
+    bool dirty = false;
+    for (size_t i = 0; i < this->recordCount; i++) { dirty |= this->records[i].dirty; }
+    if (!dirty) { return; }
+
+    // The kexts seen this boot come first. The other records are kept while there is room, as their kexts may not have
+    // loaded yet; the stale ones are evicted by `getRecord` once the slots run out.
+    const OffsetCacheRecord *kept[arrsize(this->records)];
+    size_t keptCount = 0;
+    size_t size = serialise(kept, 0, nullptr, 0);
+    for (size_t pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < this->recordCount; i++) {
+            if (this->records[i].used != (pass == 0)) { continue; }
+            kept[keptCount] = &this->records[i];
+            auto newSize = serialise(kept, keptCount + 1, nullptr, 0);
+            if (newSize > MaxSerialisedSize) {
+                SYSLOG_COND(pass == 0, "OffsetCache", "Record %zu is too large to store", i);
+                continue;
+            }
+            size = newSize;
+            keptCount += 1;
+        }
+    }
+    auto *data = Buffer::create<UInt8>(size);
+    if (!data) { return; }
+    serialise(kept, keptCount, data, size);
+    for (size_t i = 0; i < this->recordCount; i++) { this->records[i].dirty = false; }
+
+    IOLockLock(this->storeLock);
+    auto *stale = this->pending;
+    this->pending = data;
+    this->pendingSize = size;
+    this->pendingCount = keptCount;
+    IOLockUnlock(this->storeLock);
+    if (stale) { Buffer::deleter(stale); }
+
+    // Called after every kext, and the target kexts load back to back, so the write is held back until they have
+    // stopped changing the records. Each call pushes the deadline back.
+    UInt64 delay;
+    nanoseconds_to_absolutetime(static_cast<UInt64>(StoreDelaySecs) * NSEC_PER_SEC, &delay);
+    thread_call_enter_delayed(this->storeCall, mach_absolute_time() + delay);
+}
+
+void OffsetCache::store(thread_call_param_t param0, thread_call_param_t) {
+    auto *self = static_cast<OffsetCache *>(param0);
+    IOLockLock(self->storeLock);
+    auto *data = self->pending;
+    auto size = self->pendingSize;
+    auto count = self->pendingCount;
+    self->pending = nullptr;
+    IOLockUnlock(self->storeLock);
+    if (!data) { return; }
+
+    NVStorage storage;
+    if (storage.init()) {
+        if (storage.write(offsetCacheKey, data, static_cast<UInt32>(size), NVStorage::OptChecksum)) {
+            DBGLOG("OffsetCache", "Stored %zu records (%zu bytes)", count, size);
+        } else {
+            SYSLOG("OffsetCache", "Failed to store records");
+        }
+        storage.deinit();
+    } else {
+        SYSLOG("OffsetCache", "NVRAM is unavailable, records are not stored");
+    }
+    Buffer::deleter(data);
+}
@@ -0,0 +1,142 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+#include <Headers/kern_api.hpp>
+#include <PrivateHeaders/NRed.hpp>
+#include <PrivateHeaders/PatchTelemetry.hpp>
+#include <kern/clock.h>
+
+//------ Module Logic ------//
+
+static PatchTelemetry instance {};
+
+PatchTelemetry &PatchTelemetry::singleton() { return instance; }
+
+void PatchTelemetry::init() {
+    PANIC_COND(this->initialised, "PatchTelemetry", "Attempted to initialise module twice!");
+    this->initialised = true;
+
+    if (checkKernelArgument("-NRedNoTelemetry")) {
+        SYSLOG("PatchTelemetry", "Disabled by boot argument.");
+        return;
+    }
+    this->enabled = true;
+
+    SYSLOG("PatchTelemetry", "Module initialised.");
+
+    // Registered after every other module, so this runs once they are all done with the kext.
+    lilu.onKextLoadForce(
+        nullptr, 0,
+        [](void *user, KernelPatcher &, size_t, mach_vm_address_t, size_t) {
+            static_cast<PatchTelemetry *>(user)->publish();
+        },
+        this);
+}
+
+PatchTelemetry::Scope PatchTelemetry::begin() const {
+    return {.start = this->enabled ? mach_absolute_time() : 0, .bytesScanned = this->bytesScanned};
+}
+
+void PatchTelemetry::record(const Scope &scope, size_t kext, PatchKind kind, PatchMethod method, UInt32 key,
+    size_t matches) {
+    if (!this->enabled || this->records.size() >= MaxRecords) { return; }
+
+    UInt64 nanoseconds = 0;
+    absolutetime_to_nanoseconds(mach_absolute_time() - scope.start, &nanoseconds);
+    auto bytesScanned = this->bytesScanned - scope.bytesScanned;
+    PatchTelemetryRecord record {
+        .key = key,
+        .matches = static_cast<UInt32>(matches),
+        .bytesScanned = bytesScanned > UINT32_MAX ? UINT32_MAX : static_cast<UInt32>(bytesScanned),
+        .nanoseconds = nanoseconds > UINT32_MAX ? UINT32_MAX : static_cast<UInt32>(nanoseconds),
+        .kext = static_cast<UInt16>(kext),
+        .kind = kind,
+        .method = method,
+    };
+    if (!this->records.push_back(record)) {
+        SYSLOG("PatchTelemetry", "Failed to store a record");
+        return;
+    }
+    this->dirty = true;
+}
+
+void PatchTelemetry::nameKext(size_t kext, const char *name) {
+    if (!this->enabled || !name) { return; }
+    for (size_t i = 0; i < this->kextCount; i++) {
+        if (this->kextIndices[i] == kext) {
+            this->dirty |= this->kextNames[i] != name;
+            this->kextNames[i] = name;
+            return;
+        }
+    }
+    if (this->kextCount == MaxKexts) { return; }
+    this->kextIndices[this->kextCount] = kext;
+    this->kextNames[this->kextCount++] = name;
+    this->dirty = true;
+}
+
+void PatchTelemetry::publish() {
+    // Most kexts are of no interest to any module, so there is nothing new to publish after them.
+    if (!this->dirty || !this->records.size()) { return; }
+
+    // Per-kext totals, in the order the kexts were first seen.
+    size_t kexts[MaxKexts];
+    size_t kextCount = 0;
+    for (size_t i = 0; i < this->records.size() && kextCount < MaxKexts; i++) {
+        size_t j = 0;
+        while (j < kextCount && kexts[j] != this->records[i].kext) { j++; }
+        if (j == kextCount) { kexts[kextCount++] = this->records[i].kext; }
+    }
+
+    auto *totals = OSArray::withCapacity(static_cast<unsigned int>(kextCount));
+    auto *dict = OSDictionary::withCapacity(3);
+    auto *data = OSData::withBytes(this->records.data(),
+        static_cast<unsigned int>(this->records.size() * sizeof(PatchTelemetryRecord)));
+    if (!totals || !dict || !data) {
+        SYSLOG("PatchTelemetry", "Failed to allocate the telemetry property");
+        OSSafeReleaseNULL(totals);
+        OSSafeReleaseNULL(dict);
+        OSSafeReleaseNULL(data);
+        return;
+    }
+
+    for (size_t k = 0; k < kextCount; k++) {
+        UInt64 requests = 0, failures = 0, bytesScanned = 0, nanoseconds = 0;
+        for (size_t i = 0; i < this->records.size(); i++) {
+            auto &record = this->records[i];
+            if (record.kext != kexts[k]) { continue; }
+            if (record.method != PatchMethod::Batch) { requests += 1; }
+            if (record.method == PatchMethod::Failed) { failures += 1; }
+            bytesScanned += record.bytesScanned;
+            nanoseconds += record.nanoseconds;
+        }
+        auto *total = OSDictionary::withCapacity(6);
+        if (!total) { continue; }
+        for (size_t i = 0; i < this->kextCount; i++) {
+            if (this->kextIndices[i] == kexts[k]) {
+                auto *name = OSString::withCString(this->kextNames[i]);
+                if (name) {
+                    total->setObject("Name", name);
+                    name->release();
+                }
+                break;
+            }
+        }
+        NRed::setNumber(total, "LoadIndex", kexts[k]);
+        NRed::setNumber(total, "Requests", requests);
+        NRed::setNumber(total, "Failures", failures);
+        NRed::setNumber(total, "BytesScanned", bytesScanned);
+        NRed::setNumber(total, "Nanoseconds", nanoseconds);
+        totals->setObject(total);
+        total->release();
+    }
+
+    NRed::setNumber(dict, "Version", Version);
+    dict->setObject("Records", data);
+    dict->setObject("Kexts", totals);
+    NRed::singleton().setProp("NRed,PatchTelemetry", dict);
+    this->dirty = false;
+    dict->release();
+    data->release();
+    totals->release();
+}
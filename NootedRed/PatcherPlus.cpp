@@ -1,31 +1,502 @@
 // Copyright © 2022-2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
 // See LICENSE for details.
 
+#include <PrivateHeaders/Hash.hpp>
+#include <PrivateHeaders/OffsetCache.hpp>
+#include <PrivateHeaders/PatchTelemetry.hpp>
 #include <PrivateHeaders/PatcherPlus.hpp>
+#include <mach-o/loader.h>
+#include <mach-o/nlist.h>
+
+// Most frequent bytes in x86_64 kext code and data, most frequent first.
+static const UInt8 commonBytes[] = {0x00, 0xFF, 0x48, 0x89, 0x8B, 0x0F, 0x41, 0x4C, 0xE8, 0x45, 0x85, 0x01, 0x74, 0x83,
+    0x8D, 0x49, 0xC0, 0x24, 0x44, 0x75, 0x5D, 0x55, 0xE5, 0xC3, 0x84, 0x31, 0x08, 0x10, 0x04, 0x02, 0xC7, 0x80, 0xF8,
+    0x40, 0xB8, 0x20, 0x90, 0xEB, 0x03, 0xE9};
+
+static size_t byteFrequencyRank(UInt8 byte) {
+    for (size_t i = 0; i < arrsize(commonBytes); i++) {
+        if (commonBytes[i] == byte) { return arrsize(commonBytes) - i; }
+    }
+    return 0;
+}
+
+size_t PatcherPlus::patternAnchor(const UInt8 *pattern, const UInt8 *patternMask, size_t patternSize) {
+    size_t anchor = patternSize;
+    size_t anchorRank = 0;
+    for (size_t i = 0; i < patternSize; i++) {
+        if (patternMask && patternMask[i] != 0xFF) { continue; }
+        auto rank = byteFrequencyRank(pattern[i]);
+        if (anchor == patternSize || rank < anchorRank) {
+            anchor = i;
+            anchorRank = rank;
+            if (rank == 0) { break; }
+        }
+    }
+    return anchor;
+}
+
+static void addSectionRange(PatcherPlus::Range *ranges, size_t &count, size_t offset, size_t size) {
+    // Keep the ranges sorted and merge touching ones, most sections of a class are laid out back to back.
+    size_t i = count;
+    while (i > 0 && ranges[i - 1].offset > offset) { i--; }
+    if (i > 0 && ranges[i - 1].offset + ranges[i - 1].size >= offset) {
+        auto end = ranges[i - 1].offset + ranges[i - 1].size;
+        if (offset + size > end) { ranges[i - 1].size = offset + size - ranges[i - 1].offset; }
+        return;
+    }
+    if (count == PatcherPlus::ImageSections::MaxRanges) {
+        // Out of slots, grow the closest range instead; scanning a few extra bytes is harmless. The grown range may
+        // cover sections of the other class, so code and data ranges can overlap.
+        auto &range = ranges[i > 0 ? i - 1 : 0];
+        auto end = range.offset + range.size > offset + size ? range.offset + range.size : offset + size;
+        if (offset < range.offset) { range.offset = offset; }
+        range.size = end - range.offset;
+        return;
+    }
+    for (size_t j = count; j > i; j--) { ranges[j] = ranges[j - 1]; }
+    ranges[i] = {offset, size};
+    count += 1;
+}
+
+bool PatcherPlus::ImageSections::parse(const UInt8 *header, size_t size) {
+    this->codeCount = this->dataCount = 0;
+    this->hasUUID = false;
+
+    if (size < sizeof(mach_header_64)) { return false; }
+    auto *mh = reinterpret_cast<const mach_header_64 *>(header);
+    if (mh->magic != MH_MAGIC_64 || mh->sizeofcmds > size - sizeof(mach_header_64)) { return false; }
+
+    // Section addresses are relative to the segment that maps the header.
+    bool hasBase = false;
+    UInt64 base = 0;
+    for (UInt32 pass = 0; pass < 2; pass++) {
+        size_t off = sizeof(mach_header_64);
+        auto end = off + mh->sizeofcmds;
+        for (UInt32 i = 0; i < mh->ncmds; i++) {
+            if (off + sizeof(load_command) > end) { return false; }
+            auto *lc = reinterpret_cast<const load_command *>(header + off);
+            if (lc->cmdsize < sizeof(load_command) || lc->cmdsize > end - off) { return false; }
+            if (lc->cmd == LC_UUID && pass == 0) {
+                if (lc->cmdsize < sizeof(uuid_command)) { return false; }
+                lilu_os_memcpy(this->uuid, reinterpret_cast<const uuid_command *>(lc)->uuid, sizeof(this->uuid));
+                this->hasUUID = true;
+            } else if (lc->cmd == LC_SEGMENT_64) {
+                if (lc->cmdsize < sizeof(segment_command_64)) { return false; }
+                auto *seg = reinterpret_cast<const segment_command_64 *>(lc);
+                if (pass == 0) {
+                    if (!hasBase && seg->fileoff == 0 && seg->filesize != 0) {
+                        base = seg->vmaddr;
+                        hasBase = true;
+                    }
+                } else {
+                    if ((lc->cmdsize - sizeof(segment_command_64)) / sizeof(section_64) < seg->nsects) {
+                        return false;
+                    }
+                    auto *sects = reinterpret_cast<const section_64 *>(seg + 1);
+                    for (UInt32 j = 0; j < seg->nsects; j++) {
+                        auto &sect = sects[j];
+                        auto type = sect.flags & SECTION_TYPE;
+                        if (!sect.size || sect.addr < base || type == S_ZEROFILL || type == S_GB_ZEROFILL ||
+                            type == S_THREAD_LOCAL_ZEROFILL) {
+                            continue;
+                        }
+                        if (sect.flags & (S_ATTR_PURE_INSTRUCTIONS | S_ATTR_SOME_INSTRUCTIONS)) {
+                            addSectionRange(this->code, this->codeCount, sect.addr - base, sect.size);
+                        } else {
+                            addSectionRange(this->data, this->dataCount, sect.addr - base, sect.size);
+                        }
+                    }
+                }
+            }
+            off += lc->cmdsize;
+        }
+        if (!hasBase) { return false; }
+    }
+
+    return true;
+}
+
+// Lilu processes kexts one at a time, but several modules patch the same kext; keep the last few parsed images around.
+static constexpr size_t ImageCacheSize = 4;
+static mach_vm_address_t imageCacheHeaders[ImageCacheSize] {};
+static size_t imageCacheSizes[ImageCacheSize] {};
+static PatcherPlus::ImageSections imageCache[ImageCacheSize] {};
+static size_t imageCacheNext = 0;
+
+const PatcherPlus::ImageSections *PatcherPlus::ImageSections::get(mach_vm_address_t address, size_t size) {
+    if (!address || size < sizeof(mach_header_64) ||
+        reinterpret_cast<const mach_header_64 *>(address)->magic != MH_MAGIC_64) {
+        return nullptr;
+    }
+
+    for (size_t i = 0; i < ImageCacheSize; i++) {
+        if (imageCacheHeaders[i] == address && imageCacheSizes[i] == size) { return &imageCache[i]; }
+    }
+
+    auto i = imageCacheNext;
+    imageCacheNext = (imageCacheNext + 1) % ImageCacheSize;
+    if (!imageCache[i].parse(reinterpret_cast<const UInt8 *>(address), size)) {
+        imageCacheHeaders[i] = 0;
+        return nullptr;
+    }
+    imageCacheHeaders[i] = address;
+    imageCacheSizes[i] = size;
+    DBGLOG("Patcher+", "Parsed image at 0x%llX: %zu code ranges, %zu data ranges", address, imageCache[i].codeCount,
+        imageCache[i].dataCount);
+    return &imageCache[i];
+}
+
+size_t PatcherPlus::getRanges(Section section, mach_vm_address_t address, size_t size, Range *ranges,
+    size_t maxRanges) {
+    if (!maxRanges) { return 0; }
+    ranges[0] = {0, size};
+
+    const ImageSections *image;
+    if (section == Section::Any || !(image = ImageSections::get(address, size))) { return 1; }
+
+    auto *src = section == Section::Code ? image->code : image->data;
+    auto srcCount = section == Section::Code ? image->codeCount : image->dataCount;
+    size_t count = 0;
+    for (size_t i = 0; i < srcCount && count < maxRanges; i++) {
+        if (src[i].offset >= size) { break; }
+        auto end = src[i].offset + src[i].size;
+        ranges[count++] = {src[i].offset, (end > size ? size : end) - src[i].offset};
+    }
+    if (!count) {
+        ranges[0] = {0, size};
+        return 1;
+    }
+    return count;
+}
+
+// Open addressing table of the defined symbols of one image, indexed by name hash. Slots hold symbol index + 1.
+struct SymbolIndex {
+    mach_vm_address_t address {0};
+    size_t size {0};
+    UInt64 base {0};
+    const nlist_64 *symbols {nullptr};
+    const char *strings {nullptr};
+    UInt32 stringsSize {0};
+    UInt32 *hashes {nullptr};
+    UInt32 *slots {nullptr};
+    size_t mask {0};
+    bool failed {false};
+
+    bool build(mach_vm_address_t address, size_t size);
+    void release();
+};
+
+static SymbolIndex symbolIndex {};
+
+bool SymbolIndex::build(mach_vm_address_t address, size_t size) {
+    this->release();
+    this->address = address;
+    this->size = size;
+    this->failed = true;
+
+    auto *header = reinterpret_cast<const UInt8 *>(address);
+    auto *mh = reinterpret_cast<const mach_header_64 *>(header);
+    if (size < sizeof(mach_header_64) || mh->magic != MH_MAGIC_64 ||
+        mh->sizeofcmds > size - sizeof(mach_header_64)) {
+        return false;
+    }
+
+    const symtab_command *symtab = nullptr;
+    const segment_command_64 *linkedit = nullptr;
+    bool hasBase = false;
+    size_t off = sizeof(mach_header_64);
+    auto end = off + mh->sizeofcmds;
+    for (UInt32 i = 0; i < mh->ncmds; i++) {
+        if (off + sizeof(load_command) > end) { return false; }
+        auto *lc = reinterpret_cast<const load_command *>(header + off);
+        if (lc->cmdsize < sizeof(load_command) || lc->cmdsize > end - off) { return false; }
+        if (lc->cmd == LC_SYMTAB && lc->cmdsize >= sizeof(symtab_command)) {
+            symtab = reinterpret_cast<const symtab_command *>(lc);
+        } else if (lc->cmd == LC_SEGMENT_64 && lc->cmdsize >= sizeof(segment_command_64)) {
+            auto *seg = reinterpret_cast<const segment_command_64 *>(lc);
+            if (!hasBase && seg->fileoff == 0 && seg->filesize != 0) {
+                this->base = seg->vmaddr;
+                hasBase = true;
+            }
+            if (!strncmp(seg->segname, SEG_LINKEDIT, sizeof(seg->segname))) { linkedit = seg; }
+        }
+        off += lc->cmdsize;
+    }
+
+    // In the kernel collections the symbol table lives in the collection's __LINKEDIT, not in the image.
+    if (!symtab || !linkedit || !hasBase || !symtab->nsyms || linkedit->vmaddr < this->base ||
+        symtab->symoff < linkedit->fileoff || symtab->stroff < linkedit->fileoff) {
+        return false;
+    }
+    auto linkeditOff = linkedit->vmaddr - this->base;
+    auto symOff = linkeditOff + (symtab->symoff - linkedit->fileoff);
+    auto strOff = linkeditOff + (symtab->stroff - linkedit->fileoff);
+    if (linkeditOff >= size || symOff > size || (size - symOff) / sizeof(nlist_64) < symtab->nsyms ||
+        strOff > size || size - strOff < symtab->strsize) {
+        return false;
+    }
+    this->symbols = reinterpret_cast<const nlist_64 *>(header + symOff);
+    this->strings = reinterpret_cast<const char *>(header + strOff);
+    this->stringsSize = symtab->strsize;
+
+    size_t defined = 0;
+    for (UInt32 i = 0; i < symtab->nsyms; i++) {
+        auto &sym = this->symbols[i];
+        if (!(sym.n_type & N_STAB) && (sym.n_type & N_TYPE) == N_SECT && sym.n_un.n_strx < this->stringsSize) {
+            defined += 1;
+        }
+    }
+    if (!defined) { return false; }
+
+    // At most half full, so that probe sequences stay short.
+    size_t capacity = 1;
+    while (capacity < defined * 2) { capacity <<= 1; }
+    this->hashes = Buffer::create<UInt32>(capacity * 2);
+    if (!this->hashes) { return false; }
+    this->slots = this->hashes + capacity;
+    memset(this->slots, 0, capacity * sizeof(UInt32));
+    this->mask = capacity - 1;
+
+    for (UInt32 i = 0; i < symtab->nsyms; i++) {
+        auto &sym = this->symbols[i];
+        if ((sym.n_type & N_STAB) || (sym.n_type & N_TYPE) != N_SECT || sym.n_un.n_strx >= this->stringsSize) {
+            continue;
+        }
+        auto *name = this->strings + sym.n_un.n_strx;
+        if (!memchr(name, 0, this->stringsSize - sym.n_un.n_strx)) { continue; }
+        auto hash = PatcherPlus::symbolHash(name);
+        auto slot = hash & this->mask;
+        while (this->slots[slot]) { slot = (slot + 1) & this->mask; }
+        this->hashes[slot] = hash;
+        this->slots[slot] = i + 1;
+    }
+
+    this->failed = false;
+    DBGLOG("Patcher+", "Indexed %zu of %u symbols of image at 0x%llX", defined, symtab->nsyms, address);
+    return true;
+}
+
+void SymbolIndex::release() {
+    if (this->hashes) { Buffer::deleter(this->hashes); }
+    *this = {};
+}
+
+mach_vm_address_t PatcherPlus::lookupSymbol(const char *symbol, UInt32 hash, mach_vm_address_t address,
+    size_t size) {
+    if (!symbol || !address) { return 0; }
+    if (symbolIndex.address != address || symbolIndex.size != size) { symbolIndex.build(address, size); }
+    if (symbolIndex.failed) { return 0; }
+
+    for (auto slot = hash & symbolIndex.mask; symbolIndex.slots[slot]; slot = (slot + 1) & symbolIndex.mask) {
+        if (symbolIndex.hashes[slot] != hash) { continue; }
+        auto &sym = symbolIndex.symbols[symbolIndex.slots[slot] - 1];
+        if (strcmp(symbolIndex.strings + sym.n_un.n_strx, symbol)) { continue; }
+        if (sym.n_value < symbolIndex.base || sym.n_value - symbolIndex.base >= size) { return 0; }
+        return address + (sym.n_value - symbolIndex.base);
+    }
+    return 0;
+}
+
+void PatcherPlus::releaseSymbolIndex() { symbolIndex.release(); }
+
+bool PatcherPlus::remapDisplacements(UInt8 *code, size_t size, const DisplacementFix *fixes, size_t fixCount) {
+    struct Site {
+        size_t offset;
+        size_t fix;
+    };
+    UInt32 found[MaxDisplacementFixes] {};
+    PANIC_COND(fixCount > MaxDisplacementFixes, "Patcher+", "Too many displacement fixes");
+    evector<Site> sites {};
+
+    for (size_t i = 0; i + 6 <= size;) {
+        // mod = 10 with a base register and no SIB byte, reg = 2 (call) or 4 (jmp).
+        auto modRM = code[i + 1];
+        auto reg = (modRM >> 3) & 7;
+        if (code[i] != 0xFF || (modRM >> 6) != 2 || (modRM & 7) == 4 || (reg != 2 && reg != 4)) {
+            i += 1;
+            continue;
+        }
+        UInt32 disp;
+        lilu_os_memcpy(&disp, code + i + 2, sizeof(disp));
+        for (size_t j = 0; j < fixCount; j++) {
+            if (fixes[j].from != disp) { continue; }
+            found[j] += 1;
+            if (found[j] <= fixes[j].count) {
+                Site site {.offset = i + 2, .fix = j};
+                PANIC_COND(!sites.push_back(site), "Patcher+", "Failed to allocate displacement sites");
+            }
+            break;
+        }
+        i += 6;
+    }
+
+    bool ret = true;
+    for (size_t j = 0; j < fixCount; j++) {
+        if (found[j] != 0) { continue; }
+        DBGLOG("Patcher+", "Displacement 0x%X not found", fixes[j].from);
+        ret = false;
+    }
+    if (ret) {
+        auto &transaction = KernelWriteTransaction::singleton();
+        for (size_t i = 0; i < sites.size(); i++) {
+            transaction.write(reinterpret_cast<UInt32 *>(code + sites[i].offset), fixes[sites[i].fix].to);
+        }
+    }
+    sites.deinit();
+    return ret;
+}
+
+static constexpr UInt64 SWARLow = 0x0101010101010101ULL;
+static constexpr UInt64 SWARHigh = 0x8080808080808080ULL;
+
+// Vector registers are not preserved for kext code, so the byte search works on 64-bit words instead.
+static size_t findByte(const UInt8 *data, size_t start, size_t end, UInt8 byte) {
+    auto broadcast = SWARLow * byte;
+    size_t i = start;
+    for (; i + sizeof(UInt64) <= end; i += sizeof(UInt64)) {
+        UInt64 word;
+        lilu_os_memcpy(&word, data + i, sizeof(word));
+        word ^= broadcast;
+        auto found = (word - SWARLow) & ~word & SWARHigh;
+        if (found) { return i + (__builtin_ctzll(found) >> 3); }
+    }
+    for (; i < end; i++) {
+        if (data[i] == byte) { return i; }
+    }
+    return end;
+}
+
+bool PatcherPlus::findPattern(const void *pattern, const void *patternMask, size_t patternSize, const void *data,
+    size_t dataSize, size_t *dataOffset) {
+    if (patternSize == 0 || dataSize < patternSize || *dataOffset > dataSize - patternSize) { return false; }
+
+    auto *pattern8 = static_cast<const UInt8 *>(pattern);
+    auto *mask8 = static_cast<const UInt8 *>(patternMask);
+    auto anchor = patternAnchor(pattern8, mask8, patternSize);
+    if (anchor == patternSize) {
+        return KernelPatcher::findPattern(pattern, patternMask, patternSize, data, dataSize, dataOffset);
+    }
+
+    auto *data8 = static_cast<const UInt8 *>(data);
+    auto anchorByte = pattern8[anchor];
+    size_t end = dataSize - patternSize + anchor + 1;
+    for (size_t i = *dataOffset + anchor; i < end; i++) {
+        i = findByte(data8, i, end, anchorByte);
+        if (i == end) { break; }
+        auto *candidate = data8 + i - anchor;
+        size_t j = 0;
+        if (mask8) {
+            while (j < patternSize && (candidate[j] & mask8[j]) == (pattern8[j] & mask8[j])) { j++; }
+        } else {
+            while (j < patternSize && candidate[j] == pattern8[j]) { j++; }
+        }
+        if (j == patternSize) {
+            *dataOffset = i - anchor;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool patternMatches(const UInt8 *pattern, const UInt8 *patternMask, size_t patternSize, const UInt8 *data) {
+    if (!patternMask) { return !memcmp(data, pattern, patternSize); }
+    for (size_t i = 0; i < patternSize; i++) {
+        if ((data[i] & patternMask[i]) != (pattern[i] & patternMask[i])) { return false; }
+    }
+    return true;
+}
+
+static bool rangesContain(const PatcherPlus::Range *ranges, size_t count, size_t offset, size_t size) {
+    for (size_t i = 0; i < count; i++) {
+        if (offset >= ranges[i].offset && offset + size <= ranges[i].offset + ranges[i].size) { return true; }
+    }
+    return false;
+}
+
+bool PatcherPlus::findPattern(Section section, const void *pattern, const void *patternMask, size_t patternSize,
+    mach_vm_address_t address, size_t size, size_t *offset) {
+    Range ranges[ImageSections::MaxRanges];
+    auto count = getRanges(section, address, size, ranges, arrsize(ranges));
+
+    auto *pattern8 = static_cast<const UInt8 *>(pattern);
+    auto *mask8 = static_cast<const UInt8 *>(patternMask);
+    auto *image = ImageSections::get(address, size);
+    auto &cache = OffsetCache::singleton();
+    bool useCache = image && image->hasUUID && cache.isEnabled();
+    UInt32 key = 0;
+    if (useCache) {
+        key = fnv1a(pattern8, patternSize, 'S');
+        if (mask8) { key = fnv1a(mask8, patternSize, key); }
+        key = fnv1a(&section, sizeof(section), key);
+        size_t cached = 0;
+        auto *entry = cache.lookup(image->uuid, key, cached);
+        if (cached == 1 && rangesContain(ranges, count, entry->offset, patternSize) &&
+            patternMatches(pattern8, mask8, patternSize, reinterpret_cast<const UInt8 *>(address + entry->offset))) {
+            PatchTelemetry::singleton().scanned(patternSize);
+            *offset = entry->offset;
+            return true;
+        }
+    }
+
+    auto &telemetry = PatchTelemetry::singleton();
+    for (size_t i = 0; i < count; i++) {
+        size_t rangeOffset = 0;
+        if (findPattern(pattern, patternMask, patternSize, reinterpret_cast<const void *>(address + ranges[i].offset),
+                ranges[i].size, &rangeOffset)) {
+            telemetry.scanned(rangeOffset + patternSize);
+            *offset = ranges[i].offset + rangeOffset;
+            if (useCache) { cache.update(image->uuid, key, offset, 1); }
+            return true;
+        }
+        telemetry.scanned(ranges[i].size);
+    }
+    if (useCache) { cache.update(image->uuid, key, nullptr, 0); }
+    return false;
+}
+
+// Telemetry key of a request: the hash of its symbol, or of its pattern if it has none.
+static UInt32 requestKey(const char *symbol, const UInt8 *pattern, size_t patternSize) {
+    if (symbol) { return PatcherPlus::symbolHash(symbol); }
+    return pattern ? fnv1a(pattern, patternSize) : 0;
+}
 
 bool SolveRequestPlus::solve(KernelPatcher &patcher, size_t id, mach_vm_address_t address, size_t maxSize) {
     PANIC_COND(!this->address, "Patcher+", "this->address is null");
 
+    auto &telemetry = PatchTelemetry::singleton();
+    auto scope = telemetry.begin();
+    auto key = requestKey(this->symbol, this->pattern, this->patternSize);
     if (this->symbol != nullptr) {
-        *this->address = patcher.solveSymbol(id, this->symbol);
-        if (*this->address) { return true; }
+        *this->address = PatcherPlus::lookupSymbol(this->symbol, key, address, maxSize);
+        if (*this->address) {
+            telemetry.record(scope, id, PatchKind::Solve, PatchMethod::Index, key, 1);
+            return true;
+        }
+        *this->address = patcher.solveSymbol(id, this->symbol, address, maxSize);
+        if (*this->address) {
+            telemetry.record(scope, id, PatchKind::Solve, PatchMethod::Symbol, key, 1);
+            return true;
+        }
         patcher.clearError();
     }
 
     if (!this->pattern || !this->patternSize) {
         DBGLOG("Patcher+", "Failed to solve %s using symbol", safeString(this->symbol));
+        telemetry.record(scope, id, PatchKind::Solve, PatchMethod::Failed, key, 0);
         return false;
     }
 
     size_t offset = 0;
-    if (!KernelPatcher::findPattern(this->pattern, this->mask, this->patternSize,
-            reinterpret_cast<const void *>(address), maxSize, &offset) ||
+    if (!PatcherPlus::findPattern(this->section, this->pattern, this->mask, this->patternSize, address, maxSize,
+            &offset) ||
         !offset) {
         DBGLOG("Patcher+", "Failed to solve %s using pattern", safeString(this->symbol));
+        telemetry.record(scope, id, PatchKind::Solve, PatchMethod::Failed, key, 0);
         return false;
     }
 
     *this->address = address + offset;
+    telemetry.record(scope, id, PatchKind::Solve, PatchMethod::Pattern, key, 1);
     return true;
 }
 
@@ -38,61 +509,662 @@ bool SolveRequestPlus::solveAll(KernelPatcher &patcher, size_t id, SolveRequestP
 }
 
 bool RouteRequestPlus::route(KernelPatcher &patcher, size_t id, mach_vm_address_t address, size_t maxSize) {
+    auto &telemetry = PatchTelemetry::singleton();
+    auto scope = telemetry.begin();
     if (this->symbol != nullptr) {
-        if (patcher.routeMultiple(id, this, 1, address, maxSize)) { return true; }
+        auto from = PatcherPlus::lookupSymbol(this->symbol, PatcherPlus::symbolHash(this->symbol), address, maxSize);
+        if (from) { return this->report(scope, id, this->routeAt(patcher, from, "symbol"), PatchMethod::Index); }
+        if (patcher.routeMultiple(id, this, 1, address, maxSize)) {
+            return this->report(scope, id, true, PatchMethod::Symbol);
+        }
         patcher.clearError();
     }
 
+    return this->report(scope, id, this->routeByPattern(patcher, address, maxSize), PatchMethod::Pattern);
+}
+
+bool RouteRequestPlus::report(const PatchTelemetry::Scope &scope, size_t id, bool routed, PatchMethod method) const {
+    PatchTelemetry::singleton().record(scope, id, PatchKind::Route, routed ? method : PatchMethod::Failed,
+        requestKey(this->symbol, this->pattern, this->patternSize), routed ? 1 : 0);
+    return routed;
+}
+
+bool RouteRequestPlus::routeAt(KernelPatcher &patcher, mach_vm_address_t from, const char *method) {
+    auto org = patcher.routeFunction(from, this->to, true);
+    if (!org) {
+        DBGLOG("Patcher+", "Failed to route %s using %s: %d", safeString(this->symbol), method, patcher.getError());
+        return false;
+    }
+    if (this->org) { *this->org = org; }
+
+    return true;
+}
+
+bool RouteRequestPlus::routeByPattern(KernelPatcher &patcher, mach_vm_address_t address, size_t maxSize) {
     if (!this->pattern || !this->patternSize) {
         DBGLOG("Patcher+", "Failed to route %s using symbol", safeString(this->symbol));
         return false;
     }
 
     size_t offset = 0;
-    if (!KernelPatcher::findPattern(this->pattern, this->mask, this->patternSize,
-            reinterpret_cast<const void *>(address), maxSize, &offset) ||
+    if (!PatcherPlus::findPattern(this->section, this->pattern, this->mask, this->patternSize, address, maxSize,
+            &offset) ||
         !offset) {
         DBGLOG("Patcher+", "Failed to route %s using pattern", safeString(this->symbol));
         return false;
     }
 
-    auto org = patcher.routeFunction(address + offset, this->to, true);
-    if (!org) {
-        DBGLOG("Patcher+", "Failed to route %s using pattern: %d", safeString(this->symbol), patcher.getError());
+    return this->routeAt(patcher, address + offset, "pattern");
+}
+
+// Symbols found in the symbol index are routed directly. The other requests with a symbol are routed by a single
+// `routeMultiple` call, which skips the symbols it cannot solve and routes the rest. Only when that call fails are
+// those requests checked one by one, to route the unsolved ones by pattern.
+bool RouteRequestPlus::routeAll(KernelPatcher &patcher, size_t id, RouteRequestPlus *requests, size_t count,
+    mach_vm_address_t address, size_t maxSize) {
+    auto &telemetry = PatchTelemetry::singleton();
+    bool ret = true;
+    evector<KernelPatcher::RouteRequest> symbolRequests {};
+    evector<size_t> symbolRequestIndices {};
+    for (size_t i = 0; i < count; i++) {
+        auto &request = requests[i];
+        if (request.symbol == nullptr) { continue; }
+        auto scope = telemetry.begin();
+        auto from =
+            PatcherPlus::lookupSymbol(request.symbol, PatcherPlus::symbolHash(request.symbol), address, maxSize);
+        if (from) {
+            if (!request.report(scope, id, request.routeAt(patcher, from, "symbol"), PatchMethod::Index)) {
+                ret = false;
+            }
+            continue;
+        }
+        if (request.org) { *request.org = 0; }
+        KernelPatcher::RouteRequest symbolRequest = request;
+        PANIC_COND(!symbolRequests.push_back(symbolRequest) || !symbolRequestIndices.push_back(i), "Patcher+",
+            "Failed to allocate route requests");
+    }
+
+    bool symbolsRouted = symbolRequests.size() == 0;
+    if (!symbolsRouted) {
+        auto scope = telemetry.begin();
+        symbolsRouted = patcher.routeMultiple(id, symbolRequests.data(), symbolRequests.size(), address, maxSize);
+        if (!symbolsRouted) { patcher.clearError(); }
+        telemetry.record(scope, id, PatchKind::Route, PatchMethod::Batch, 0, symbolRequests.size());
+    }
+    symbolRequests.deinit();
+
+    for (size_t i = 0; i < symbolRequestIndices.size(); i++) {
+        auto &request = requests[symbolRequestIndices[i]];
+        auto scope = telemetry.begin();
+        // Without an original to check, a request is taken to be routed if its symbol can be solved.
+        bool routed = symbolsRouted || (request.org ? *request.org != 0 :
+                                                      patcher.solveSymbol(id, request.symbol, address, maxSize) != 0);
+        patcher.clearError();
+        if (routed) {
+            request.report(scope, id, true, PatchMethod::Symbol);
+        } else if (!request.report(scope, id, request.routeByPattern(patcher, address, maxSize),
+                       PatchMethod::Pattern)) {
+            ret = false;
+        }
+    }
+    symbolRequestIndices.deinit();
+
+    for (size_t i = 0; i < count; i++) {
+        if (requests[i].symbol != nullptr) { continue; }
+        auto scope = telemetry.begin();
+        if (!requests[i].report(scope, id, requests[i].routeByPattern(patcher, address, maxSize),
+                PatchMethod::Pattern)) {
+            ret = false;
+        }
+    }
+    return ret;
+}
+
+// Matches are collected for the whole batch in one linear scan; every patch is bucketed by the most selective byte
+// of its pattern (its anchor). Replacements are then staged in batch order and matched through, so that the result is
+// identical to applying the patches one by one, and written in a single window at the end.
+struct LookupPatchState {
+    size_t anchor {0};
+    evector<size_t> matches {};
+    evector<size_t> extra {};
+    evector<size_t> replaced {};
+};
+
+struct LookupPatchBatch {
+    const LookupPatchPlus *patches;
+    LookupPatchState *states;
+    size_t count;
+    UInt8 *data;
+    size_t maxSize;
+    PatcherPlus::Range ranges[3][PatcherPlus::ImageSections::MaxRanges];
+    size_t rangeCount[3];
+    KernelWriteTransaction *staged;
+    UInt8 *scratch;
+
+    bool inSection(size_t index, size_t pos) const {
+        auto &patch = this->patches[index];
+        auto section = static_cast<size_t>(patch.section);
+        for (size_t i = 0; i < this->rangeCount[section]; i++) {
+            auto &range = this->ranges[section][i];
+            if (pos >= range.offset && pos + patch.size <= range.offset + range.size) { return true; }
+        }
         return false;
     }
-    if (this->org) { *this->org = org; }
+};
+
+static bool lookupPatchMatches(const LookupPatchPlus &patch, const UInt8 *data) {
+    return patternMatches(patch.find, patch.findMask, patch.size, data);
+}
+
+static size_t lookupPatchAnchor(const LookupPatchPlus &patch) {
+    auto anchor = PatcherPlus::patternAnchor(patch.find, patch.findMask, patch.size);
+    if (anchor != patch.size || !patch.findMask) { return anchor; }
+    anchor = 0;
+    for (size_t i = 1; i < patch.size && patch.findMask[anchor] != 0xFF; i++) {
+        if (__builtin_popcount(patch.findMask[i]) > __builtin_popcount(patch.findMask[anchor])) { anchor = i; }
+    }
+    return anchor;
+}
+
+// `scratch` holds the largest pattern of the batch.
+static bool lookupPatchMatchesStaged(const LookupPatchPlus &patch, const UInt8 *data,
+    const KernelWriteTransaction &staged, UInt8 *scratch) {
+    return lookupPatchMatches(patch, staged.read(data, patch.size, scratch));
+}
 
+static void lookupPatchStage(const LookupPatchPlus &patch, UInt8 *data, KernelWriteTransaction &staged,
+    UInt8 *scratch) {
+    if (!patch.replaceMask) {
+        staged.write(data, patch.replace, patch.size);
+        return;
+    }
+    auto *current = staged.read(data, patch.size, scratch);
+    if (current != scratch) { lilu_os_memcpy(scratch, current, patch.size); }
+    for (size_t i = 0; i < patch.size; i++) {
+        scratch[i] = (scratch[i] & ~patch.replaceMask[i]) | (patch.replace[i] & patch.replaceMask[i]);
+    }
+    staged.write(data, scratch, patch.size);
+}
+
+// A replacement may create matches for the patches after it, which the initial scan could not see.
+static void lookupPatchRescan(LookupPatchBatch &batch, size_t index, size_t offset, size_t size) {
+    for (size_t i = index + 1; i < batch.count; i++) {
+        auto &patch = batch.patches[i];
+        if (patch.size == 0 || patch.size > batch.maxSize) { continue; }
+        size_t start = offset >= patch.size - 1 ? offset - patch.size + 1 : 0;
+        size_t last = batch.maxSize - patch.size + 1;
+        size_t end = offset + size < last ? offset + size : last;
+        for (size_t pos = start; pos < end; pos++) {
+            if (lookupPatchMatchesStaged(patch, batch.data + pos, *batch.staged, batch.scratch) &&
+                batch.inSection(i, pos)) {
+                PANIC_COND(!batch.states[i].extra.push_back(pos), "Patcher+", "Failed to record match");
+            }
+        }
+    }
+}
+
+// Adds `range` to the sorted, disjoint `ranges`, merging it with every range it overlaps or touches.
+static void mergeRange(PatcherPlus::Range *ranges, size_t &count, const PatcherPlus::Range &range) {
+    size_t start = range.offset, end = range.offset + range.size;
+    size_t first = 0;
+    while (first < count && ranges[first].offset + ranges[first].size < start) { first++; }
+    size_t last = first;
+    for (; last < count && ranges[last].offset <= end; last++) {
+        if (ranges[last].offset < start) { start = ranges[last].offset; }
+        if (ranges[last].offset + ranges[last].size > end) { end = ranges[last].offset + ranges[last].size; }
+    }
+    if (last == first) {
+        for (size_t i = count; i > first; i--) { ranges[i] = ranges[i - 1]; }
+        count += 1;
+    } else {
+        for (size_t i = last; i < count; i++) { ranges[i - (last - first) + 1] = ranges[i]; }
+        count -= last - first - 1;
+    }
+    ranges[first] = {start, end - start};
+}
+
+static bool lookupPatchCollect(LookupPatchBatch &batch) {
+    auto *bucketStart = Buffer::create<UInt32>(257 + 256);
+    if (!bucketStart) { return false; }
+    auto *fill = bucketStart + 257;
+    memset(bucketStart, 0, 257 * sizeof(UInt32));
+
+    bool scanSection[3] {};
+    for (size_t i = 0; i < batch.count; i++) {
+        auto &patch = batch.patches[i];
+        batch.states[i].anchor = lookupPatchAnchor(patch);
+        if (patch.size == 0 || patch.size > batch.maxSize) { continue; }
+        scanSection[static_cast<size_t>(patch.section)] = true;
+        UInt8 mask = patch.findMask ? patch.findMask[batch.states[i].anchor] : 0xFF;
+        UInt8 value = patch.find[batch.states[i].anchor] & mask;
+        for (size_t b = 0; b < 256; b++) {
+            if ((b & mask) == value) { bucketStart[b + 1] += 1; }
+        }
+    }
+    for (size_t b = 0; b < 256; b++) { bucketStart[b + 1] += bucketStart[b]; }
+
+    auto *buckets = Buffer::create<UInt32>(bucketStart[256]);
+    if (!buckets) {
+        Buffer::deleter(bucketStart);
+        return false;
+    }
+    lilu_os_memcpy(fill, bucketStart, 256 * sizeof(UInt32));
+    for (size_t i = 0; i < batch.count; i++) {
+        auto &patch = batch.patches[i];
+        if (patch.size == 0 || patch.size > batch.maxSize) { continue; }
+        UInt8 mask = patch.findMask ? patch.findMask[batch.states[i].anchor] : 0xFF;
+        UInt8 value = patch.find[batch.states[i].anchor] & mask;
+        for (size_t b = 0; b < 256; b++) {
+            if ((b & mask) == value) { buckets[fill[b]++] = static_cast<UInt32>(i); }
+        }
+    }
+
+    // Only walk the sections that some patch of the batch can be in, and each byte once: code and data ranges
+    // overlap when `addSectionRange` ran out of slots.
+    if (scanSection[static_cast<size_t>(PatcherPlus::Section::Any)]) {
+        scanSection[static_cast<size_t>(PatcherPlus::Section::Code)] = false;
+        scanSection[static_cast<size_t>(PatcherPlus::Section::Data)] = false;
+    }
+    PatcherPlus::Range scan[2 * PatcherPlus::ImageSections::MaxRanges];
+    size_t scanCount = 0;
+    for (size_t section = 0; section < 3; section++) {
+        if (!scanSection[section]) { continue; }
+        for (size_t r = 0; r < batch.rangeCount[section]; r++) {
+            mergeRange(scan, scanCount, batch.ranges[section][r]);
+        }
+    }
+    for (size_t r = 0; r < scanCount; r++) {
+        auto &range = scan[r];
+        PatchTelemetry::singleton().scanned(range.size);
+        for (size_t off = range.offset; off < range.offset + range.size; off++) {
+            auto byte = batch.data[off];
+            for (UInt32 j = bucketStart[byte]; j < bucketStart[byte + 1]; j++) {
+                auto i = buckets[j];
+                auto &patch = batch.patches[i];
+                if (off < batch.states[i].anchor) { continue; }
+                size_t pos = off - batch.states[i].anchor;
+                if (pos + patch.size > batch.maxSize || !lookupPatchMatches(patch, batch.data + pos) ||
+                    !batch.inSection(i, pos)) {
+                    continue;
+                }
+                PANIC_COND(!batch.states[i].matches.push_back(pos), "Patcher+", "Failed to record match");
+            }
+        }
+    }
+
+    Buffer::deleter(buckets);
+    Buffer::deleter(bucketStart);
     return true;
 }
 
-bool RouteRequestPlus::routeAll(KernelPatcher &patcher, size_t id, RouteRequestPlus *requests, size_t count,
-    mach_vm_address_t address, size_t maxSize) {
+static void lookupPatchSortExtra(evector<size_t> &extra) {
+    for (size_t i = 1; i < extra.size(); i++) {
+        for (size_t j = i; j > 0 && extra[j - 1] > extra[j]; j--) {
+            auto tmp = extra[j];
+            extra[j] = extra[j - 1];
+            extra[j - 1] = tmp;
+        }
+    }
+}
+
+// Same semantics as `KernelPatcher::applyLookupPatch` (exact count, overlapping matches are rechecked) when there are
+// neither masks nor skips, and as `KernelPatcher::findAndReplaceWithMask` (at least one replacement) otherwise.
+static bool lookupPatchApply(LookupPatchBatch &batch, size_t index) {
+    auto &patch = batch.patches[index];
+    auto &state = batch.states[index];
+    bool exact = !patch.findMask && !patch.replaceMask && !patch.skip;
+    size_t skip = patch.skip;
+    size_t replaced = 0;
+    size_t next = 0;
+
+    lookupPatchSortExtra(state.extra);
+    size_t i = 0, j = 0;
+    while (i < state.matches.size() || j < state.extra.size()) {
+        size_t pos;
+        if (j == state.extra.size() || (i < state.matches.size() && state.matches[i] <= state.extra[j])) {
+            pos = state.matches[i++];
+        } else {
+            pos = state.extra[j++];
+        }
+        if (pos < next || !lookupPatchMatchesStaged(patch, batch.data + pos, *batch.staged, batch.scratch)) {
+            continue;
+        }
+        if (skip) {
+            skip -= 1;
+            next = pos + patch.size;
+            continue;
+        }
+        lookupPatchStage(patch, batch.data + pos, *batch.staged, batch.scratch);
+        lookupPatchRescan(batch, index, pos, patch.size);
+        PANIC_COND(!state.replaced.push_back(pos), "Patcher+", "Failed to record replacement");
+        replaced += 1;
+        next = pos + patch.size;
+        if (replaced == patch.count) { break; }
+        if (!exact) { continue; }
+        for (size_t off = pos + 1; off < next && off + patch.size <= batch.maxSize; off++) {
+            if (!lookupPatchMatchesStaged(patch, batch.data + off, *batch.staged, batch.scratch) ||
+                !batch.inSection(index, off)) {
+                continue;
+            }
+            lookupPatchStage(patch, batch.data + off, *batch.staged, batch.scratch);
+            lookupPatchRescan(batch, index, off, patch.size);
+            PANIC_COND(!state.replaced.push_back(off), "Patcher+", "Failed to record replacement");
+            replaced += 1;
+            next = off + patch.size;
+            if (replaced == patch.count) { break; }
+        }
+        if (replaced == patch.count) { break; }
+    }
+
+    if (exact) { return replaced == patch.count; }
+    return replaced > 0;
+}
+
+static void lookupPatchReport(const PatchTelemetry::Scope &scope, const LookupPatchPlus &patch, PatchMethod method,
+    size_t matches) {
+    auto &telemetry = PatchTelemetry::singleton();
+    size_t kext = patch.kext ? patch.kext->loadIndex : KernelPatcher::KextInfo::Unloaded;
+    if (patch.kext) { telemetry.nameKext(kext, patch.kext->id); }
+    telemetry.record(scope, kext, PatchKind::Lookup, method, fnv1a(patch.find, patch.size), matches);
+}
+
+static UInt32 lookupPatchKey(const LookupPatchPlus &patch) {
+    auto key = fnv1a(patch.find, patch.size, 'L');
+    if (patch.findMask) { key = fnv1a(patch.findMask, patch.size, key); }
+    key = fnv1a(patch.replace, patch.size, key);
+    if (patch.replaceMask) { key = fnv1a(patch.replaceMask, patch.size, key); }
+    size_t params[] = {patch.size, patch.count, patch.skip, static_cast<size_t>(patch.section)};
+    return fnv1a(params, sizeof(params), key);
+}
+
+// Replays the offsets recorded for each patch on a previous boot of the same kext, in batch order, into `staged`.
+// Stops at the first patch whose offsets are missing or no longer match, and returns its index.
+static size_t lookupPatchApplyCached(const LookupPatchPlus *patches, size_t count, mach_vm_address_t address,
+    size_t maxSize, const PatcherPlus::ImageSections &image, KernelWriteTransaction &staged, UInt8 *scratch,
+    bool verbose) {
+    PatcherPlus::Range ranges[3][PatcherPlus::ImageSections::MaxRanges];
+    size_t rangeCount[3];
+    for (size_t section = 0; section < 3; section++) {
+        rangeCount[section] = PatcherPlus::getRanges(static_cast<PatcherPlus::Section>(section), address, maxSize,
+            ranges[section], PatcherPlus::ImageSections::MaxRanges);
+    }
+
+    auto &cache = OffsetCache::singleton();
+    auto &telemetry = PatchTelemetry::singleton();
+    auto *data = reinterpret_cast<UInt8 *>(address);
     for (size_t i = 0; i < count; i++) {
-        if (!requests[i].route(patcher, id, address, maxSize)) { return false; }
+        auto &patch = patches[i];
+        auto scope = telemetry.begin();
+        auto section = static_cast<size_t>(patch.section);
+        size_t cached = 0;
+        auto *entries = cache.lookup(image.uuid, lookupPatchKey(patch), cached);
+        bool exact = !patch.findMask && !patch.replaceMask && !patch.skip;
+        if (!cached || (exact && cached != patch.count) || (patch.count && cached > patch.count)) { return i; }
+        // Offsets are recorded in replacement order. Overlapping ones depend on the earlier replacement, so those
+        // patches are always rescanned.
+        size_t end = 0;
+        for (size_t j = 0; j < cached; j++) {
+            auto offset = entries[j].offset;
+            if (offset < end || !rangesContain(ranges[section], rangeCount[section], offset, patch.size) ||
+                !lookupPatchMatchesStaged(patch, data + offset, staged, scratch)) {
+                return i;
+            }
+            end = offset + patch.size;
+        }
+        for (size_t j = 0; j < cached; j++) { lookupPatchStage(patch, data + entries[j].offset, staged, scratch); }
+        telemetry.scanned(cached * patch.size);
+        lookupPatchReport(scope, patch, PatchMethod::Cache, cached);
+        DBGLOG_COND(verbose, "Patcher+", "Applied patches[%zu] at %zu cached offsets", i, cached);
     }
-    return true;
+    return count;
+}
+
+static bool lookupPatchApplyDirect(KernelPatcher &patcher, const LookupPatchPlus &patch, mach_vm_address_t address,
+    size_t maxSize) {
+    auto scope = PatchTelemetry::singleton().begin();
+    PatchTelemetry::singleton().scanned(maxSize);
+    bool applied;
+    if (!patch.findMask && !patch.replaceMask && !patch.skip) {
+        patcher.applyLookupPatch(&patch, reinterpret_cast<UInt8 *>(address), maxSize);
+        applied = patcher.getError() == KernelPatcher::Error::NoError;
+    } else {
+        applied = KernelPatcher::findAndReplaceWithMask(reinterpret_cast<UInt8 *>(address), maxSize, patch.find,
+            patch.size, patch.findMask, patch.findMask ? patch.size : 0, patch.replace, patch.size, patch.replaceMask,
+            patch.replaceMask ? patch.size : 0, patch.count, patch.skip);
+    }
+    // Lilu does not report how many matches were replaced.
+    lookupPatchReport(scope, patch, applied ? PatchMethod::Pattern : PatchMethod::Failed, applied ? patch.count : 0);
+    return applied;
+}
+
+static bool lookupPatchApplyBatch(KernelPatcher &patcher, const LookupPatchPlus *patches, size_t count,
+    mach_vm_address_t address, size_t maxSize, bool force, bool verbose) {
+    size_t scratchSize = 1;
+    for (size_t i = 0; i < count; i++) {
+        if (patches[i].size > scratchSize) { scratchSize = patches[i].size; }
+    }
+    auto *scratch = Buffer::create<UInt8>(scratchSize);
+    PANIC_COND(scratch == nullptr, "Patcher+", "Failed to allocate lookup patch scratch");
+
+    auto *image = PatcherPlus::ImageSections::get(address, maxSize);
+    bool useCache = image && image->hasUUID && OffsetCache::singleton().isEnabled();
+    // Written here rather than through the shared transaction, which is only committed once every module is done with
+    // the kext. That reorders nothing: the shared transaction holds data table writes, which lookup patches do not
+    // target in the kexts that queue them, and the X6000 call site fixes, queued after its last lookup patch.
+    KernelWriteTransaction staged {};
+    size_t first = useCache ? lookupPatchApplyCached(patches, count, address, maxSize, *image, staged, scratch,
+                                  verbose) :
+                              0;
+    // The scan reads the image itself, so whatever was replayed from the cache is written first. It is undone if a
+    // later patch of the batch fails, so a failed batch leaves the image as it found it.
+    bool committed = staged.commit(true);
+    if (first == count || !committed) {
+        staged.discard();
+        staged.release();
+        Buffer::deleter(scratch);
+        return committed;
+    }
+    patches += first;
+    count -= first;
+
+    auto scope = PatchTelemetry::singleton().begin();
+    auto *batch = new LookupPatchBatch {};
+    auto *states = batch ? new LookupPatchState[count] : nullptr;
+    if (states) {
+        batch->patches = patches;
+        batch->states = states;
+        batch->count = count;
+        batch->data = reinterpret_cast<UInt8 *>(address);
+        batch->maxSize = maxSize;
+        batch->staged = &staged;
+        batch->scratch = scratch;
+        for (size_t section = 0; section < 3; section++) {
+            batch->rangeCount[section] = PatcherPlus::getRanges(static_cast<PatcherPlus::Section>(section), address,
+                maxSize, batch->ranges[section], PatcherPlus::ImageSections::MaxRanges);
+        }
+        if (!lookupPatchCollect(*batch)) {
+            delete[] states;
+            states = nullptr;
+        }
+    }
+    if (states) { lookupPatchReport(scope, patches[0], PatchMethod::Batch, count); }
+
+    bool ret = true;
+    for (size_t i = 0; i < count; i++) {
+        scope = PatchTelemetry::singleton().begin();
+        bool applied =
+            states ? lookupPatchApply(*batch, i) : lookupPatchApplyDirect(patcher, patches[i], address, maxSize);
+        if (states) {
+            lookupPatchReport(scope, patches[i], applied ? PatchMethod::Pattern : PatchMethod::Failed,
+                states[i].replaced.size());
+        }
+        if (states && useCache) {
+            auto &replaced = states[i].replaced;
+            OffsetCache::singleton().update(image->uuid, lookupPatchKey(patches[i]),
+                replaced.size() ? &replaced[0] : nullptr, applied ? replaced.size() : 0);
+        }
+        if (applied) {
+            DBGLOG_COND(verbose, "Patcher+", "Applied patches[%zu]", first + i);
+        } else {
+            DBGLOG_COND(verbose, "Patcher+", "Failed to apply patches[%zu]", first + i);
+            if (!force) {
+                ret = false;
+                break;
+            }
+        }
+    }
+
+    if (!ret || !staged.commit()) {
+        staged.discard();
+        PANIC_COND(!staged.rollback(), "Patcher+", "Failed to roll back a failed lookup patch batch");
+        ret = false;
+    }
+    staged.release();
+
+    if (states) {
+        for (size_t i = 0; i < count; i++) {
+            states[i].matches.deinit();
+            states[i].extra.deinit();
+            states[i].replaced.deinit();
+        }
+        delete[] states;
+    }
+    delete batch;
+    Buffer::deleter(scratch);
+    return ret;
 }
 
 bool LookupPatchPlus::apply(KernelPatcher &patcher, mach_vm_address_t address, size_t maxSize) const {
-    if (!this->findMask && !this->replaceMask && !this->skip) {
-        patcher.applyLookupPatch(this, reinterpret_cast<UInt8 *>(address), maxSize);
-        return patcher.getError() == KernelPatcher::Error::NoError;
+    if (PatcherPlus::ImageSections::get(address, maxSize)) {
+        return lookupPatchApplyBatch(patcher, this, 1, address, maxSize, false, false);
     }
-    return KernelPatcher::findAndReplaceWithMask(reinterpret_cast<UInt8 *>(address), maxSize, this->find, this->size,
-        this->findMask, this->findMask ? this->size : 0, this->replace, this->size, this->replaceMask,
-        this->replaceMask ? this->size : 0, this->count, this->skip);
+    return lookupPatchApplyDirect(patcher, *this, address, maxSize);
 }
 
 bool LookupPatchPlus::applyAll(KernelPatcher &patcher, const LookupPatchPlus *patches, size_t count,
     mach_vm_address_t address, size_t maxSize, bool force) {
-    for (size_t i = 0; i < count; i++) {
-        if (patches[i].apply(patcher, address, maxSize)) {
-            DBGLOG("Patcher+", "Applied patches[%zu]", i);
-        } else {
-            DBGLOG("Patcher+", "Failed to apply patches[%zu]", i);
-            if (!force) { return false; }
+    if (count == 1) {
+        bool applied = patches[0].apply(patcher, address, maxSize);
+        DBGLOG_COND(applied, "Patcher+", "Applied patches[0]");
+        DBGLOG_COND(!applied, "Patcher+", "Failed to apply patches[0]");
+        return applied || force;
+    }
+    return lookupPatchApplyBatch(patcher, patches, count, address, maxSize, force, true);
+}
+
+static KernelWriteTransaction transaction {};
+
+KernelWriteTransaction &KernelWriteTransaction::singleton() { return transaction; }
+
+UInt8 *KernelWriteTransaction::reserve(size_t size) {
+    if (this->dataSize + size > this->dataCapacity) {
+        auto capacity = this->dataCapacity ? this->dataCapacity * 2 : 256;
+        while (capacity < this->dataSize + size) { capacity *= 2; }
+        PANIC_COND(!Buffer::resize(this->data, capacity), "Patcher+", "Failed to queue write");
+        this->dataCapacity = capacity;
+    }
+    auto *ret = this->data + this->dataSize;
+    this->dataSize += size;
+    return ret;
+}
+
+void KernelWriteTransaction::write(void *dest, const void *src, size_t size) {
+    PANIC_COND(dest == nullptr, "Patcher+", "Queued write to null");
+    if (!size) { return; }
+    Write write {.dest = static_cast<UInt8 *>(dest), .size = size, .data = this->dataSize};
+    lilu_os_memcpy(this->reserve(size), src, size);
+    PANIC_COND(!this->writes.push_back(write), "Patcher+", "Failed to queue write");
+}
+
+void KernelWriteTransaction::fill(void *dest, UInt8 value, size_t size) {
+    PANIC_COND(dest == nullptr, "Patcher+", "Queued write to null");
+    if (!size) { return; }
+    Write write {.dest = static_cast<UInt8 *>(dest), .size = size, .data = this->dataSize};
+    memset(this->reserve(size), value, size);
+    PANIC_COND(!this->writes.push_back(write), "Patcher+", "Failed to queue write");
+}
+
+const UInt8 *KernelWriteTransaction::read(const UInt8 *src, size_t size, UInt8 *scratch) const {
+    const UInt8 *ret = src;
+    // Later writes win, as they do when committed.
+    for (size_t i = 0; i < this->writes.size(); i++) {
+        auto &write = this->writes[i];
+        auto *start = write.dest > src ? write.dest : src;
+        auto *end = write.dest + write.size < src + size ? write.dest + write.size : src + size;
+        if (start >= end) { continue; }
+        if (ret == src) {
+            lilu_os_memcpy(scratch, src, size);
+            ret = scratch;
         }
+        lilu_os_memcpy(scratch + (start - src), this->data + write.data + (start - write.dest), end - start);
+    }
+    return ret;
+}
+
+bool KernelWriteTransaction::commit(bool keepUndo) {
+    if (!this->writes.size()) { return true; }
+
+    // Nothing may allocate once interrupts are off, so the previous contents are saved before the window opens.
+    if (keepUndo) {
+        PANIC_COND(!Buffer::resize(this->undo, this->undoSize + this->dataSize), "Patcher+",
+            "Failed to allocate the undo log");
+        for (size_t i = 0; i < this->writes.size(); i++) {
+            auto write = this->writes[i];
+            write.data += this->undoSize;
+            lilu_os_memcpy(this->undo + write.data, write.dest, write.size);
+            PANIC_COND(!this->undoWrites.push_back(write), "Patcher+", "Failed to allocate the undo log");
+        }
+        this->undoSize += this->dataSize;
+    }
+
+    if (MachInfo::setKernelWriting(true, KernelPatcher::kernelWriteLock) != KERN_SUCCESS) {
+        SYSLOG("Patcher+", "Failed to obtain write permissions");
+        return false;
     }
+    for (size_t i = 0; i < this->writes.size(); i++) {
+        auto &write = this->writes[i];
+        lilu_os_memcpy(write.dest, this->data + write.data, write.size);
+    }
+    if (MachInfo::setKernelWriting(false, KernelPatcher::kernelWriteLock) != KERN_SUCCESS) {
+        SYSLOG("Patcher+", "Failed to restore write permissions");
+    }
+
+    DBGLOG("Patcher+", "Committed %zu writes (%zu bytes)", this->writes.size(), this->dataSize);
+    this->discard();
+    return true;
+}
+
+void KernelWriteTransaction::discard() {
+    this->writes.deinit();
+    if (this->data) { Buffer::deleter(this->data); }
+    this->data = nullptr;
+    this->dataSize = this->dataCapacity = 0;
+}
+
+bool KernelWriteTransaction::rollback() {
+    if (!this->undoWrites.size()) { return true; }
+
+    if (MachInfo::setKernelWriting(true, KernelPatcher::kernelWriteLock) != KERN_SUCCESS) {
+        SYSLOG("Patcher+", "Failed to obtain write permissions");
+        return false;
+    }
+    // Each write saved the contents from before its commit, so overlapping writes end up with the oldest contents.
+    for (size_t i = this->undoWrites.size(); i > 0; i--) {
+        auto &write = this->undoWrites[i - 1];
+        lilu_os_memcpy(write.dest, this->undo + write.data, write.size);
+    }
+    if (MachInfo::setKernelWriting(false, KernelPatcher::kernelWriteLock) != KERN_SUCCESS) {
+        SYSLOG("Patcher+", "Failed to restore write permissions");
+    }
+
+    DBGLOG("Patcher+", "Rolled back %zu writes (%zu bytes)", this->undoWrites.size(), this->undoSize);
+    this->release();
     return true;
 }
+
+void KernelWriteTransaction::release() {
+    this->undoWrites.deinit();
+    if (this->undo) { Buffer::deleter(this->undo); }
+    this->undo = nullptr;
+    this->undoSize = 0;
+}
@@ -3,25 +3,174 @@
 
 #pragma once
 #include <Headers/kern_util.hpp>
+#include <PrivateHeaders/FirmwareIndex.hpp>
+#include <PrivateHeaders/Hash.hpp>
+#include <PrivateHeaders/LZ4.hpp>
 
 struct FWMetadata {
     const UInt8 *data;
     const UInt32 length;
+    const UInt32 compressedLength;    // LZ4 block size, or 0 if `data` is stored as is.
+
+    // Bytes the file takes up in the kext.
+    UInt32 storedLength() const { return this->compressedLength ? this->compressedLength : this->length; }
+
+    // Decompresses the file into `dst`, which must hold `length` bytes.
+    void copyTo(void *dst) const {
+        if (this->compressedLength == 0) {
+            memcpy(dst, this->data, this->length);
+            return;
+        }
+        PANIC_COND(!lz4Decompress(this->data, this->compressedLength, static_cast<UInt8 *>(dst), this->length), "FW",
+            "Corrupt firmware data at %p", this->data);
+    }
+};
+
+// ASICs a firmware file is loaded on. Must match `ASIC_*` in Scripts/GenerateFirmware.py.
+enum FWASIC : UInt8 {
+    kFWASICRaven = (1U << 0),
+    kFWASICPicasso = (1U << 1),
+    kFWASICRaven2 = (1U << 2),
+    kFWASICRenoir = (1U << 3),
+};
+
+// Page-aligned run of the files serving the same set of ASICs.
+struct FWGroup {
+    const UInt8 *data;
+    const UInt32 size;
+    const UInt8 asics;
 };
 
 struct FWDescriptor {
     const char *name;
     const FWMetadata metadata;
+    const UInt8 group;
 };
 
 extern const struct FWDescriptor firmware[];
 extern const size_t firmwareCount;
+extern const struct FWGroup firmwareGroups[];
+extern const size_t firmwareGroupCount;
+// Groups disabled by `NRed::disableFirmware`, one bit per group; their data stays in place. Written once in
+// `NRed::processPatcher`, before any module runs, and only read after that, so lookups do not lock it.
+extern UInt32 firmwareDisabledGroups;
+
+// Perfect hash index generated along with `firmware`; a name's bucket picks the displacement that gives it a slot
+// of its own. Must match `build_index` in Scripts/GenerateFirmware.py.
+extern const UInt16 firmwareDisplacements[];
+extern const UInt8 firmwareSlots[];
+extern const UInt32 firmwareBucketMask;
+extern const UInt32 firmwareSlotShift;
+
+// Slot of a name in `firmwareSlots`, after the displacement of its bucket. Must match `fw_name_slot` in
+// Scripts/GenerateFirmware.py.
+inline UInt32 fwNameSlot(UInt32 hash) {
+    const UInt32 displacement = firmwareDisplacements[hash & firmwareBucketMask];
+    return ((hash ^ displacement) * 0x9E3779B1U) >> firmwareSlotShift;
+}
+
+// Not defined; reached only by `fwIndex` for a name with no file, which then fails to compile.
+void fwNameNotFound();
+
+// Index of a literal name in `firmware`, which is sorted by name like `firmwareNames`.
+consteval UInt32 fwIndex(const char *name) {
+    for (UInt32 i = 0; i < arrsize(firmwareNames); i++) {
+        const char *a = firmwareNames[i], *b = name;
+        while (*a && *a == *b) {
+            a++;
+            b++;
+        }
+        if (*a == *b) { return i; }
+    }
+    fwNameNotFound();
+    return 0;
+}
+
+// A firmware name along with its hash. Names known at compile time should go through `fwLiteral` instead.
+struct FWName {
+    static constexpr UInt32 NoIndex = UINT32_MAX;
+
+    const char *name;
+    UInt32 hash;
+    UInt32 index {NoIndex};
+
+    constexpr FWName(const char *name) : name {name}, hash {fnv1a(name)} {}
+};
 
-inline const FWMetadata &getFWByName(const char *name) {
-    for (size_t i = 0; i < firmwareCount; i++) {
-        if (strcmp(firmware[i].name, name)) { continue; }
+// A literal name resolved to its `firmware` entry at compile time; a name with no file does not compile.
+consteval FWName fwLiteral(const char *name) {
+    FWName ret {name};
+    ret.index = fwIndex(name);
+    return ret;
+}
 
-        return firmware[i].metadata;
+inline const FWDescriptor &getFWDescriptorByName(const FWName &name) {
+    auto index = name.index;
+    if (index == FWName::NoIndex) {
+        // Unknown names land on an empty slot or on a slot that belongs to another file.
+        index = firmwareSlots[fwNameSlot(name.hash)];
+        PANIC_COND(index >= firmwareCount || strcmp(firmware[index].name, name.name), "FW", "'%s' not found",
+            name.name);
     }
-    PANIC("FW", "'%s' not found", name);
+    PANIC_COND((firmwareDisabledGroups & (1U << firmware[index].group)) != 0, "FW",
+        "'%s' is disabled as unused by this ASIC", name.name);
+    return firmware[index];
 }
+
+inline const FWMetadata &getFWMetadataByName(const FWName &name) { return getFWDescriptorByName(name).metadata; }
+
+// Decompressed contents of a firmware file. The buffer is owned by the view and freed along with it,
+// so keep the view only as long as the contents are in use.
+class FWView {
+    UInt8 *buffer {nullptr};
+
+    public:
+    const UInt8 *data {nullptr};
+    UInt32 length {0};
+
+    FWView() = default;
+
+    explicit FWView(const FWMetadata &metadata) : data {metadata.data}, length {metadata.length} {
+        if (metadata.compressedLength == 0) { return; }
+        this->buffer = Buffer::create<UInt8>(metadata.length);
+        PANIC_COND(this->buffer == nullptr, "FW", "Failed to allocate %u bytes for firmware", metadata.length);
+        metadata.copyTo(this->buffer);
+        this->data = this->buffer;
+    }
+
+    FWView(const FWView &) = delete;
+    FWView &operator=(const FWView &) = delete;
+
+    FWView(FWView &&other) : buffer {other.buffer}, data {other.data}, length {other.length} {
+        other.buffer = nullptr;
+        other.data = nullptr;
+        other.length = 0;
+    }
+
+    FWView &operator=(FWView &&other) {
+        if (this != &other) {
+            this->release();
+            this->buffer = other.buffer;
+            this->data = other.data;
+            this->length = other.length;
+            other.buffer = nullptr;
+            other.data = nullptr;
+            other.length = 0;
+        }
+        return *this;
+    }
+
+    ~FWView() { this->release(); }
+
+    // Whether the view holds a decompressed copy rather than pointing into the kext.
+    bool isCopy() const { return this->buffer != nullptr; }
+
+    void release() {
+        if (this->buffer) { Buffer::deleter(this->buffer); }
+        this->buffer = nullptr;
+        this->data = nullptr;
+        this->length = 0;
+    }
+};
+
+inline FWView getFWByName(const FWName &name) { return FWView {getFWMetadataByName(name)}; }
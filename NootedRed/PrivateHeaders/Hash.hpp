@@ -0,0 +1,29 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+#pragma once
+#include <Headers/kern_util.hpp>
+
+// 32-bit FNV-1a, used for every name and pattern key; folded at compile time for constant strings.
+// The offset cache and telemetry keep these values across boots, so the function must not change.
+constexpr UInt32 FNV1aBasis = 0x811C9DC5;
+
+constexpr UInt32 fnv1a(const char *string, UInt32 hash = FNV1aBasis) {
+    while (*string) {
+        hash ^= static_cast<UInt8>(*string++);
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+constexpr UInt32 fnv1a(const UInt8 *data, size_t size, UInt32 hash = FNV1aBasis) {
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+inline UInt32 fnv1a(const void *data, size_t size, UInt32 hash = FNV1aBasis) {
+    return fnv1a(static_cast<const UInt8 *>(data), size, hash);
+}
@@ -0,0 +1,59 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+#pragma once
+#include <Headers/kern_util.hpp>
+
+// Decodes an LZ4 block, as written by Scripts/GenerateFirmware.py, into exactly `dstSize` bytes.
+// Every read and write is bounds-checked, so a corrupt block fails instead of running off either buffer.
+inline bool lz4Decompress(const UInt8 *src, size_t srcSize, UInt8 *dst, size_t dstSize) {
+    const auto *ip = src;
+    const auto *const ipEnd = src + srcSize;
+    auto *op = dst;
+    auto *const opEnd = dst + dstSize;
+
+    auto readLength = [&](size_t &length) {
+        UInt8 byte;
+        do {
+            if (ip == ipEnd) { return false; }
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+
+    while (ip < ipEnd) {
+        const auto token = *ip++;
+
+        size_t length = token >> 4;
+        if (length == 15 && !readLength(length)) { return false; }
+        if (length > static_cast<size_t>(ipEnd - ip) || length > static_cast<size_t>(opEnd - op)) { return false; }
+        memcpy(op, ip, length);
+        ip += length;
+        op += length;
+
+        // The last sequence has no match.
+        if (ip == ipEnd) { break; }
+
+        if (ipEnd - ip < 2) { return false; }
+        const size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst)) { return false; }
+
+        length = token & 0xF;
+        if (length == 15 && !readLength(length)) { return false; }
+        length += 4;
+        if (length > static_cast<size_t>(opEnd - op)) { return false; }
+
+        const auto *match = op - offset;
+        if (offset >= length) {
+            memcpy(op, match, length);
+            op += length;
+        } else {
+            // Overlapping match, repeats the last `offset` bytes.
+            while (length--) { *op++ = *match++; }
+        }
+    }
+
+    return op == opEnd;
+}
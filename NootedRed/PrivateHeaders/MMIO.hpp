@@ -0,0 +1,44 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+#pragma once
+#include <Headers/kern_util.hpp>
+#include <IOKit/IOLocks.h>
+#include <PrivateHeaders/GPUDriversAMD/Driver.hpp>
+
+// `reg = (reg & ~mask) | (value & mask)`; the read is skipped when `mask` covers the whole register.
+struct RegRMW {
+    UInt32 reg;
+    UInt32 mask;
+    UInt32 value;
+};
+
+// The register BAR of the IGPU. Registers past its end are reached through the `mmPCIE_INDEX2/DATA2` pair.
+class MMIO {
+    volatile UInt32 *base {nullptr};
+    UInt32 regs {0};                         // Registers past this are reached through `mmPCIE_INDEX2/DATA2`.
+    IOSimpleLock *indirectLock {nullptr};    // Guards the index/data pair.
+
+    // `waitForReg32` polling, in microseconds. Tunable with the `NRedSMUSpin`, `NRedSMUBackoff` and `NRedSMUTimeout`
+    // boot arguments.
+    UInt32 spinUsec {50};
+    UInt32 maxBackoffUsec {1000};
+    UInt32 timeoutUsec {AMD_MAX_USEC_TIMEOUT * 20};
+
+    public:
+    void init();
+    void map(volatile UInt32 *base, UInt32 regs);
+    bool mapped() const { return this->base != nullptr; }
+
+    UInt32 readReg32(UInt32 reg) const;
+    void writeReg32(UInt32 reg, UInt32 val) const;
+    // Applies `ops` in order. The index/data pair is held over each run of indirect registers, so an index is only
+    // written when it differs from the previous one, while direct registers are written without the lock. AMD's own
+    // code uses the pair too, so the index is not trusted once the pair was let go.
+    void modifyRegs32(const RegRMW *ops, size_t count) const;
+    // Polls until a bit of `mask` is set in `reg`. The SMU usually answers within microseconds, so it spins on
+    // `IODelay` first, then backs off exponentially and sleeps once the steps reach a millisecond. Returns the last
+    // value read, which has none of the bits set if the deadline passed. The deadline is `timeoutUsec`, or the SMU
+    // timeout if 0.
+    UInt32 waitForReg32(UInt32 reg, UInt32 mask, UInt32 timeoutUsec = 0) const;
+};
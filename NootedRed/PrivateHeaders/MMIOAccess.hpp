@@ -0,0 +1,10 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+#pragma once
+#include <IOKit/IOTypes.h>
+
+// Single loads and stores of the register BAR, which is mapped uncached. Every access of `MMIO` goes through these, so
+// the host tests can put a simulated BAR in its place.
+inline UInt32 mmioRead32(volatile UInt32 *base, UInt32 slot) { return base[slot]; }
+inline void mmioWrite32(volatile UInt32 *base, UInt32 slot, UInt32 val) { base[slot] = val; }
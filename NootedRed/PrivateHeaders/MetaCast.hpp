@@ -0,0 +1,63 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+#pragma once
+#include <Headers/kern_util.hpp>
+#include <kern/thread_call.h>
+#include <libkern/c++/OSMetaClass.h>
+
+// Hooks `OSMetaClassBase::safeMetaCast` so a failed cast between an X5000 class and its X6000 counterpart is retried
+// with the other one. The hook runs on every `OSDynamicCast` in the kernel, so unrelated failed casts must be rejected
+// after one compare and nothing on the path may take a lock.
+class MetaCast {
+    static constexpr UInt32 PublishDelaySecs = 1;
+
+    // Direct-mapped on the target `OSMetaClass` of a failed cast. The hook is running on every CPU meanwhile, so a
+    // published filter is never written again: each rebuild takes the next buffer. The first one stays empty; X5000 and
+    // X6000 rebuild once each, when their kext is processed.
+    struct Filter {
+        static constexpr size_t Size = 64;
+
+        UInt32 shift;
+        struct {
+            const OSMetaClass *from;
+            const OSMetaClass *to;
+        } entries[Size];
+
+        size_t slot(const OSMetaClass *meta) const {
+            return (reinterpret_cast<uintptr_t>(meta) >> this->shift) & (Size - 1);
+        }
+    };
+
+    bool initialised {false};
+    Filter filters[3] {};
+    size_t filterCount {1};
+    const Filter *filter {&filters[0]};
+
+    // Bumped by the hook with relaxed atomics. A snapshot is published on the IGPU as `NRed,MetaCastRemaps`, and
+    // `NRed,MetaCastMisses` in debug builds, by `publishCall` at most `PublishDelaySecs` after a change.
+    UInt64 hits {0};
+    UInt64 misses {0};
+    thread_call_t publishCall {nullptr};
+    bool publishScheduled {false};
+
+    void count(UInt64 &counter);
+
+    public:
+    mach_vm_address_t orgSafeMetaCast {0};
+
+    // NOTE: Temporary hack, will be removed when HWDisplay reimplementation lands!
+    OSMetaClass *classMap[5][2] = {{nullptr}};
+
+    static MetaCast &singleton();
+
+    void init();
+    // Rebuilds the filter from `classMap`. Called once the metaclasses of a kext are solved.
+    void rebuildFilter();
+    void publish();
+
+    static OSMetaClassBase *wrapSafeMetaCast(const OSMetaClassBase *anObject, const OSMetaClass *toMeta);
+
+    private:
+    static void publishCounters(thread_call_param_t param0, thread_call_param_t param1);
+};
@@ -6,6 +6,8 @@
 #include <IOKit/pci/IOPCIDevice.h>
 #include <PrivateHeaders/GPUDriversAMD/ATOMBIOS.hpp>
 #include <PrivateHeaders/GPUDriversAMD/CAIL/Result.hpp>
+#include <PrivateHeaders/GPUDriversAMD/Driver.hpp>
+#include <PrivateHeaders/MMIO.hpp>
 #include <PrivateHeaders/NRedAttributes.hpp>
 
 class NRed {
@@ -13,7 +15,7 @@ class NRed {
     NRedAttributes attributes {};
     IOPCIDevice *iGPU {nullptr};
     IOMemoryMap *rmmio {nullptr};
-    volatile UInt32 *rmmioPtr {nullptr};
+    MMIO mmio {};
     OSData *vbiosData {nullptr};
     UInt32 deviceID {0};
     UInt32 pciRevision {0};
@@ -21,8 +23,9 @@ class NRed {
     UInt16 devRevision {0};
     UInt16 enumRevision {0};
 
+    bool firmwareDisabled {false};
+
     mach_vm_address_t orgAddDrivers {0};    // TODO: Move all these to separate modules!
-    mach_vm_address_t orgSafeMetaCast {0};
 
     public:
     static NRed &singleton();
@@ -39,9 +42,18 @@ class NRed {
     void processPatcher(KernelPatcher &patcher);
 
     void setProp32(const char *key, UInt32 value);
-    UInt32 readReg32(UInt32 reg) const;
-    void writeReg32(UInt32 reg, UInt32 val) const;
-    UInt32 smuWaitForResponse() const;
+    void setProp(const char *key, OSObject *value);
+    static void setNumber(OSDictionary *dict, const char *key, UInt64 value);
+    UInt32 readReg32(UInt32 reg) const { return this->mmio.readReg32(reg); }
+    void writeReg32(UInt32 reg, UInt32 val) const { this->mmio.writeReg32(reg, val); }
+    void modifyRegs32(const RegRMW *ops, size_t count) const { this->mmio.modifyRegs32(ops, count); }
+    void modifyReg32(UInt32 reg, UInt32 mask, UInt32 value) const {
+        const RegRMW op {reg, mask, value};
+        this->mmio.modifyRegs32(&op, 1);
+    }
+    UInt32 waitForReg32(UInt32 reg, UInt32 mask, UInt32 timeoutUsec = 0) const {
+        return this->mmio.waitForReg32(reg, mask, timeoutUsec);
+    }
     CAILResult sendMsgToSmc(UInt32 msg, UInt32 param = 0, UInt32 *outParam = nullptr) const;
 
     template<typename T>
@@ -54,15 +66,12 @@ class NRed {
         return offset ? reinterpret_cast<T *>(const_cast<UInt8 *>(vbios) + offset) : nullptr;
     }
 
-    // NOTE: Temporary hack, will be removed when HWDisplay reimplementation lands!
-    OSMetaClass *metaClassMap[5][2] = {{nullptr}};
-
     private:
     bool getVBIOSFromExpansionROM();
     bool getVBIOSFromVFCT();
     bool getVBIOSFromVRAM();
     bool getVBIOS();
+    void disableFirmware(UInt8 asics);
 
     static bool wrapAddDrivers(void *that, OSArray *array, bool doNubMatching);
-    static OSMetaClassBase *wrapSafeMetaCast(const OSMetaClassBase *anObject, const OSMetaClass *toMeta);
 };
@@ -57,6 +57,83 @@ class NRedAttributes {
     inline void setRenoirE() { this->value |= IsRenoirE; }
     inline void setGreenSardine() { this->value |= IsGreenSardine; }
 
+    // From the version of the running kernel.
+    inline void setKernelVersion(KernelVersion version, KernelMinor minor) {
+        switch (version) {
+            case KernelVersion::Catalina:
+                this->setCatalina();
+                break;
+            case KernelVersion::BigSur:
+                this->setBigSurAndLater();
+                break;
+            case KernelVersion::Monterey:
+                this->setBigSurAndLater();
+                this->setMonterey();
+                this->setMontereyAndLater();
+                break;
+            case KernelVersion::Ventura:
+                this->setBigSurAndLater();
+                this->setMontereyAndLater();
+                this->setVentura();
+                this->setVenturaAndLater();
+                if (minor >= 5) {
+                    this->setVentura1304Based();
+                    this->setVentura1304AndLater();
+                }
+                break;
+            case KernelVersion::Sonoma:
+                this->setBigSurAndLater();
+                this->setMontereyAndLater();
+                this->setVenturaAndLater();
+                this->setVentura1304AndLater();
+                if (minor >= 4) { this->setSonoma1404AndLater(); }
+                break;
+            case KernelVersion::Sequoia:
+                this->setBigSurAndLater();
+                this->setMontereyAndLater();
+                this->setVenturaAndLater();
+                this->setVentura1304AndLater();
+                this->setSonoma1404AndLater();
+                break;
+            default:
+                PANIC("NRed", "Unknown kernel version %d", version);
+        }
+    }
+
+    // From the PCI device ID; false if the device is not supported.
+    inline bool setDevice(UInt32 deviceID) {
+        switch (deviceID) {
+            case 0x15D8:
+                this->setRaven();
+                this->setPicasso();
+                return true;
+            case 0x15DD:
+                this->setRaven();
+                return true;
+            case 0x164C:
+            case 0x1636:
+                this->setRenoir();
+                return true;
+            case 0x15E7:
+            case 0x1638:
+                this->setRenoir();
+                this->setGreenSardine();
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // The variants that share a device ID, told apart once the registers can be read.
+    inline void setRevision(UInt16 devRevision, UInt32 pciRevision) {
+        if (this->isRaven()) {
+            if (devRevision >= 0x8) { this->setRaven2(); }
+        } else if (this->isRenoir() && !this->isGreenSardine() && devRevision == 0 && pciRevision >= 0x80 &&
+                   pciRevision <= 0x84) {
+            this->setRenoirE();
+        }
+    }
+
     inline const char *getChipName() const {
         if (this->isRaven2()) {
             return "raven2";
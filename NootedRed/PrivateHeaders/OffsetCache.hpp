@@ -0,0 +1,70 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+#pragma once
+#include <Headers/kern_util.hpp>
+#include <IOKit/IOLocks.h>
+#include <kern/thread_call.h>
+
+struct OffsetCacheEntry {
+    UInt32 key;
+    UInt32 offset;
+};
+
+struct OffsetCacheRecord {
+    UInt8 uuid[16];
+    bool used;
+    bool dirty;
+    evector<OffsetCacheEntry> entries;
+};
+
+// Offsets found by pattern scans, keyed by the LC_UUID of the kext they were found in.
+// The records are kept in NVRAM, so the next boot with the same kexts only has to verify them.
+class OffsetCache {
+    static constexpr UInt32 Magic = 0x434F524E;    // 'NROC'
+    static constexpr UInt16 Version = 1;
+    static constexpr UInt32 StoreDelaySecs = 10;
+
+    bool initialised {false};
+    bool enabled {false};
+    bool loaded {false};
+    OffsetCacheRecord records[8] {};
+    size_t recordCount {0};
+
+    // Snapshot of the records waiting to be written to NVRAM by `storeCall`.
+    IOLock *storeLock {nullptr};
+    thread_call_t storeCall {nullptr};
+    UInt8 *pending {nullptr};
+    size_t pendingSize {0};
+    size_t pendingCount {0};
+
+    public:
+    static constexpr size_t MaxEntries = 1024;
+    static constexpr size_t MaxSerialisedSize = 0x2000;
+
+    static OffsetCache &singleton();
+
+    void init();
+
+    bool isEnabled() const { return this->enabled; }
+
+    // Recorded offsets for `key` in the kext with `uuid`, or null if there are none.
+    const OffsetCacheEntry *lookup(const UInt8 *uuid, UInt32 key, size_t &count);
+    // Replaces the offsets for `key`; a `count` of zero drops them.
+    void update(const UInt8 *uuid, UInt32 key, const size_t *offsets, size_t count);
+    // Snapshots the records if any of them changed, merged with the stored ones, and schedules a single NVRAM write
+    // for when the kexts have stopped loading.
+    void flush();
+
+    // Serialised form: header {magic, version, record count}, then per record {uuid, entry count, entries}.
+    // Returns the number of bytes needed, nothing is written if `out` is null or too small.
+    static size_t serialise(const OffsetCacheRecord *const *records, size_t recordCount, UInt8 *out, size_t outSize);
+    static bool deserialise(const UInt8 *data, size_t size, OffsetCacheRecord *records, size_t maxRecords,
+        size_t &recordCount);
+
+    private:
+    OffsetCacheRecord *getRecord(const UInt8 *uuid, bool create);
+    void load();
+
+    static void store(thread_call_param_t param0, thread_call_param_t param1);
+};
@@ -0,0 +1,69 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+#pragma once
+#include <Headers/kern_util.hpp>
+
+enum class PatchKind : UInt8 {
+    Solve,
+    Route,
+    Lookup,
+};
+
+enum class PatchMethod : UInt8 {
+    Symbol,     // Solved by Lilu.
+    Index,      // Solved by the PatcherPlus symbol index.
+    Pattern,    // Found by a pattern scan.
+    Cache,      // Replayed from the offset cache.
+    Batch,      // Shared cost of a batched call, not a single request.
+    Failed,
+};
+
+// Serialised as is into the `Records` data, so the layout is fixed.
+struct PatchTelemetryRecord {
+    UInt32 key;    // `fnv1a` of the symbol or of the pattern.
+    UInt32 matches;
+    UInt32 bytesScanned;
+    UInt32 nanoseconds;
+    UInt16 kext;    // Lilu load index.
+    PatchKind kind;
+    PatchMethod method;
+};
+static_assert(sizeof(PatchTelemetryRecord) == 20, "PatchTelemetryRecord layout changed");
+
+// Cost of every request handled by PatcherPlus, published on the IGPU as `NRed,PatchTelemetry` once each kext has been
+// processed, so it can be read with `ioreg` on any build. Scripts/DecodeTelemetry.py turns it into a report.
+class PatchTelemetry {
+    static constexpr UInt32 Version = 1;
+    static constexpr size_t MaxKexts = 16;
+    static constexpr size_t MaxRecords = 1024;
+
+    bool initialised {false};
+    bool enabled {false};
+    bool dirty {false};    // Changed since the last `publish`.
+    evector<PatchTelemetryRecord> records {};
+    size_t kextIndices[MaxKexts] {};
+    const char *kextNames[MaxKexts] {};
+    size_t kextCount {0};
+    UInt64 bytesScanned {0};
+
+    public:
+    struct Scope {
+        UInt64 start;
+        UInt64 bytesScanned;
+    };
+
+    static PatchTelemetry &singleton();
+
+    void init();
+
+    // Counts bytes examined by a scan; attributed to the scope it happens in.
+    void scanned(size_t bytes) { this->bytesScanned += bytes; }
+
+    Scope begin() const;
+    void record(const Scope &scope, size_t kext, PatchKind kind, PatchMethod method, UInt32 key, size_t matches);
+    void nameKext(size_t kext, const char *name);
+
+    private:
+    void publish();
+};
@@ -3,21 +3,110 @@
 
 #pragma once
 #include <Headers/kern_patcher.hpp>
+#include <PrivateHeaders/Hash.hpp>
+#include <PrivateHeaders/PatchTelemetry.hpp>
+
+namespace PatcherPlus {
+    // Which part of the image a pattern can be in. Requests are only scanned against their class of sections.
+    enum class Section : UInt8 {
+        Any,
+        Code,
+        Data,
+    };
+
+    struct Range {
+        size_t offset;
+        size_t size;
+    };
+
+    // Section layout of a loaded Mach-O image, as offsets from its header. Zero-fill sections are left out.
+    struct ImageSections {
+        static constexpr size_t MaxRanges = 16;
+
+        Range code[MaxRanges] {};
+        Range data[MaxRanges] {};
+        size_t codeCount {0}, dataCount {0};
+        UInt8 uuid[16] {};
+        bool hasUUID {false};
+
+        bool parse(const UInt8 *header, size_t size);
+
+        // The parsed sections of the image whose header is at `address`; null if there is no Mach-O header there.
+        static const ImageSections *get(mach_vm_address_t address, size_t size);
+    };
+
+    // Ranges of `section` within `[address, address + size)`, relative to `address`.
+    // Falls back to the whole range if the section layout is unknown or does not overlap it.
+    size_t getRanges(Section section, mach_vm_address_t address, size_t size, Range *ranges, size_t maxRanges);
+
+    // Index of the rarest fully unmasked byte of the pattern, or `patternSize` if every byte is masked.
+    size_t patternAnchor(const UInt8 *pattern, const UInt8 *patternMask, size_t patternSize);
+
+    // Same results as `KernelPatcher::findPattern`, but only verifies the pattern where its anchor byte is found.
+    bool findPattern(const void *pattern, const void *patternMask, size_t patternSize, const void *data,
+        size_t dataSize, size_t *dataOffset);
+
+    // `findPattern` over the ranges of `section`, offset is relative to `address`.
+    // The result is recorded in the offset cache, and a recorded offset that still matches is used without scanning.
+    bool findPattern(Section section, const void *pattern, const void *patternMask, size_t patternSize,
+        mach_vm_address_t address, size_t size, size_t *offset);
+
+    // Hash of a symbol name, folded at compile time for the constant names used by the modules.
+    constexpr UInt32 symbolHash(const char *symbol) { return fnv1a(symbol); }
+
+    // Address of `symbol` from a hash index of the symbol table of the image at `address`, built when the image is
+    // first used. 0 if the symbol is not in the index, or if the symbol table is not mapped within the image.
+    mach_vm_address_t lookupSymbol(const char *symbol, UInt32 hash, mach_vm_address_t address, size_t size);
+
+    // Frees the symbol index; done once every module has processed the loaded kext.
+    void releaseSymbolIndex();
+
+    // `lookupSymbol`, falling back to Lilu for symbols that are not in the index.
+    inline mach_vm_address_t solveSymbol(KernelPatcher &patcher, size_t id, const char *symbol,
+        mach_vm_address_t address, size_t size) {
+        auto ret = lookupSymbol(symbol, symbolHash(symbol), address, size);
+        return ret ? ret : patcher.solveSymbol(id, symbol, address, size);
+    }
+
+    template<typename T>
+    inline T solveSymbol(KernelPatcher &patcher, size_t id, const char *symbol, mach_vm_address_t address,
+        size_t size) {
+        return reinterpret_cast<T>(solveSymbol(patcher, id, symbol, address, size));
+    }
+
+    static constexpr size_t MaxDisplacementFixes = 8;
+
+    struct DisplacementFix {
+        UInt32 from;
+        UInt32 to;
+        UInt32 count;
+    };
+
+    // Scans `code` once for the byte shape of `call`/`jmp qword ptr [reg + disp32]` (FF /2, FF /4), and queues the
+    // replacement of the first `count` occurrences of each listed displacement in the shared `KernelWriteTransaction`.
+    // This is a byte scan, not a decoder, so a match may be the tail of another instruction or lie past the end of the
+    // function. As with `findAndReplaceWithMask`, `count` is at most how many are replaced and a displacement only has
+    // to occur once; nothing is queued unless all of them do.
+    bool remapDisplacements(UInt8 *code, size_t size, const DisplacementFix *fixes, size_t fixCount);
+}    // namespace PatcherPlus
 
 struct SolveRequestPlus : KernelPatcher::SolveRequest {
     const UInt8 *pattern {nullptr}, *mask {nullptr};
     size_t patternSize {0};
+    PatcherPlus::Section section {PatcherPlus::Section::Any};
 
     template<typename T>
     SolveRequestPlus(const char *s, T &addr) : KernelPatcher::SolveRequest {s, addr} {}
 
     template<typename T, typename P, size_t N>
-    SolveRequestPlus(const char *s, T &addr, const P (&pattern)[N])
-        : KernelPatcher::SolveRequest {s, addr}, pattern {pattern}, patternSize {N} {}
+    SolveRequestPlus(const char *s, T &addr, const P (&pattern)[N],
+        PatcherPlus::Section section = PatcherPlus::Section::Any)
+        : KernelPatcher::SolveRequest {s, addr}, pattern {pattern}, patternSize {N}, section {section} {}
 
     template<typename T, typename P, size_t N>
-    SolveRequestPlus(const char *s, T &addr, const P (&pattern)[N], const UInt8 (&mask)[N])
-        : KernelPatcher::SolveRequest {s, addr}, pattern {pattern}, mask {mask}, patternSize {N} {}
+    SolveRequestPlus(const char *s, T &addr, const P (&pattern)[N], const UInt8 (&mask)[N],
+        PatcherPlus::Section section = PatcherPlus::Section::Any)
+        : KernelPatcher::SolveRequest {s, addr}, pattern {pattern}, mask {mask}, patternSize {N}, section {section} {}
 
     bool solve(KernelPatcher &patcher, size_t id, mach_vm_address_t address, size_t maxSize);
 
@@ -34,6 +123,7 @@ struct SolveRequestPlus : KernelPatcher::SolveRequest {
 struct RouteRequestPlus : KernelPatcher::RouteRequest {
     const UInt8 *pattern {nullptr}, *mask {nullptr};
     size_t patternSize {0};
+    PatcherPlus::Section section {PatcherPlus::Section::Code};
 
     template<typename T>
     RouteRequestPlus(const char *s, T t, mach_vm_address_t &o) : KernelPatcher::RouteRequest {s, t, o} {}
@@ -78,16 +168,25 @@ struct RouteRequestPlus : KernelPatcher::RouteRequest {
         size_t maxSize) {
         return routeAll(patcher, id, requests, N, address, maxSize);
     }
+    private:
+    bool report(const PatchTelemetry::Scope &scope, size_t id, bool routed, PatchMethod method) const;
+    bool routeAt(KernelPatcher &patcher, mach_vm_address_t from, const char *method);
+    bool routeByPattern(KernelPatcher &patcher, mach_vm_address_t address, size_t maxSize);
 };
 
 struct LookupPatchPlus : KernelPatcher::LookupPatch {
     const UInt8 *findMask {nullptr}, *replaceMask {nullptr};
     const size_t skip {0};
+    const PatcherPlus::Section section {PatcherPlus::Section::Code};
 
     LookupPatchPlus(KernelPatcher::KextInfo *kext, const UInt8 *find, const UInt8 *replace, size_t size, size_t count,
         size_t skip = 0)
         : KernelPatcher::LookupPatch {kext, find, replace, size, count}, skip {skip} {}
 
+    LookupPatchPlus(KernelPatcher::KextInfo *kext, PatcherPlus::Section section, const UInt8 *find,
+        const UInt8 *replace, size_t size, size_t count, size_t skip = 0)
+        : KernelPatcher::LookupPatch {kext, find, replace, size, count}, skip {skip}, section {section} {}
+
     LookupPatchPlus(KernelPatcher::KextInfo *kext, const UInt8 *find, const UInt8 *findMask, const UInt8 *replace,
         size_t size, size_t count, size_t skip = 0)
         : KernelPatcher::LookupPatch {kext, find, replace, size, count}, findMask {findMask}, skip {skip} {}
@@ -97,11 +196,22 @@ struct LookupPatchPlus : KernelPatcher::LookupPatch {
         : KernelPatcher::LookupPatch {kext, find, replace, size, count}, findMask {findMask}, replaceMask {replaceMask},
           skip {skip} {}
 
+    LookupPatchPlus(KernelPatcher::KextInfo *kext, PatcherPlus::Section section, const UInt8 *find,
+        const UInt8 *findMask, const UInt8 *replace, const UInt8 *replaceMask, size_t size, size_t count,
+        size_t skip = 0)
+        : KernelPatcher::LookupPatch {kext, find, replace, size, count}, findMask {findMask}, replaceMask {replaceMask},
+          skip {skip}, section {section} {}
+
     template<size_t N>
     LookupPatchPlus(KernelPatcher::KextInfo *kext, const UInt8 (&find)[N], const UInt8 (&replace)[N], size_t count,
         size_t skip = 0)
         : LookupPatchPlus {kext, find, replace, N, count, skip} {}
 
+    template<size_t N>
+    LookupPatchPlus(KernelPatcher::KextInfo *kext, PatcherPlus::Section section, const UInt8 (&find)[N],
+        const UInt8 (&replace)[N], size_t count, size_t skip = 0)
+        : LookupPatchPlus {kext, section, find, replace, N, count, skip} {}
+
     template<size_t N>
     LookupPatchPlus(KernelPatcher::KextInfo *kext, const UInt8 (&find)[N], const UInt8 (&findMask)[N],
         const UInt8 (&replace)[N], size_t count, size_t skip = 0)
@@ -123,3 +233,53 @@ struct LookupPatchPlus : KernelPatcher::LookupPatch {
         return applyAll(patcher, patches, N, address, maxSize, force);
     }
 };
+
+// Writes to read-only kernel memory, queued and then performed within a single write window.
+class KernelWriteTransaction {
+    struct Write {
+        UInt8 *dest;
+        size_t size;
+        size_t data;
+    };
+
+    evector<Write> writes {};
+    UInt8 *data {nullptr};
+    size_t dataSize {0};
+    size_t dataCapacity {0};
+
+    // What the writes committed with `keepUndo` overwrote, in commit order.
+    evector<Write> undoWrites {};
+    UInt8 *undo {nullptr};
+    size_t undoSize {0};
+
+    UInt8 *reserve(size_t size);
+
+    public:
+    // Shared by all modules; committed once every module has processed the loaded kext.
+    static KernelWriteTransaction &singleton();
+
+    void write(void *dest, const void *src, size_t size);
+    void fill(void *dest, UInt8 value, size_t size);
+
+    template<typename T, typename V = T>
+    void write(T *dest, const V &value) {
+        const T converted = value;
+        this->write(static_cast<void *>(dest), &converted, sizeof(T));
+    }
+
+    // The `size` bytes at `src` as they will be once committed: `src` itself when no queued write touches them,
+    // otherwise `scratch`, filled with the merged bytes.
+    const UInt8 *read(const UInt8 *src, size_t size, UInt8 *scratch) const;
+
+    size_t pending() const { return this->writes.size(); }
+
+    // Performs the queued writes in one write window. With `keepUndo`, what they overwrote is kept until `rollback` or
+    // `release`, so a failure after the commit can still undo them.
+    bool commit(bool keepUndo = false);
+    // Drops the queued writes.
+    void discard();
+    // Restores what the writes committed with `keepUndo` overwrote, latest first, in one write window.
+    bool rollback();
+    // Drops the undo log.
+    void release();
+};
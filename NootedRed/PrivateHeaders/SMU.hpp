@@ -0,0 +1,100 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+#pragma once
+#include <Headers/kern_util.hpp>
+#include <IOKit/IOLocks.h>
+#include <PrivateHeaders/GPUDriversAMD/CAIL/Result.hpp>
+#include <kern/thread_call.h>
+
+// Serialised as is into the `Records` data of `NRed,SMUTrace`, so the layout is fixed.
+struct SMUTraceRecord {
+    UInt64 timestamp;    // Start of the exchange, in nanoseconds since boot.
+    UInt32 seq;          // 1-based; 0 for an unused slot.
+    UInt32 msg;
+    UInt32 param;
+    UInt32 response;    // Raw `C2PMSG_90`.
+    UInt32 nanoseconds;
+    UInt8 result;    // `CAILResult`.
+    UInt8 reserved[3];
+};
+static_assert(sizeof(SMUTraceRecord) == 32, "SMUTraceRecord layout changed");
+
+// Owns the SMU mailbox. A message is three writes and two waits on `C2PMSG_82/90/66`, so every message goes through
+// here and is sent under one lock. Queued messages are sent in order by a thread call, and a synchronous message waits
+// for the ones queued before it.
+class SMU {
+    public:
+    using Completion = void (*)(void *owner, UInt32 msg, CAILResult result, UInt32 outParam);
+
+    private:
+    static constexpr size_t MaxQueued = 16;
+    static constexpr UInt32 TraceVersion = 1;
+    static constexpr size_t TraceSize = 128;
+    static constexpr size_t HistogramMessages = 64;
+    static constexpr size_t HistogramBuckets = 32;    // Bucket `i` counts exchanges of [2^i, 2^(i+1)) ns.
+    static constexpr UInt32 PublishDelaySecs = 1;
+
+    struct Request {
+        UInt32 msg;
+        UInt32 param;
+        Completion completion;
+        void *owner;
+    };
+
+    bool initialised {false};
+    IORecursiveLock *lock {nullptr};      // Held for each exchange with the mailbox and its completion.
+    IOSimpleLock *queueLock {nullptr};    // Only guards `queue`, so queueing never waits on the SMU.
+    thread_call_t drainCall {nullptr};
+    Request queue[MaxQueued] {};
+    size_t queueHead {0};
+    size_t queueCount {0};
+
+    // Flight recorder of the last exchanges and per-message latency histograms, guarded by `lock`. A copy is published
+    // on the IGPU as `NRed,SMUTrace` by `publishCall`, at most `PublishDelaySecs` after an exchange, so `ioreg` never
+    // shows a record half written. Scripts/DecodeSMUTrace.py reads it.
+    SMUTraceRecord trace[TraceSize] {};
+    UInt32 traceNext {0};
+    UInt32 histograms[HistogramMessages][HistogramBuckets] {};
+    thread_call_t publishCall {nullptr};
+    bool publishScheduled {false};
+
+    // What the firmware is known to lack, so the messages it answered with "unknown command" are not sent again.
+    // Learnt from the exchanges and forgotten on a full ASIC reset, along with the version `queryVersion` got.
+    UInt32 firmwareVersion {0};
+    UInt64 unsupported {0};    // Bit per message ID.
+
+    public:
+    static SMU &singleton();
+
+    void init();
+    void publish();
+
+    // Sends `msg` once the messages queued before it are done, blocking until the SMU answers.
+    // Rejected without touching the mailbox in interrupt context, where it could not wait for the lock, and from a
+    // completion, which would overlap the exchange it completes.
+    CAILResult send(UInt32 msg, UInt32 param = 0, UInt32 *outParam = nullptr);
+
+    // Queues `msg` without waiting for the SMU; usable in interrupt context. `completion`, if any, is called in order
+    // with the mailbox still held, from the thread call or from a `send` that flushed the queue. It may queue further
+    // messages, but not send them synchronously. Fails if the queue is full.
+    bool sendAsync(UInt32 msg, UInt32 param = 0, Completion completion = nullptr, void *owner = nullptr);
+
+    // Gets the firmware version and publishes it on the IGPU as `NRed,SMUVersion`. Called once the SMU is up, on every
+    // hardware init and resume, so it only asks the firmware again after `resetCapabilities`.
+    void queryVersion();
+
+    // Forgets the firmware version and the unsupported messages; the firmware may differ after a full ASIC reset.
+    void resetCapabilities();
+
+    private:
+    bool dequeue(Request &request);
+    void complete(const Request &request);
+    CAILResult sendLocked(UInt32 msg, UInt32 param, UInt32 *outParam);
+    CAILResult exchange(UInt32 msg, UInt32 param, UInt32 *outParam);
+    UInt32 waitForResponse();
+    void record(UInt32 msg, UInt32 param, UInt32 response, CAILResult result, UInt64 start);
+
+    static void drain(thread_call_param_t param0, thread_call_param_t param1);
+    static void publishTrace(thread_call_param_t param0, thread_call_param_t param1);
+};
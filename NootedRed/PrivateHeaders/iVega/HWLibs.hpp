@@ -4,9 +4,11 @@
 #pragma once
 #include <Headers/kern_patcher.hpp>
 #include <Headers/kern_util.hpp>
+#include <PrivateHeaders/Firmware.hpp>
 #include <PrivateHeaders/GPUDriversAMD/CAIL/DeviceType.hpp>
 #include <PrivateHeaders/GPUDriversAMD/CAIL/Result.hpp>
 #include <PrivateHeaders/ObjectField.hpp>
+#include <PrivateHeaders/iVega/PSPDispatch.hpp>
 
 namespace iVega {
     class X5000HWLibs {
@@ -32,6 +34,8 @@ namespace iVega {
         t_createFirmware orgCreateFirmware {nullptr};
         t_putFirmware orgPutFirmware {nullptr};
         mach_vm_address_t orgPspCmdKmSubmit {0};
+        FWView ipFw {};
+        PSPDispatch pspDispatch {};
 
         public:
         static X5000HWLibs &singleton();
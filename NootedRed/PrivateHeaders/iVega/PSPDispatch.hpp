@@ -0,0 +1,47 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+#pragma once
+#include <Headers/kern_util.hpp>
+#include <PrivateHeaders/Firmware.hpp>
+#include <PrivateHeaders/GPUDriversAMD/PSP.hpp>
+#include <PrivateHeaders/NRedAttributes.hpp>
+
+namespace iVega {
+    enum class PSPLoadAction : UInt8 {
+        PassThrough,    // Left to AMD's `psp_cmd_km_submit`.
+        Skip,           // Acknowledged without loading anything.
+        Unexpected,     // Like `Skip`, but should not happen on this ASIC.
+        Load,           // Copies `fw` into the command buffer before submitting.
+    };
+
+    // Bits of the `NRedSkipTA` boot argument; trusted applications to acknowledge without loading.
+    enum PSPTrustedApplication : UInt32 {
+        kPSPTADTM = (1U << 0),
+        kPSPTAHDCP = (1U << 1),
+        kPSPTAAUC = (1U << 2),
+        kPSPTAFP = (1U << 3),
+    };
+
+    struct PSPLoadEntry {
+        PSPLoadAction action {PSPLoadAction::PassThrough};
+        const FWDescriptor *fw {nullptr};
+    };
+
+    // Firmware served for each PSP load command, selected once the ASIC is known.
+    class PSPDispatch {
+        static constexpr size_t UCodeCount = kUCodeDMCUB + 1;
+        static constexpr size_t TACount = 4;
+
+        PSPLoadEntry ipfw[UCodeCount] {};
+        PSPLoadEntry ta[TACount] {};
+        PSPLoadEntry asd {};
+
+        public:
+        void build(const NRedAttributes &attributes, UInt32 pciRevision, UInt32 skipTAs = 0);
+
+        const PSPLoadEntry &getIPFW(UInt32 ucodeID) const;
+        const PSPLoadEntry &getTA(const char *name) const;
+        const PSPLoadEntry &getASD() const { return this->asd; }
+    };
+};    // namespace iVega
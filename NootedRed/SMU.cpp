@@ -0,0 +1,217 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+#include <Headers/kern_util.hpp>
+#include <PrivateHeaders/NRed.hpp>
+#include <PrivateHeaders/SMU.hpp>
+#include <PrivateHeaders/iVega/IPOffset.hpp>
+#include <PrivateHeaders/iVega/Regs/SMU.hpp>
+#include <PrivateHeaders/iVega/RenoirPPSMC.hpp>
+#include <kern/clock.h>
+
+//------ Module Logic ------//
+
+static SMU instance {};
+
+SMU &SMU::singleton() { return instance; }
+
+void SMU::init() {
+    PANIC_COND(this->initialised, "SMU", "Attempted to initialise module twice!");
+    this->initialised = true;
+
+    this->lock = IORecursiveLockAlloc();
+    this->queueLock = IOSimpleLockAlloc();
+    this->drainCall = thread_call_allocate(drain, this);
+    this->publishCall = thread_call_allocate(publishTrace, this);
+    PANIC_COND(this->lock == nullptr || this->queueLock == nullptr || this->drainCall == nullptr ||
+                   this->publishCall == nullptr,
+        "SMU", "Failed to allocate the mailbox lock");
+
+    SYSLOG("SMU", "Module initialised.");
+}
+
+CAILResult SMU::send(UInt32 msg, UInt32 param, UInt32 *outParam) {
+    if (ml_at_interrupt_context()) {
+        SYSLOG("SMU", "Message 0x%X sent from interrupt context, rejected", msg);
+        return kCAILResultFailed;
+    }
+    if (IORecursiveLockHaveLock(this->lock)) {
+        SYSLOG("SMU", "Message 0x%X sent while the mailbox is in use by this thread, rejected", msg);
+        return kCAILResultFailed;
+    }
+
+    IORecursiveLockLock(this->lock);
+    // Flush what was queued before us, so the SMU sees the messages in the order they were sent.
+    Request request;
+    while (this->dequeue(request)) { this->complete(request); }
+    auto res = this->sendLocked(msg, param, outParam);
+    IORecursiveLockUnlock(this->lock);
+
+    return res;
+}
+
+bool SMU::sendAsync(UInt32 msg, UInt32 param, Completion completion, void *owner) {
+    auto state = IOSimpleLockLockDisableInterrupt(this->queueLock);
+    if (this->queueCount == MaxQueued) {
+        IOSimpleLockUnlockEnableInterrupt(this->queueLock, state);
+        SYSLOG("SMU", "Queue is full, message 0x%X rejected", msg);
+        return false;
+    }
+    this->queue[(this->queueHead + this->queueCount) % MaxQueued] = {msg, param, completion, owner};
+    this->queueCount += 1;
+    IOSimpleLockUnlockEnableInterrupt(this->queueLock, state);
+
+    thread_call_enter(this->drainCall);
+    return true;
+}
+
+bool SMU::dequeue(Request &request) {
+    auto state = IOSimpleLockLockDisableInterrupt(this->queueLock);
+    bool ret = this->queueCount != 0;
+    if (ret) {
+        request = this->queue[this->queueHead];
+        this->queueHead = (this->queueHead + 1) % MaxQueued;
+        this->queueCount -= 1;
+    }
+    IOSimpleLockUnlockEnableInterrupt(this->queueLock, state);
+    return ret;
+}
+
+// Must be called with `lock` held.
+void SMU::complete(const Request &request) {
+    UInt32 out = 0;
+    auto res = this->sendLocked(request.msg, request.param, &out);
+    if (request.completion) { request.completion(request.owner, request.msg, res, out); }
+}
+
+void SMU::drain(thread_call_param_t param0, thread_call_param_t) {
+    auto *self = static_cast<SMU *>(param0);
+    IORecursiveLockLock(self->lock);
+    Request request;
+    while (self->dequeue(request)) { self->complete(request); }
+    IORecursiveLockUnlock(self->lock);
+}
+
+void SMU::queryVersion() {
+    IORecursiveLockLock(this->lock);
+    const bool known = this->firmwareVersion != 0;
+    IORecursiveLockUnlock(this->lock);
+    if (known) { return; }
+
+    UInt32 version = 0;
+    if (this->send(PPSMC_MSG_GetSmuVersion, 0, &version) != kCAILResultSuccess) {
+        SYSLOG("SMU", "Failed to get the firmware version");
+        return;
+    }
+    IORecursiveLockLock(this->lock);
+    this->firmwareVersion = version;
+    IORecursiveLockUnlock(this->lock);
+
+    DBGLOG("SMU", "Firmware version 0x%X", version);
+    NRed::singleton().setProp32("NRed,SMUVersion", version);
+}
+
+void SMU::resetCapabilities() {
+    IORecursiveLockLock(this->lock);
+    this->firmwareVersion = 0;
+    this->unsupported = 0;
+    IORecursiveLockUnlock(this->lock);
+}
+
+// Must be called with `lock` held.
+CAILResult SMU::sendLocked(UInt32 msg, UInt32 param, UInt32 *outParam) {
+    const auto bit = msg < 64 ? (1ULL << msg) : 0;
+    if ((this->unsupported & bit) != 0) { return kCAILResultUnsupported; }
+
+    auto res = this->exchange(msg, param, outParam);
+    if (res == kCAILResultUnsupported && bit != 0) {
+        DBGLOG("SMU", "Firmware 0x%X does not support message 0x%X, it will not be sent again", this->firmwareVersion,
+            msg);
+        this->unsupported |= bit;
+    }
+    return res;
+}
+
+// Must be called with `lock` held.
+CAILResult SMU::exchange(UInt32 msg, UInt32 param, UInt32 *outParam) {
+    auto &nred = NRed::singleton();
+    const auto start = mach_absolute_time();
+
+    this->waitForResponse();
+
+    nred.writeReg32(MP_BASE + mmMP1_SMN_C2PMSG_82, param);
+    nred.writeReg32(MP_BASE + mmMP1_SMN_C2PMSG_90, 0);
+    nred.writeReg32(MP_BASE + mmMP1_SMN_C2PMSG_66, msg);
+
+    const auto resp = this->waitForResponse();
+
+    if (outParam != nullptr) { *outParam = nred.readReg32(MP_BASE + mmMP1_SMN_C2PMSG_82); }
+
+    const auto res = processSMUFWResponse(resp);
+    this->record(msg, param, resp, res, start);
+    return res;
+}
+
+UInt32 SMU::waitForResponse() {
+    const auto ret = NRed::singleton().waitForReg32(MP_BASE + mmMP1_SMN_C2PMSG_90, 0xFFFFFFFF);
+    SYSLOG_COND(ret == AMDSMUFWResponse::kSMUFWResponseNoResponse, "SMU", "SMU did not respond in time");
+    return ret;
+}
+
+// Must be called with `lock` held.
+void SMU::record(UInt32 msg, UInt32 param, UInt32 response, CAILResult result, UInt64 start) {
+    UInt64 timestamp, nanoseconds;
+    absolutetime_to_nanoseconds(start, &timestamp);
+    absolutetime_to_nanoseconds(mach_absolute_time() - start, &nanoseconds);
+
+    this->traceNext += 1;
+    auto &rec = this->trace[(this->traceNext - 1) % TraceSize];
+    rec.timestamp = timestamp;
+    rec.seq = this->traceNext;
+    rec.msg = msg;
+    rec.param = param;
+    rec.response = response;
+    rec.nanoseconds = nanoseconds > UINT32_MAX ? UINT32_MAX : static_cast<UInt32>(nanoseconds);
+    rec.result = static_cast<UInt8>(result);
+
+    if (msg < HistogramMessages) {
+        size_t bucket = nanoseconds ? 63 - __builtin_clzll(nanoseconds) : 0;
+        if (bucket >= HistogramBuckets) { bucket = HistogramBuckets - 1; }
+        this->histograms[msg][bucket] += 1;
+    }
+
+    // The exchanges of a burst are published together.
+    if (!this->publishScheduled) {
+        this->publishScheduled = true;
+        UInt64 delay;
+        nanoseconds_to_absolutetime(static_cast<UInt64>(PublishDelaySecs) * NSEC_PER_SEC, &delay);
+        thread_call_enter_delayed(this->publishCall, mach_absolute_time() + delay);
+    }
+}
+
+void SMU::publishTrace(thread_call_param_t param0, thread_call_param_t) { static_cast<SMU *>(param0)->publish(); }
+
+void SMU::publish() {
+    auto *dict = OSDictionary::withCapacity(4);
+    IORecursiveLockLock(this->lock);
+    this->publishScheduled = false;
+    auto *records = OSData::withBytes(this->trace, sizeof(this->trace));
+    auto *histograms = OSData::withBytes(this->histograms, sizeof(this->histograms));
+    IORecursiveLockUnlock(this->lock);
+    if (!dict || !records || !histograms) {
+        SYSLOG("SMU", "Failed to allocate the trace property");
+        OSSafeReleaseNULL(dict);
+        OSSafeReleaseNULL(records);
+        OSSafeReleaseNULL(histograms);
+        return;
+    }
+
+    NRed::setNumber(dict, "Version", TraceVersion);
+    NRed::setNumber(dict, "HistogramBuckets", HistogramBuckets);
+    dict->setObject("Records", records);
+    dict->setObject("Histograms", histograms);
+    NRed::singleton().setProp("NRed,SMUTrace", dict);
+    dict->release();
+    records->release();
+    histograms->release();
+}
@@ -52,8 +52,8 @@ void iVega::AppleGFXHDA::processKext(KernelPatcher &patcher, size_t id, mach_vm_
 
     const UInt32 probeFind = Navi10HDMIID;
     const UInt32 probeRepl = NRed::singleton().getAttributes().isRenoir() ? RenoirHDMIID : RavenHDMIID;
-    const LookupPatchPlus patch = {&kextAppleGFXHDA, reinterpret_cast<const UInt8 *>(&probeFind),
-        reinterpret_cast<const UInt8 *>(&probeRepl), sizeof(probeFind), 1};
+    const LookupPatchPlus patch = {&kextAppleGFXHDA, PatcherPlus::Section::Any,
+        reinterpret_cast<const UInt8 *>(&probeFind), reinterpret_cast<const UInt8 *>(&probeRepl), sizeof(probeFind), 1};
     PANIC_COND(!patch.apply(patcher, slide, size), "AGFXHDA", "Failed to apply patch for HDMI controller probe");
 
     SolveRequestPlus solveRequests[] = {
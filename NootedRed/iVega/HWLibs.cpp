@@ -5,11 +5,11 @@
 #include <PrivateHeaders/Firmware.hpp>
 #include <PrivateHeaders/GPUDriversAMD/CAIL/ASICCaps.hpp>
 #include <PrivateHeaders/GPUDriversAMD/CAIL/DevCaps.hpp>
-#include <PrivateHeaders/GPUDriversAMD/Driver.hpp>
 #include <PrivateHeaders/GPUDriversAMD/Family.hpp>
 #include <PrivateHeaders/GPUDriversAMD/PSP.hpp>
 #include <PrivateHeaders/NRed.hpp>
 #include <PrivateHeaders/PatcherPlus.hpp>
+#include <PrivateHeaders/SMU.hpp>
 #include <PrivateHeaders/iVega/ASICCaps.hpp>
 #include <PrivateHeaders/iVega/GoldenSettings.hpp>
 #include <PrivateHeaders/iVega/HWLibs.hpp>
@@ -351,6 +351,11 @@ void iVega::X5000HWLibs::processKext(KernelPatcher &patcher, size_t id, mach_vm_
     if (kextRadeonX5000HWLibs.loadIndex != id) { return; }
 
     NRed::singleton().hwLateInit();
+    UInt32 skipTAs = 0;
+    if (PE_parse_boot_argn("NRedSkipTA", &skipTAs, sizeof(skipTAs)) && skipTAs != 0) {
+        SYSLOG("HWLibs", "Skipping the trusted applications in mask 0x%X", skipTAs);
+    }
+    this->pspDispatch.build(NRed::singleton().getAttributes(), NRed::singleton().getPciRevision(), skipTAs);
 
     CAILAsicCapsEntry *orgCapsTable;
     CAILAsicCapsInitEntry *orgCapsInitTable;
@@ -361,20 +366,20 @@ void iVega::X5000HWLibs::processKext(KernelPatcher &patcher, size_t id, mach_vm_
         orgDeviceTypeTable = nullptr;
     } else {
         SolveRequestPlus solveRequests[] = {
-            {"__ZL15deviceTypeTable", orgDeviceTypeTable, kDeviceTypeTablePattern},
+            {"__ZL15deviceTypeTable", orgDeviceTypeTable, kDeviceTypeTablePattern, PatcherPlus::Section::Data},
             {"__ZN11AMDFirmware14createFirmwareEPhjjPKc", this->orgCreateFirmware, kCreateFirmwarePattern,
-                kCreateFirmwarePatternMask},
+                kCreateFirmwarePatternMask, PatcherPlus::Section::Code},
             {"__ZN20AMDFirmwareDirectory11putFirmwareE16_AMD_DEVICE_TYPEP11AMDFirmware", this->orgPutFirmware,
-                kPutFirmwarePattern},
+                kPutFirmwarePattern, PatcherPlus::Section::Code},
         };
         PANIC_COND(!SolveRequestPlus::solveAll(patcher, id, solveRequests, slide, size), "HWLibs",
             "Failed to resolve symbols");
     }
 
     SolveRequestPlus solveRequests[] = {
-        {"__ZL20CAIL_ASIC_CAPS_TABLE", orgCapsTable, kCailAsicCapsTableHWLibsPattern},
-        {"_CAILAsicCapsInitTable", orgCapsInitTable, kCAILAsicCapsInitTablePattern},
-        {"_DeviceCapabilityTbl", orgDevCapTable, kDeviceCapabilityTblPattern},
+        {"__ZL20CAIL_ASIC_CAPS_TABLE", orgCapsTable, kCailAsicCapsTableHWLibsPattern, PatcherPlus::Section::Data},
+        {"_CAILAsicCapsInitTable", orgCapsInitTable, kCAILAsicCapsInitTablePattern, PatcherPlus::Section::Data},
+        {"_DeviceCapabilityTbl", orgDevCapTable, kDeviceCapabilityTblPattern, PatcherPlus::Section::Data},
     };
     PANIC_COND(!SolveRequestPlus::solveAll(patcher, id, solveRequests, slide, size), "HWLibs",
         "Failed to resolve symbols");
@@ -435,55 +440,59 @@ void iVega::X5000HWLibs::processKext(KernelPatcher &patcher, size_t id, mach_vm_
     PANIC_COND(!request.route(patcher, id, slide, size), "HWLibs",
         "Failed to route smu_9_0_1_create_function_pointer_list");
 
-    PANIC_COND(MachInfo::setKernelWriting(true, KernelPatcher::kernelWriteLock) != KERN_SUCCESS, "HWLibs",
-        "Failed to enable kernel writing");
+    auto &transaction = KernelWriteTransaction::singleton();
     if (orgDeviceTypeTable) {
-        *orgDeviceTypeTable = {.deviceId = NRed::singleton().getDeviceID(), .deviceType = kAMDDeviceTypeNavi21};
+        transaction.write(orgDeviceTypeTable,
+            {.deviceId = NRed::singleton().getDeviceID(), .deviceType = kAMDDeviceTypeNavi21});
     }
 
     auto targetDeviceId = NRed::singleton().getAttributes().isRenoir() ? 0x1636 : NRed::singleton().getDeviceID();
     for (; orgCapsInitTable->deviceId != 0xFFFFFFFF; orgCapsInitTable++) {
         if (orgCapsInitTable->familyId == AMD_FAMILY_RAVEN && orgCapsInitTable->deviceId == targetDeviceId) {
-            orgCapsInitTable->deviceId = NRed::singleton().getDeviceID();
-            orgCapsInitTable->revision = NRed::singleton().getDevRevision();
-            orgCapsInitTable->extRevision =
+            auto capsInit = *orgCapsInitTable;
+            capsInit.deviceId = NRed::singleton().getDeviceID();
+            capsInit.revision = NRed::singleton().getDevRevision();
+            capsInit.extRevision =
                 static_cast<UInt64>(NRed::singleton().getEnumRevision()) + NRed::singleton().getDevRevision();
-            orgCapsInitTable->pciRevision = NRed::singleton().getPciRevision();
-            orgCapsInitTable->ddiCaps = NRed::singleton().getAttributes().isRenoirE() ? ddiCapsRenoirE :
-                                        NRed::singleton().getAttributes().isRenoir()  ? ddiCapsRenoir :
-                                                                                        ddiCapsRaven;
-            *orgCapsTable = {
-                .familyId = AMD_FAMILY_RAVEN,
-                .deviceId = NRed::singleton().getDeviceID(),
-                .revision = NRed::singleton().getDevRevision(),
-                .extRevision =
-                    static_cast<UInt32>(NRed::singleton().getEnumRevision()) + NRed::singleton().getDevRevision(),
-                .pciRevision = NRed::singleton().getPciRevision(),
-                .ddiCaps = orgCapsInitTable->ddiCaps,
-            };
+            capsInit.pciRevision = NRed::singleton().getPciRevision();
+            capsInit.ddiCaps = NRed::singleton().getAttributes().isRenoirE() ? ddiCapsRenoirE :
+                               NRed::singleton().getAttributes().isRenoir()  ? ddiCapsRenoir :
+                                                                               ddiCapsRaven;
+            transaction.write(orgCapsInitTable, capsInit);
+            transaction.write(orgCapsTable,
+                {
+                    .familyId = AMD_FAMILY_RAVEN,
+                    .deviceId = NRed::singleton().getDeviceID(),
+                    .revision = NRed::singleton().getDevRevision(),
+                    .extRevision =
+                        static_cast<UInt32>(NRed::singleton().getEnumRevision()) + NRed::singleton().getDevRevision(),
+                    .pciRevision = NRed::singleton().getPciRevision(),
+                    .ddiCaps = capsInit.ddiCaps,
+                });
             break;
         }
     }
     PANIC_COND(orgCapsInitTable->deviceId == 0xFFFFFFFF, "HWLibs", "Failed to find init caps table entry");
     for (; orgDevCapTable->familyId; orgDevCapTable++) {
         if (orgDevCapTable->familyId == AMD_FAMILY_RAVEN && orgDevCapTable->deviceId == targetDeviceId) {
-            orgDevCapTable->deviceId = NRed::singleton().getDeviceID();
-            orgDevCapTable->extRevision =
+            auto devCap = *orgDevCapTable;
+            devCap.deviceId = NRed::singleton().getDeviceID();
+            devCap.extRevision =
                 static_cast<UInt64>(NRed::singleton().getEnumRevision()) + NRed::singleton().getDevRevision();
-            orgDevCapTable->revision = DEVICE_CAP_ENTRY_REV_DONT_CARE;
-            orgDevCapTable->enumRevision = DEVICE_CAP_ENTRY_REV_DONT_CARE;
+            devCap.revision = DEVICE_CAP_ENTRY_REV_DONT_CARE;
+            devCap.enumRevision = DEVICE_CAP_ENTRY_REV_DONT_CARE;
+            transaction.write(orgDevCapTable, devCap);
 
-            orgDevCapTable->asicGoldenSettings->goldenSettings =
+            transaction.write(&orgDevCapTable->asicGoldenSettings->goldenSettings,
                 NRed::singleton().getAttributes().isRaven2() ? goldenSettingsRaven2 :
                 NRed::singleton().getAttributes().isRenoir() ? goldenSettingsRenoir :
-                                                               goldenSettingsRaven;
+                                                               goldenSettingsRaven);
 
             break;
         }
     }
     PANIC_COND(orgDevCapTable->familyId == 0, "HWLibs", "Failed to find device capability table entry");
-    MachInfo::setKernelWriting(false, KernelPatcher::kernelWriteLock);
-    DBGLOG("HWLibs", "Applied DDI Caps patches");
+    DBGLOG("HWLibs", "Queued DDI Caps patches");
 
     if (!NRed::singleton().getAttributes().isCatalina()) {
         const LookupPatchPlus patch {&kextRadeonX5000HWLibs, kGcSwInitOriginal, kGcSwInitOriginalMask, kGcSwInitPatched,
@@ -567,23 +576,45 @@ void iVega::X5000HWLibs::processKext(KernelPatcher &patcher, size_t id, mach_vm_
 void iVega::X5000HWLibs::wrapPopulateFirmwareDirectory(void *that) {
     FunctionCast(wrapPopulateFirmwareDirectory, singleton().orgGetIpFw)(that);
 
-    auto *filename = NRed::singleton().getAttributes().isRenoir() ? "ativvaxy_nv.dat" : "ativvaxy_rv.dat";
-    const auto &vcnFW = getFWByName(filename);
+    static constexpr FWName vcnNavi = fwLiteral("ativvaxy_nv.dat");
+    static constexpr FWName vcnRaven = fwLiteral("ativvaxy_rv.dat");
+    const auto &vcnName = NRed::singleton().getAttributes().isRenoir() ? vcnNavi : vcnRaven;
+    auto *filename = vcnName.name;
+    const auto &metadata = getFWMetadataByName(vcnName);
+    FWView vcnFW {metadata};
     DBGLOG("HWLibs", "VCN firmware filename is %s", filename);
 
     // VCN 2.2, VCN 1.0
     auto *fw = singleton().orgCreateFirmware(vcnFW.data, vcnFW.length,
         NRed::singleton().getAttributes().isRenoir() ? 0x0202 : 0x0100, filename);
     PANIC_COND(fw == nullptr, "HWLibs", "Failed to create '%s' firmware", filename);
+
+    // `createFirmware` copies the image, so ours can go; AMD's copy and the stored blob are all that stay resident.
+    // Building an `AMDFirmware` around the stored blob instead would depend on its private layout and ownership.
+    const UInt32 copy = vcnFW.isCopy() ? vcnFW.length : 0;
+    vcnFW.release();
+    const UInt32 resident = metadata.storedLength() + metadata.length;
+    SYSLOG("HWLibs", "VCN firmware: %u bytes at peak, %u bytes resident", resident + copy, resident);
+    NRed::singleton().setProp32("NRed,VCNFirmwarePeak", resident + copy);
+    NRed::singleton().setProp32("NRed,VCNFirmwareResident", resident);
+
     PANIC_COND(!singleton().orgPutFirmware(singleton().fwDirField.get(that), kAMDDeviceTypeNavi21, fw), "HWLibs",
         "Failed to insert '%s' firmware", filename);
 }
 
 bool iVega::X5000HWLibs::wrapGetIpFw(void *that, UInt32 ipVersion, char *name, void *out) {
     if (!strncmp(name, "ativvaxy_rv.dat", 16) || !strncmp(name, "ativvaxy_nv.dat", 16)) {
-        const auto &fwDesc = getFWByName(name);
-        getMember<const void *>(out, 0x0) = fwDesc.data;
-        getMember<UInt32>(out, 0x8) = fwDesc.length;
+        // The caller keeps the pointer, so the contents stay around for the lifetime of the kext.
+        auto &ipFw = singleton().ipFw;
+        if (ipFw.data == nullptr) {
+            const auto &metadata = getFWMetadataByName(name);
+            ipFw = FWView {metadata};
+            const UInt32 resident = metadata.storedLength() + (ipFw.isCopy() ? ipFw.length : 0);
+            SYSLOG("HWLibs", "VCN firmware: %u bytes resident", resident);
+            NRed::singleton().setProp32("NRed,VCNFirmwareResident", resident);
+        }
+        getMember<const void *>(out, 0x0) = ipFw.data;
+        getMember<UInt32>(out, 0x8) = ipFw.length;
         return true;
     }
     return FunctionCast(wrapGetIpFw, singleton().orgGetIpFw)(that, ipVersion, name, out);
@@ -632,129 +663,39 @@ CAILResult iVega::X5000HWLibs::pspSecurityFeatureCapsSet12(void *ctx) {
 }
 
 CAILResult iVega::X5000HWLibs::wrapPspCmdKmSubmit(void *ctx, void *cmd, void *outData, void *outResponse) {
-    char filename[64];
-    bzero(filename, sizeof(filename));
-
     auto *data = singleton().pspCommandDataField.get(ctx);
+    const auto &dispatch = singleton().pspDispatch;
 
+    const PSPLoadEntry *entry;
     switch (getMember<AMDPSPCommand>(cmd, 0x0)) {
-        case kPSPCommandLoadTA: {
-            const char *name = reinterpret_cast<char *>(data + 0x8DB);
-            if (!strncmp(name, "AMD DTM Application", 20)) {
-                strncpy(filename, "psp_dtm.bin", 12);
-                break;
-            }
-            if (!strncmp(name, "AMD HDCP Application", 21)) {
-                strncpy(filename, "psp_hdcp.bin", 13);
-                break;
-            }
-            if (!strncmp(name, "AMD AUC Application", 20)) {
-                strncpy(filename, "psp_auc.bin", 12);
-                break;
-            }
-            if (!strncmp(name, "AMD FP Application", 19)) {
-                strncpy(filename, "psp_fp.bin", 11);
-                break;
-            }
-            return FunctionCast(wrapPspCmdKmSubmit, singleton().orgPspCmdKmSubmit)(ctx, cmd, outData, outResponse);
-        }
-        case kPSPCommandLoadASD: {
-            strncpy(filename, "psp_asd.bin", 12);
+        case kPSPCommandLoadTA:
+            entry = &dispatch.getTA(reinterpret_cast<char *>(data + 0x8DB));
             break;
-        }
-        case kPSPCommandLoadIPFW: {
-            auto *prefix = NRed::singleton().getAttributes().getGCPrefix();
-            switch (getMember<AMDUCodeID>(cmd, 0x10)) {
-                case kUCodeCE:
-                    snprintf(filename, sizeof(filename), "%sce_ucode.bin", prefix);
-                    break;
-                case kUCodePFP:
-                    snprintf(filename, sizeof(filename), "%spfp_ucode.bin", prefix);
-                    break;
-                case kUCodeME:
-                    snprintf(filename, sizeof(filename), "%sme_ucode.bin", prefix);
-                    break;
-                case kUCodeMEC1JT:
-                    snprintf(filename, sizeof(filename), "%smec_jt_ucode.bin", prefix);
-                    break;
-                case kUCodeMEC2JT:
-                    if (NRed::singleton().getAttributes().isRenoir()) { return kCAILResultSuccess; }
-                    snprintf(filename, sizeof(filename), "%smec_jt_ucode.bin", prefix);
-                    break;
-                case kUCodeMEC1:
-                    snprintf(filename, sizeof(filename), "%smec_ucode.bin", prefix);
-                    break;
-                case kUCodeMEC2:
-                    if (NRed::singleton().getAttributes().isRenoir()) { return kCAILResultSuccess; }
-                    snprintf(filename, sizeof(filename), "%smec_ucode.bin", prefix);
-                    break;
-                case kUCodeRLC:
-                    // Fake CGPG
-                    if ((!NRed::singleton().getAttributes().isPicasso() &&
-                            !NRed::singleton().getAttributes().isRaven2() &&
-                            NRed::singleton().getAttributes().isRaven()) ||
-                        (NRed::singleton().getAttributes().isPicasso() &&
-                            ((NRed::singleton().getPciRevision() >= 0xC8 &&
-                                 NRed::singleton().getPciRevision() <= 0xCC) ||
-                                (NRed::singleton().getPciRevision() >= 0xD8 &&
-                                    NRed::singleton().getPciRevision() <= 0xDD)))) {
-                        snprintf(filename, sizeof(filename), "%srlc_fake_cgpg_ucode.bin", prefix);
-                    } else {
-                        snprintf(filename, sizeof(filename), "%srlc_ucode.bin", prefix);
-                    }
-                    break;
-                case kUCodeSDMA0:
-                    strncpy(filename, "sdma_4_1_ucode.bin", 19);
-                    break;
-                case kUCodeDMCUERAM:
-                    if (NRed::singleton().getAttributes().isRenoir()) {
-                        strncpy(filename, "dmcu_eram_dcn21.bin", 20);
-                    } else {
-                        strncpy(filename, "dmcu_eram_dcn10.bin", 20);
-                    }
-                    break;
-                case kUCodeDMCUISR:
-                    if (NRed::singleton().getAttributes().isRenoir()) {
-                        strncpy(filename, "dmcu_intvectors_dcn21.bin", 26);
-                    } else {
-                        strncpy(filename, "dmcu_intvectors_dcn10.bin", 26);
-                    }
-                    break;
-                case kUCodeRLCV:
-                    // No RLC V on Renoir
-                    if (NRed::singleton().getAttributes().isRenoir()) { return kCAILResultSuccess; }
-                    snprintf(filename, sizeof(filename), "%srlcv_ucode.bin", prefix);
-                    break;
-                case kUCodeRLCSRListGPM:
-                    snprintf(filename, sizeof(filename), "%srlc_srlist_gpm_mem.bin", prefix);
-                    break;
-                case kUCodeRLCSRListSRM:
-                    snprintf(filename, sizeof(filename), "%srlc_srlist_srm_mem.bin", prefix);
-                    break;
-                case kUCodeRLCSRListCntl:
-                    snprintf(filename, sizeof(filename), "%srlc_srlist_cntl.bin", prefix);
-                    break;
-                case kUCodeDMCUB:
-                    // Just in case
-                    if (NRed::singleton().getAttributes().isRenoir()) {
-                        strncpy(filename, "atidmcub_rn.dat", 16);
-                        break;
-                    }
-                    SYSLOG("HWLibs", "DMCU version B is not supposed to be loaded on this ASIC!");
-                    return kCAILResultSuccess;
-                default:
-                    return FunctionCast(wrapPspCmdKmSubmit, singleton().orgPspCmdKmSubmit)(ctx, cmd, outData,
-                        outResponse);
-            }
+        case kPSPCommandLoadASD:
+            entry = &dispatch.getASD();
+            break;
+        case kPSPCommandLoadIPFW:
+            entry = &dispatch.getIPFW(getMember<AMDUCodeID>(cmd, 0x10));
             break;
-        }
         default:
             return FunctionCast(wrapPspCmdKmSubmit, singleton().orgPspCmdKmSubmit)(ctx, cmd, outData, outResponse);
     }
 
-    const auto &fw = getFWByName(filename);
-    memcpy(data, fw.data, fw.length);
-    getMember<UInt32>(cmd, 0xC) = fw.length;
+    switch (entry->action) {
+        case PSPLoadAction::PassThrough:
+            break;
+        case PSPLoadAction::Unexpected:
+            SYSLOG("HWLibs", "UCode %u is not supposed to be loaded on this ASIC!", getMember<UInt32>(cmd, 0x10));
+            [[fallthrough]];
+        case PSPLoadAction::Skip:
+            DBGLOG("HWLibs", "Skipping PSP load (command %u)", getMember<UInt32>(cmd, 0x0));
+            return kCAILResultSuccess;
+        case PSPLoadAction::Load:
+            // Decompressed straight into the command buffer, no intermediate copy is kept.
+            entry->fw->metadata.copyTo(data);
+            getMember<UInt32>(cmd, 0xC) = entry->fw->metadata.length;
+            break;
+    }
 
     return FunctionCast(wrapPspCmdKmSubmit, singleton().orgPspCmdKmSubmit)(ctx, cmd, outData, outResponse);
 }
@@ -787,6 +728,8 @@ CAILResult iVega::X5000HWLibs::smuInternalSwInit(void *ctx) {
 }
 
 CAILResult iVega::X5000HWLibs::smu10InternalHwInit(void *) {
+    SMU::singleton().queryVersion();
+
     auto res = smuReset();
     if (res != kCAILResultSuccess) { return res; }
 
@@ -794,15 +737,12 @@ CAILResult iVega::X5000HWLibs::smu10InternalHwInit(void *) {
 }
 
 CAILResult iVega::X5000HWLibs::smu12InternalHwInit(void *) {
-    UInt32 i = 0;
-    for (; i < AMD_MAX_USEC_TIMEOUT; i++) {
-        if (NRed::singleton().readReg32(MP1_Public | smnMP1_FIRMWARE_FLAGS) &
-            smnMP1_FIRMWARE_FLAGS_INTERRUPTS_ENABLED) {
-            break;
-        }
-        IOSleep(1);
-    }
-    if (i >= AMD_MAX_USEC_TIMEOUT) { return kCAILResultFailed; }
+    // The firmware can take long to come up, so this waits `AMD_MAX_USEC_TIMEOUT` milliseconds, not the SMU timeout.
+    const auto flags = NRed::singleton().waitForReg32(MP1_Public | smnMP1_FIRMWARE_FLAGS,
+        smnMP1_FIRMWARE_FLAGS_INTERRUPTS_ENABLED, AMD_MAX_USEC_TIMEOUT * 1000);
+    if ((flags & smnMP1_FIRMWARE_FLAGS_INTERRUPTS_ENABLED) == 0) { return kCAILResultFailed; }
+
+    SMU::singleton().queryVersion();
 
     auto res = smuReset();
     if (res != kCAILResultSuccess) { return res; }
@@ -819,7 +759,9 @@ CAILResult iVega::X5000HWLibs::smu12InternalHwInit(void *) {
 CAILResult iVega::X5000HWLibs::smuInternalHwExit(void *) { return smuReset(); }
 
 CAILResult iVega::X5000HWLibs::smuFullAsicReset(void *, void *data) {
-    return NRed::singleton().sendMsgToSmc(PPSMC_MSG_DeviceDriverReset, getMember<UInt32>(data, 4));
+    auto res = NRed::singleton().sendMsgToSmc(PPSMC_MSG_DeviceDriverReset, getMember<UInt32>(data, 4));
+    SMU::singleton().resetCapabilities();
+    return res;
 }
 
 CAILResult iVega::X5000HWLibs::smu10NotifyEvent(void *, void *data) {
@@ -0,0 +1,83 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+#include <PrivateHeaders/iVega/PSPDispatch.hpp>
+
+static const iVega::PSPLoadEntry PassThroughEntry {};
+
+// Trusted applications, by the name AMD puts in the command, and the file served for them.
+static const struct {
+    const char *name;
+    const char *filename;
+    UInt32 bit;
+} TrustedApplications[] = {
+    {"AMD DTM Application", "psp_dtm.bin", iVega::kPSPTADTM},
+    {"AMD HDCP Application", "psp_hdcp.bin", iVega::kPSPTAHDCP},
+    {"AMD AUC Application", "psp_auc.bin", iVega::kPSPTAAUC},
+    {"AMD FP Application", "psp_fp.bin", iVega::kPSPTAFP},
+};
+
+static iVega::PSPLoadEntry load(const char *filename) {
+    return {.action = iVega::PSPLoadAction::Load, .fw = &getFWDescriptorByName(filename)};
+}
+
+static iVega::PSPLoadEntry loadGC(const char *prefix, const char *suffix) {
+    char filename[64];
+    snprintf(filename, sizeof(filename), "%s%s", prefix, suffix);
+    return load(filename);
+}
+
+void iVega::PSPDispatch::build(const NRedAttributes &attributes, UInt32 pciRevision, UInt32 skipTAs) {
+    static_assert(arrsize(TrustedApplications) == TACount);
+
+    const PSPLoadEntry skip {.action = PSPLoadAction::Skip};
+
+    for (auto &entry : this->ipfw) { entry = {}; }
+    // AMD is told the load succeeded, so features backed by a skipped application fail when first used instead.
+    for (size_t i = 0; i < TACount; i++) {
+        this->ta[i] = (skipTAs & TrustedApplications[i].bit) ? skip : load(TrustedApplications[i].filename);
+    }
+    this->asd = load("psp_asd.bin");
+    const auto *prefix = attributes.getGCPrefix();
+    const auto renoir = attributes.isRenoir();
+
+    this->ipfw[kUCodeCE] = loadGC(prefix, "ce_ucode.bin");
+    this->ipfw[kUCodePFP] = loadGC(prefix, "pfp_ucode.bin");
+    this->ipfw[kUCodeME] = loadGC(prefix, "me_ucode.bin");
+    this->ipfw[kUCodeMEC1JT] = loadGC(prefix, "mec_jt_ucode.bin");
+    this->ipfw[kUCodeMEC2JT] = renoir ? skip : loadGC(prefix, "mec_jt_ucode.bin");
+    this->ipfw[kUCodeMEC1] = loadGC(prefix, "mec_ucode.bin");
+    this->ipfw[kUCodeMEC2] = renoir ? skip : loadGC(prefix, "mec_ucode.bin");
+
+    // Fake CGPG
+    if ((!attributes.isPicasso() && !attributes.isRaven2() && attributes.isRaven()) ||
+        (attributes.isPicasso() &&
+            ((pciRevision >= 0xC8 && pciRevision <= 0xCC) || (pciRevision >= 0xD8 && pciRevision <= 0xDD)))) {
+        this->ipfw[kUCodeRLC] = loadGC(prefix, "rlc_fake_cgpg_ucode.bin");
+    } else {
+        this->ipfw[kUCodeRLC] = loadGC(prefix, "rlc_ucode.bin");
+    }
+
+    this->ipfw[kUCodeSDMA0] = load("sdma_4_1_ucode.bin");
+    this->ipfw[kUCodeDMCUERAM] = load(renoir ? "dmcu_eram_dcn21.bin" : "dmcu_eram_dcn10.bin");
+    this->ipfw[kUCodeDMCUISR] = load(renoir ? "dmcu_intvectors_dcn21.bin" : "dmcu_intvectors_dcn10.bin");
+    // No RLC V on Renoir
+    this->ipfw[kUCodeRLCV] = renoir ? skip : loadGC(prefix, "rlcv_ucode.bin");
+    this->ipfw[kUCodeRLCSRListGPM] = loadGC(prefix, "rlc_srlist_gpm_mem.bin");
+    this->ipfw[kUCodeRLCSRListSRM] = loadGC(prefix, "rlc_srlist_srm_mem.bin");
+    this->ipfw[kUCodeRLCSRListCntl] = loadGC(prefix, "rlc_srlist_cntl.bin");
+    // Just in case
+    this->ipfw[kUCodeDMCUB] = renoir ? load("atidmcub_rn.dat") : PSPLoadEntry {.action = PSPLoadAction::Unexpected};
+}
+
+const iVega::PSPLoadEntry &iVega::PSPDispatch::getIPFW(UInt32 ucodeID) const {
+    return ucodeID < UCodeCount ? this->ipfw[ucodeID] : PassThroughEntry;
+}
+
+const iVega::PSPLoadEntry &iVega::PSPDispatch::getTA(const char *name) const {
+    for (size_t i = 0; i < TACount; i++) {
+        const auto *taName = TrustedApplications[i].name;
+        if (!strncmp(name, taName, strlen(taName) + 1)) { return this->ta[i]; }
+    }
+    return PassThroughEntry;
+}
@@ -6,6 +6,7 @@
 #include <PrivateHeaders/Firmware.hpp>
 #include <PrivateHeaders/GPUDriversAMD/Family.hpp>
 #include <PrivateHeaders/GPUDriversAMD/Linux.hpp>
+#include <PrivateHeaders/MetaCast.hpp>
 #include <PrivateHeaders/NRed.hpp>
 #include <PrivateHeaders/PatcherPlus.hpp>
 #include <PrivateHeaders/iVega/X5000.hpp>
@@ -142,18 +143,19 @@ void iVega::X5000::processKext(KernelPatcher &patcher, size_t id, mach_vm_addres
                 "__ZZN37AMDRadeonX5000_AMDGraphicsAccelerator22getAdditionalQueueListEPPK18_"
                 "AMDQueueSpecifierE27additionalQueueList_Default" :
                 "__ZZN37AMDRadeonX5000_AMDGraphicsAccelerator19createAccelChannelsEbE12channelTypes",
-            orgChannelTypes, kChannelTypesPattern},
+            orgChannelTypes, kChannelTypesPattern, PatcherPlus::Section::Data},
         {"__ZN31AMDRadeonX5000_AMDGFX9PM4EngineC1Ev", this->orgGFX9PM4EngineConstructor},
         {"__ZN32AMDRadeonX5000_AMDGFX9SDMAEngineC1Ev", this->orgGFX9SDMAEngineConstructor},
-        {"__ZN35AMDRadeonX5000_AMDAccelVideoContext10gMetaClassE", NRed::singleton().metaClassMap[0][0]},
-        {"__ZN37AMDRadeonX5000_AMDAccelDisplayMachine10gMetaClassE", NRed::singleton().metaClassMap[1][0]},
-        {"__ZN34AMDRadeonX5000_AMDAccelDisplayPipe10gMetaClassE", NRed::singleton().metaClassMap[2][0]},
-        {"__ZN30AMDRadeonX5000_AMDAccelChannel10gMetaClassE", NRed::singleton().metaClassMap[3][1]},
-        {"__ZN28AMDRadeonX5000_IAMDHWChannel10gMetaClassE", NRed::singleton().metaClassMap[4][0]},
+        {"__ZN35AMDRadeonX5000_AMDAccelVideoContext10gMetaClassE", MetaCast::singleton().classMap[0][0]},
+        {"__ZN37AMDRadeonX5000_AMDAccelDisplayMachine10gMetaClassE", MetaCast::singleton().classMap[1][0]},
+        {"__ZN34AMDRadeonX5000_AMDAccelDisplayPipe10gMetaClassE", MetaCast::singleton().classMap[2][0]},
+        {"__ZN30AMDRadeonX5000_AMDAccelChannel10gMetaClassE", MetaCast::singleton().classMap[3][1]},
+        {"__ZN28AMDRadeonX5000_IAMDHWChannel10gMetaClassE", MetaCast::singleton().classMap[4][0]},
         {"__ZN26AMDRadeonX5000_AMDHardware14startHWEnginesEv", startHWEngines},
     };
     PANIC_COND(!SolveRequestPlus::solveAll(patcher, id, solveRequests, slide, size), "X5000",
         "Failed to resolve symbols");
+    MetaCast::singleton().rebuildFilter();
 
     RouteRequestPlus requests[] = {
         {"__ZN32AMDRadeonX5000_AMDVega10Hardware17allocateHWEnginesEv", wrapAllocateHWEngines},
@@ -220,11 +222,8 @@ void iVega::X5000::processKext(KernelPatcher &patcher, size_t id, mach_vm_addres
                 "Failed to patch swizzle mode");
         }
 
-        PANIC_COND(MachInfo::setKernelWriting(true, KernelPatcher::kernelWriteLock) != KERN_SUCCESS, "X5000",
-            "Failed to enable kernel writing");
-        *orgChannelTypes = 1;    // Make VMPT use SDMA0 instead of SDMA1
-        MachInfo::setKernelWriting(false, KernelPatcher::kernelWriteLock);
-        DBGLOG("X5000", "Applied SDMA1 patches");
+        KernelWriteTransaction::singleton().write(orgChannelTypes, 1);    // Make VMPT use SDMA0 instead of SDMA1
+        DBGLOG("X5000", "Queued SDMA1 patches");
     } else {
         const LookupPatchPlus patch {&kextRadeonX5000, kStartHWEnginesOriginal, kStartHWEnginesMask,
             kStartHWEnginesPatched, kStartHWEnginesMask,
@@ -246,14 +245,12 @@ void iVega::X5000::processKext(KernelPatcher &patcher, size_t id, mach_vm_addres
                 "Failed to patch swizzle mode");
         }
 
-        PANIC_COND(MachInfo::setKernelWriting(true, KernelPatcher::kernelWriteLock) != KERN_SUCCESS, "X5000",
-            "Failed to enable kernel writing");
         // createAccelChannels: stop at SDMA0
-        orgChannelTypes[5] = 1;
+        KernelWriteTransaction::singleton().write(&orgChannelTypes[5], 1);
         // getPagingChannel: get only SDMA0
-        orgChannelTypes[NRed::singleton().getAttributes().isMontereyAndLater() ? 12 : 11] = 0;
-        MachInfo::setKernelWriting(false, KernelPatcher::kernelWriteLock);
-        DBGLOG("X5000", "Applied SDMA1 patches");
+        KernelWriteTransaction::singleton().write(
+            &orgChannelTypes[NRed::singleton().getAttributes().isMontereyAndLater() ? 12 : 11], 0);
+        DBGLOG("X5000", "Queued SDMA1 patches");
     }
 }
 
@@ -288,13 +285,15 @@ void iVega::X5000::wrapGFX9SetupAndInitializeHWCapabilities(void *that) {
     char filename[128] = {0};
     snprintf(filename, arrsize(filename), "%s_gpu_info.bin",
         NRed::singleton().getAttributes().isRenoir() ? "renoir" : NRed::singleton().getAttributes().getChipName());
-    const auto &gpuInfoBin = getFWByName(filename);
-    auto *header = reinterpret_cast<const CommonFirmwareHeader *>(gpuInfoBin.data);
-    auto *gpuInfo = reinterpret_cast<const GPUInfoFirmware *>(gpuInfoBin.data + header->ucodeOff);
-
-    singleton().seCountField.set(that, gpuInfo->gcNumSe);
-    singleton().shPerSEField.set(that, gpuInfo->gcNumShPerSe);
-    singleton().cuPerSHField.set(that, gpuInfo->gcNumCuPerSh);
+    {
+        const auto gpuInfoBin = getFWByName(filename);
+        auto *header = reinterpret_cast<const CommonFirmwareHeader *>(gpuInfoBin.data);
+        auto *gpuInfo = reinterpret_cast<const GPUInfoFirmware *>(gpuInfoBin.data + header->ucodeOff);
+
+        singleton().seCountField.set(that, gpuInfo->gcNumSe);
+        singleton().shPerSEField.set(that, gpuInfo->gcNumShPerSe);
+        singleton().cuPerSHField.set(that, gpuInfo->gcNumCuPerSh);
+    }
 
     FunctionCast(wrapGFX9SetupAndInitializeHWCapabilities, singleton().orgGFX9SetupAndInitializeHWCapabilities)(that);
     DBGLOG("X5000", "GFX9::setupAndInitializeHWCapabilities >>");
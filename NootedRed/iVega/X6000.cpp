@@ -2,6 +2,7 @@
 // See LICENSE for details.
 
 #include <Headers/kern_api.hpp>
+#include <PrivateHeaders/MetaCast.hpp>
 #include <PrivateHeaders/NRed.hpp>
 #include <PrivateHeaders/PatcherPlus.hpp>
 #include <PrivateHeaders/iVega/Regs/DCN1.hpp>
@@ -199,24 +200,19 @@ template<UInt32 N>
 struct HWAlignVTableFix {
     const UInt32 offs[N];
     const UInt32 occurances[N];
-    const UInt32 len {N};
 
-    void apply(void *toFunction) const {
-        for (UInt32 i = 0; i < this->len; i += 1) {
+    void apply(void *toFunction, mach_vm_address_t slide, size_t size) const {
+        PatcherPlus::DisplacementFix fixes[N];
+        for (UInt32 i = 0; i < N; i += 1) {
             const UInt32 off = this->offs[i];
-            const UInt32 newOff = (off == 0x128) ? 0x230 : (off - 8);
-            const UInt32 count = this->occurances[i];
-            const UInt8 vtableCallPattern[] = {0xFF, 0x00, static_cast<UInt8>(off & 0xFF),
-                static_cast<UInt8>((off >> 8) & 0xFF), static_cast<UInt8>((off >> 16) & 0xFF),
-                static_cast<UInt8>((off >> 24) & 0xFF)};
-            const UInt8 vtableCallMask[] = {0xFF, 0x00, 0xFF, 0xFF, 0xFF, 0xFF};
-            const UInt8 vtableCallReplacement[] = {0xFF, 0x00, static_cast<UInt8>(newOff & 0xFF),
-                static_cast<UInt8>((newOff >> 8) & 0xFF), static_cast<UInt8>((newOff >> 16) & 0xFF),
-                static_cast<UInt8>((newOff >> 24) & 0xFF)};
-            PANIC_COND(!KernelPatcher::findAndReplaceWithMask(toFunction, PAGE_SIZE, vtableCallPattern, vtableCallMask,
-                           vtableCallReplacement, vtableCallMask, count, 0),
-                "X6000", "Failed to apply virtual call fix");
+            fixes[i] = {off, (off == 0x128) ? 0x230 : (off - 8), this->occurances[i]};
         }
+
+        // The call sites are within a page of the function start; the window only stops early at the end of the image.
+        const auto function = reinterpret_cast<mach_vm_address_t>(toFunction);
+        const size_t window = slide + size - function < PAGE_SIZE ? slide + size - function : PAGE_SIZE;
+        PANIC_COND(!PatcherPlus::remapDisplacements(static_cast<UInt8 *>(toFunction), window, fixes, N), "X6000",
+            "Failed to apply virtual call fix");
     }
 };
 
@@ -286,11 +282,11 @@ void iVega::X6000::processKext(KernelPatcher &patcher, size_t id, mach_vm_addres
 
     SolveRequestPlus solveRequests[] = {
         {"__ZN31AMDRadeonX6000_AMDGFX10Hardware20allocateAMDHWDisplayEv", this->orgAllocateAMDHWDisplay},
-        {"__ZN35AMDRadeonX6000_AMDAccelVideoContext10gMetaClassE", NRed::singleton().metaClassMap[0][1]},
-        {"__ZN37AMDRadeonX6000_AMDAccelDisplayMachine10gMetaClassE", NRed::singleton().metaClassMap[1][1]},
-        {"__ZN34AMDRadeonX6000_AMDAccelDisplayPipe10gMetaClassE", NRed::singleton().metaClassMap[2][1]},
-        {"__ZN30AMDRadeonX6000_AMDAccelChannel10gMetaClassE", NRed::singleton().metaClassMap[3][0]},
-        {"__ZN28AMDRadeonX6000_IAMDHWChannel10gMetaClassE", NRed::singleton().metaClassMap[4][1]},
+        {"__ZN35AMDRadeonX6000_AMDAccelVideoContext10gMetaClassE", MetaCast::singleton().classMap[0][1]},
+        {"__ZN37AMDRadeonX6000_AMDAccelDisplayMachine10gMetaClassE", MetaCast::singleton().classMap[1][1]},
+        {"__ZN34AMDRadeonX6000_AMDAccelDisplayPipe10gMetaClassE", MetaCast::singleton().classMap[2][1]},
+        {"__ZN30AMDRadeonX6000_AMDAccelChannel10gMetaClassE", MetaCast::singleton().classMap[3][0]},
+        {"__ZN28AMDRadeonX6000_IAMDHWChannel10gMetaClassE", MetaCast::singleton().classMap[4][1]},
         {"__ZN27AMDRadeonX6000_AMDHWDisplay14fillUBMSurfaceEjP17_FRAMEBUFFER_INFOP13_UBM_SURFINFO", orgFillUBMSurface},
         {"__ZN27AMDRadeonX6000_AMDHWDisplay16configureDisplayEjjP17_FRAMEBUFFER_INFOP16IOAccelResource2",
             orgConfigureDisplay},
@@ -298,6 +294,7 @@ void iVega::X6000::processKext(KernelPatcher &patcher, size_t id, mach_vm_addres
     };
     PANIC_COND(!SolveRequestPlus::solveAll(patcher, id, solveRequests, slide, size), "X6000",
         "Failed to resolve symbols");
+    MetaCast::singleton().rebuildFilter();
 
     if (NRed::singleton().getAttributes().isVenturaAndLater()) {
         orgAllocateScanoutFB = nullptr;
@@ -422,10 +419,10 @@ void iVega::X6000::processKext(KernelPatcher &patcher, size_t id, mach_vm_addres
     }
 
     // Now, for AMDHWDisplay, fix the VTable offsets to calls in HWAlignManager2.
-    FillUBMSurfaceVTFix.apply(orgFillUBMSurface);
-    ConfigureDisplayVTFix.apply(orgConfigureDisplay);
-    GetDisplayInfoVTFix.apply(orgGetDisplayInfo);
-    if (orgAllocateScanoutFB != nullptr) { AllocateScanoutFBVTFix.apply(orgAllocateScanoutFB); }
+    FillUBMSurfaceVTFix.apply(orgFillUBMSurface, slide, size);
+    ConfigureDisplayVTFix.apply(orgConfigureDisplay, slide, size);
+    GetDisplayInfoVTFix.apply(orgGetDisplayInfo, slide, size);
+    if (orgAllocateScanoutFB != nullptr) { AllocateScanoutFBVTFix.apply(orgAllocateScanoutFB, slide, size); }
 }
 
 /**
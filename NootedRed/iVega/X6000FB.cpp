@@ -223,7 +223,7 @@ void iVega::X6000FB::processKext(KernelPatcher &patcher, size_t id, mach_vm_addr
 
     CAILAsicCapsEntry *orgAsicCapsTable;
     SolveRequestPlus cailAsicCapsSolveRequest {"__ZL20CAIL_ASIC_CAPS_TABLE", orgAsicCapsTable,
-        kCailAsicCapsTablePattern};
+        kCailAsicCapsTablePattern, PatcherPlus::Section::Data};
     PANIC_COND(!cailAsicCapsSolveRequest.solve(patcher, id, slide, size), "X6000FB",
         "Failed to resolve CAIL_ASIC_CAPS_TABLE");
 
@@ -334,33 +334,32 @@ void iVega::X6000FB::processKext(KernelPatcher &patcher, size_t id, mach_vm_addr
         }
     }
 
-    PANIC_COND(MachInfo::setKernelWriting(true, KernelPatcher::kernelWriteLock) != KERN_SUCCESS, "X6000FB",
-        "Failed to enable kernel writing");
-    orgAsicCapsTable->familyId = AMD_FAMILY_RAVEN;
-    orgAsicCapsTable->ddiCaps = NRed::singleton().getAttributes().isRenoirE() ? ddiCapsRenoirE :
-                                NRed::singleton().getAttributes().isRenoir()  ? ddiCapsRenoir :
-                                                                                ddiCapsRaven;
-    orgAsicCapsTable->deviceId = NRed::singleton().getDeviceID();
-    orgAsicCapsTable->revision = NRed::singleton().getDevRevision();
-    orgAsicCapsTable->extRevision =
+    auto asicCaps = *orgAsicCapsTable;
+    asicCaps.familyId = AMD_FAMILY_RAVEN;
+    asicCaps.ddiCaps = NRed::singleton().getAttributes().isRenoirE() ? ddiCapsRenoirE :
+                       NRed::singleton().getAttributes().isRenoir()  ? ddiCapsRenoir :
+                                                                       ddiCapsRaven;
+    asicCaps.deviceId = NRed::singleton().getDeviceID();
+    asicCaps.revision = NRed::singleton().getDevRevision();
+    asicCaps.extRevision =
         static_cast<UInt32>(NRed::singleton().getEnumRevision()) + NRed::singleton().getDevRevision();
-    orgAsicCapsTable->pciRevision = NRed::singleton().getPciRevision();
-    MachInfo::setKernelWriting(false, KernelPatcher::kernelWriteLock);
-    DBGLOG("X6000FB", "Applied DDI Caps patches");
+    asicCaps.pciRevision = NRed::singleton().getPciRevision();
+    KernelWriteTransaction::singleton().write(orgAsicCapsTable, asicCaps);
+    DBGLOG("X6000FB", "Queued DDI Caps patches");
 
     // XX: DCN 2 and newer have 6 display pipes, while DCN 1 (which is what Raven has) has only 4.
     // We need to patch the kext to create only 4 cursors, links and underflow trackers.
     if (NRed::singleton().getAttributes().isRaven()) {
-        auto *const orgCreateControllerServices = patcher.solveSymbol<void *>(id,
+        auto *const orgCreateControllerServices = PatcherPlus::solveSymbol<void *>(patcher, id,
             "__ZN40AMDRadeonX6000_AmdRadeonControllerNavi1024createControllerServicesEv", slide, size);
         PANIC_COND(orgCreateControllerServices == nullptr, "X6000FB", "Failed to solve createControllerServices");
 
-        auto *const orgSetupCursors =
-            patcher.solveSymbol<void *>(id, "__ZN34AMDRadeonX6000_AmdRadeonController12setupCursorsEv", slide, size);
+        auto *const orgSetupCursors = PatcherPlus::solveSymbol<void *>(patcher, id,
+            "__ZN34AMDRadeonX6000_AmdRadeonController12setupCursorsEv", slide, size);
         PANIC_COND(orgSetupCursors == nullptr, "X6000FB", "Failed to solve setupCursors");
 
-        auto *const orgCreateLinks =
-            patcher.solveSymbol<void *>(id, "__ZN34AMDRadeonX6000_AmdRadeonController11createLinksEv", slide, size);
+        auto *const orgCreateLinks = PatcherPlus::solveSymbol<void *>(patcher, id,
+            "__ZN34AMDRadeonX6000_AmdRadeonController11createLinksEv", slide, size);
         PANIC_COND(orgCreateLinks == nullptr, "X6000FB", "Failed to solve createLinks");
 
         if (NRed::singleton().getAttributes().isCatalina()) {
@@ -479,7 +478,7 @@ UInt32 iVega::X6000FB::wrapGetNumberOfConnectors(void *that) {
 
 bool iVega::X6000FB::wrapIH40IVRingInitHardware(void *ctx, void *param2) {
     auto ret = FunctionCast(wrapIH40IVRingInitHardware, singleton().orgIH40IVRingInitHardware)(ctx, param2);
-    NRed::singleton().writeReg32(mmIH_CHICKEN, NRed::singleton().readReg32(mmIH_CHICKEN) | mmIH_MC_SPACE_GPA_ENABLE);
+    NRed::singleton().modifyReg32(mmIH_CHICKEN, mmIH_MC_SPACE_GPA_ENABLE, mmIH_MC_SPACE_GPA_ENABLE);
     return ret;
 }
 
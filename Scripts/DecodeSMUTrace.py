@@ -0,0 +1,112 @@
+#!/usr/bin/python3
+
+# Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+# See LICENSE for details.
+
+# Turns the `NRed,SMUTrace` property of the IGPU into a list of the last SMU exchanges and per-message latency
+# histograms. Message names are taken from the PPSMC headers in the sources.
+#
+# Usage: ioreg -a -r -n IGPU | DecodeSMUTrace.py [-s <source root>] [-n <rows>]
+#        DecodeSMUTrace.py <saved ioreg plist>
+
+import argparse
+import os
+import plistlib
+import re
+import struct
+import sys
+
+PROPERTY = "NRed,SMUTrace"
+VERSION = 1
+RECORD = struct.Struct("<QIIIIIB3x")
+RESULTS = ["Success", "InvalidArgument", "Failed", "Uninitialised", "Unsupported"]
+RESPONSES = {0x0: "NoResponse", 0x1: "OK", 0xFC: "RejectedBusy", 0xFD: "RejectedPrereq", 0xFE: "UnknownCommand",
+             0xFF: "Failed"}
+HEADERS = ["RavenPPSMC.hpp", "RenoirPPSMC.hpp"]
+
+
+def load_names(root):
+    names = {}
+    for base, _, files in os.walk(root):
+        for file in sorted(files):
+            if file not in HEADERS:
+                continue
+            with open(os.path.join(base, file), encoding="utf-8") as f:
+                for name, value in re.findall(r"constexpr UInt32 PPSMC_MSG_(\w+) = (0x[0-9A-Fa-f]+|\d+);", f.read()):
+                    names.setdefault(int(value, 0), set()).add(name)
+    return {value: "/".join(sorted(aliases)) for value, aliases in names.items()}
+
+
+def find_property(obj):
+    if isinstance(obj, dict):
+        if PROPERTY in obj:
+            return obj[PROPERTY]
+        children = obj.values()
+    elif isinstance(obj, list):
+        children = obj
+    else:
+        return None
+    for child in children:
+        found = find_property(child)
+        if found is not None:
+            return found
+    return None
+
+
+def format_ns(ns):
+    if ns >= 1000000:
+        return f"{ns / 1000000:.2f} ms"
+    if ns >= 1000:
+        return f"{ns / 1000:.1f} us"
+    return f"{ns} ns"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode the SMU flight recorder published by NootedRed.")
+    parser.add_argument("input", nargs="?", help="ioreg -a output; read from stdin if omitted")
+    parser.add_argument("-s", "--sources", default=os.path.join(os.path.dirname(__file__), "..", "NootedRed"))
+    parser.add_argument("-n", "--rows", type=int, default=0, help="Only list the most recent exchanges")
+    args = parser.parse_args()
+
+    if args.input:
+        with open(args.input, "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+    trace = find_property(plistlib.loads(data))
+    if trace is None:
+        sys.exit(f"{PROPERTY} not found; is NootedRed loaded?")
+    if trace.get("Version") != VERSION:
+        sys.exit(f"Unsupported trace version {trace.get('Version')}")
+
+    names = load_names(args.sources)
+    raw = trace["Records"]
+    records = [RECORD.unpack_from(raw, off) for off in range(0, len(raw) - len(raw) % RECORD.size, RECORD.size)]
+    # Unused records have no sequence number.
+    records = sorted((record for record in records if record[1]), key=lambda record: record[1])
+    if args.rows:
+        records = records[-args.rows:]
+
+    print(f"{'seq':>6} {'time (s)':>12} {'latency':>10}  {'message':<32} {'param':>10}  {'response':<14} result")
+    for timestamp, seq, msg, param, response, ns, result in records:
+        name = names.get(msg, f"0x{msg:X}")
+        response_name = RESPONSES.get(response, f"0x{response:X}")
+        result_name = RESULTS[result] if result < len(RESULTS) else str(result)
+        print(f"{seq:6} {timestamp / 1e9:12.6f} {format_ns(ns):>10}  {name:<32.32} 0x{param:08X}  {response_name:<14} "
+              f"{result_name}")
+
+    buckets = trace["HistogramBuckets"]
+    raw = trace["Histograms"]
+    counts = struct.unpack(f"<{len(raw) // 4}I", raw[: len(raw) - len(raw) % 4])
+    print()
+    print(f"{'message':<32} {'count':>7}  latency distribution (bucket: count)")
+    for msg in range(len(counts) // buckets):
+        row = counts[msg * buckets:(msg + 1) * buckets]
+        if not any(row):
+            continue
+        spread = "  ".join(f"<{format_ns(1 << (i + 1))}: {n}" for i, n in enumerate(row) if n)
+        print(f"{names.get(msg, f'0x{msg:X}'):<32.32} {sum(row):7}  {spread}")
+
+
+if __name__ == "__main__":
+    main()
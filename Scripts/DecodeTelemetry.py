@@ -0,0 +1,119 @@
+#!/usr/bin/python3
+
+# Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+# See LICENSE for details.
+
+# Turns the `NRed,PatchTelemetry` property of the IGPU into a cost report, most expensive requests first.
+#
+# The record keys are hashes; they are named by hashing the symbol names and pattern arrays found in the sources.
+#
+# Usage: ioreg -a -r -n IGPU | DecodeTelemetry.py [-s <source root>] [-n <rows>]
+#        DecodeTelemetry.py <saved ioreg plist>
+
+import argparse
+import os
+import plistlib
+import re
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from ValidatePatches import Constants, strip_comments  # noqa: E402
+
+PROPERTY = "NRed,PatchTelemetry"
+VERSION = 1
+RECORD = struct.Struct("<IIIIHBB")
+KINDS = ["solve", "route", "lookup"]
+METHODS = ["symbol", "index", "pattern", "cache", "batch", "FAILED"]
+BATCH = METHODS.index("batch")
+
+
+def fnv1a(data):
+    value = 0x811C9DC5
+    for b in data:
+        value = ((value ^ b) * 0x01000193) & 0xFFFFFFFF
+    return value
+
+
+def load_names(root):
+    names = {}
+    constants = Constants()
+    for base, _, files in os.walk(root):
+        for file in sorted(files):
+            if not file.endswith((".cpp", ".hpp")):
+                continue
+            with open(os.path.join(base, file), encoding="utf-8") as f:
+                text = strip_comments(f.read())
+            constants.scan(text)
+            for symbol in re.findall(r'"(_[A-Za-z0-9_]+)"', text):
+                names.setdefault(fnv1a(symbol.encode()), symbol)
+    for name, data in constants.arrays.items():
+        names.setdefault(fnv1a(data), name)
+    return names
+
+
+def find_property(obj):
+    if isinstance(obj, dict):
+        if PROPERTY in obj:
+            return obj[PROPERTY]
+        children = obj.values()
+    elif isinstance(obj, list):
+        children = obj
+    else:
+        return None
+    for child in children:
+        found = find_property(child)
+        if found is not None:
+            return found
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode the patch telemetry published by NootedRed.")
+    parser.add_argument("input", nargs="?", help="ioreg -a output; read from stdin if omitted")
+    parser.add_argument("-s", "--sources", default=os.path.join(os.path.dirname(__file__), "..", "NootedRed"))
+    parser.add_argument("-n", "--rows", type=int, default=0, help="Only list the most expensive rows")
+    args = parser.parse_args()
+
+    if args.input:
+        with open(args.input, "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+    telemetry = find_property(plistlib.loads(data))
+    if telemetry is None:
+        sys.exit(f"{PROPERTY} not found; is NootedRed loaded with telemetry enabled?")
+    if telemetry.get("Version") != VERSION:
+        sys.exit(f"Unsupported telemetry version {telemetry.get('Version')}")
+
+    names = load_names(args.sources)
+    kext_names = {kext["LoadIndex"]: kext.get("Name", f"#{kext['LoadIndex']}") for kext in telemetry["Kexts"]}
+    raw = telemetry["Records"]
+    records = [RECORD.unpack_from(raw, off) for off in range(0, len(raw) - len(raw) % RECORD.size, RECORD.size)]
+
+    rows = []
+    for key, matches, scanned, ns, kext, kind, method in records:
+        if method == BATCH:
+            name = f"<batch of {matches}>"
+        else:
+            name = names.get(key, f"0x{key:08X}")
+        rows.append((ns, scanned, kext_names.get(kext, f"#{kext}"), KINDS[kind], METHODS[method], name, matches))
+    rows.sort(key=lambda row: (-row[0], -row[1]))
+    if args.rows:
+        rows = rows[: args.rows]
+
+    print(f"{'us':>9} {'scanned':>10} {'kext':<40} {'kind':<6} {'method':<7} {'matches':>7}  name")
+    for ns, scanned, kext, kind, method, name, matches in rows:
+        print(f"{ns / 1000:9.1f} {scanned:10} {kext:<40.40} {kind:<6} {method:<7} {matches:7}  {name}")
+
+    print()
+    print(f"{'us':>9} {'scanned':>10}  {'kext':<40} {'requests':>8} {'failures':>8}")
+    for kext in sorted(telemetry["Kexts"], key=lambda kext: -kext["Nanoseconds"]):
+        print(
+            f"{kext['Nanoseconds'] / 1000:9.1f} {kext['BytesScanned']:10}  {kext_names[kext['LoadIndex']]:<40.40} "
+            f"{kext['Requests']:8} {kext['Failures']:8}"
+        )
+
+
+if __name__ == "__main__":
+    main()
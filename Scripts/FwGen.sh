@@ -1,9 +1,8 @@
 #!/bin/sh
 
 target_file="${PROJECT_DIR}/NootedRed/Firmware.cpp"
-if [ -f "$target_file" ]; then
-    rm -f "$target_file"
-fi
+# Under the source root, as the generated source refers to them relative to it.
+blob_dir="${PROJECT_DIR}/build/Firmware"
 while [ $# -gt 0 ];
 do
     case $1 in
@@ -15,5 +14,6 @@ do
     shift
 done
 
+# The generator only rewrites outputs whose contents changed, so unchanged firmware is not recompiled.
 script_file="${PROJECT_DIR}/Scripts/GenerateFirmware.py"
-python3 "${script_file}" "${target_file}" "${fw_files}"
+python3 "${script_file}" -r "${PROJECT_DIR}" -o "${blob_dir}" "${target_file}" "${fw_files}"
@@ -3,16 +3,95 @@
 # Copyright © 2022-2024 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
 # See LICENSE for details.
 
+import argparse
+import hashlib
+import json
 import os
-import sys
+import plistlib
+import re
+import struct
+
+index_header = """// Generated by Scripts/GenerateFirmware.py along with Firmware.cpp.
+
+#pragma once
+
+// Names of the entries of `firmware`, in the same order, for `fwIndex` to resolve literal names at compile time.
+inline constexpr const char *firmwareNames[] = {
+"""
 
 header = """#include <Headers/kern_util.hpp>
 #include <PrivateHeaders/Firmware.hpp>
 
-#define A(N, D) static const UInt8 N[] = D 
-#define F(N, D, L) {.name = N, .metadata = {.data = D, .length = L}}
+#define F(N, D, L, C, G) {.name = N, .metadata = {.data = D, .length = L, .compressedLength = C}, .group = G}
 """
 
+# Every group is a string literal. Hosts other than Darwin, like the host tests, get an ELF section.
+cstring_header = """#ifdef __APPLE__
+#define FW_SECTION "__DATA_CONST,__nred_fw"
+#else
+#define FW_SECTION ".nred_fw"
+#endif
+#define G(N, D) static const UInt8 N[] __attribute__((section(FW_SECTION), aligned(0x1000))) = D
+"""
+
+# Every group is a file pulled in by the assembler; the C string backend is kept for toolchains without `.incbin`.
+incbin_header = """#define FW_STR_(X) #X
+#define FW_STR(X) FW_STR_(X)
+#define FW_SYMBOL(N) FW_STR(__USER_LABEL_PREFIX__) #N
+#ifdef __APPLE__
+#define FW_SECTION "__DATA_CONST,__nred_fw"
+#else
+#define FW_SECTION ".nred_fw,\\"a\\""
+#endif
+#define G(N, P)                                                                                  \\
+    extern "C" const UInt8 N[];                                                                  \\
+    asm(".pushsection " FW_SECTION "\\n.p2align 12\\n.globl " FW_SYMBOL(N) "\\n" FW_SYMBOL(N) ":\\n" \\
+        ".incbin \\"" P "\\"\\n.popsection\\n")
+"""
+
+# Must match `FWASIC` in PrivateHeaders/Firmware.hpp.
+ASIC_RAVEN = 1 << 0
+ASIC_PICASSO = 1 << 1
+ASIC_RAVEN2 = 1 << 2
+ASIC_RENOIR = 1 << 3
+ASIC_RAVEN_FAMILY = ASIC_RAVEN | ASIC_PICASSO | ASIC_RAVEN2
+ASIC_ALL = ASIC_RAVEN_FAMILY | ASIC_RENOIR
+
+# ASICs each file is loaded on, see `wrapPspCmdKmSubmit` and friends. Files not listed are used by all of them.
+ASIC_TAGS = [
+    (r"^gc_9_1_", ASIC_RAVEN | ASIC_PICASSO),
+    (r"^gc_9_2_", ASIC_RAVEN2),
+    (r"^gc_9_3_", ASIC_RENOIR),
+    (r"^raven_gpu_info\.bin$", ASIC_RAVEN),
+    (r"^picasso_gpu_info\.bin$", ASIC_PICASSO),
+    (r"^raven2_gpu_info\.bin$", ASIC_RAVEN2),
+    (r"^renoir_gpu_info\.bin$", ASIC_RENOIR),
+    (r"_dcn10\.bin$|^ativvaxy_rv\.dat$", ASIC_RAVEN_FAMILY),
+    (r"_dcn21\.bin$|^ativvaxy_nv\.dat$|^atidmcub_rn\.dat$", ASIC_RENOIR),
+]
+ASIC_NAMES = {
+    ASIC_ALL: "all",
+    ASIC_RAVEN_FAMILY: "raven_family",
+    ASIC_RAVEN | ASIC_PICASSO: "raven_picasso",
+    ASIC_RAVEN: "raven",
+    ASIC_PICASSO: "picasso",
+    ASIC_RAVEN2: "raven2",
+    ASIC_RENOIR: "renoir",
+}
+PAGE_SIZE = 0x1000
+
+# LZ4 block format limits: the last match must start 12 bytes before the end and the last 5 bytes are literals.
+LZ4_MIN_MATCH = 4
+LZ4_MF_LIMIT = 12
+LZ4_LAST_LITERALS = 5
+LZ4_MAX_OFFSET = 0xFFFF
+
+# Must match `fnv1a` in PrivateHeaders/Hash.hpp and `fwNameSlot` in PrivateHeaders/Firmware.hpp.
+FNV_BASIS = 0x811C9DC5
+FNV_PRIME = 0x01000193
+SLOT_MULTIPLIER = 0x9E3779B1
+EMPTY_SLOT = 0xFF
+
 special_chars = {
     0x0: "\\0",
     0x7: "\\a",
@@ -49,40 +128,425 @@ def bytes_to_cstr(data, is_text=False):
     return '"' + "".join(byte_to_char(b, is_text) for b in data) + '"'
 
 
+def lz4_length(out, length):
+    while length >= 255:
+        out.append(255)
+        length -= 255
+    out.append(length)
+
+
+def lz4_sequence(out, literals, offset=0, match=0):
+    lit_len = len(literals)
+    match_len = match - LZ4_MIN_MATCH if match else 0
+    out.append((min(lit_len, 15) << 4) | min(match_len, 15))
+    if lit_len >= 15:
+        lz4_length(out, lit_len - 15)
+    out += literals
+    if match:
+        out += offset.to_bytes(2, "little")
+        if match_len >= 15:
+            lz4_length(out, match_len - 15)
+
+
+def lz4_compress(data):
+    out = bytearray()
+    table = {}
+    anchor = 0
+    i = 0
+    limit = len(data) - LZ4_MF_LIMIT
+    while i < limit:
+        key = data[i : i + LZ4_MIN_MATCH]
+        ref = table.get(key)
+        table[key] = i
+        if ref is None or i - ref > LZ4_MAX_OFFSET:
+            i += 1
+            continue
+        length = LZ4_MIN_MATCH
+        end = len(data) - LZ4_LAST_LITERALS - i
+        while length < end and data[ref + length] == data[i + length]:
+            length += 1
+        lz4_sequence(out, data[anchor:i], i - ref, length)
+        i += length
+        anchor = i
+    lz4_sequence(out, data[anchor:])
+    return bytes(out)
+
+
+def lz4_decompress(src, length):
+    out = bytearray()
+    i = 0
+    while i < len(src):
+        token = src[i]
+        i += 1
+        lit_len = token >> 4
+        if lit_len == 15:
+            while src[i] == 255:
+                lit_len += 255
+                i += 1
+            lit_len += src[i]
+            i += 1
+        out += src[i : i + lit_len]
+        i += lit_len
+        if i == len(src):
+            break
+        offset = src[i] | (src[i + 1] << 8)
+        i += 2
+        match_len = token & 15
+        if match_len == 15:
+            while src[i] == 255:
+                match_len += 255
+                i += 1
+            match_len += src[i]
+            i += 1
+        for _ in range(match_len + LZ4_MIN_MATCH):
+            out.append(out[-offset])
+    assert len(out) == length
+    return bytes(out)
+
+
+def compress_file(data):
+    """Returns the stored bytes and their compressed length, 0 if the file is stored as is."""
+    compressed = lz4_compress(data)
+    if len(compressed) >= len(data):
+        return data, 0
+    assert lz4_decompress(compressed, len(data)) == data, "LZ4 round trip failed"
+    return compressed, len(compressed)
+
+
+def fnv1a(data, value=FNV_BASIS):
+    for b in data:
+        value = ((value ^ b) * FNV_PRIME) & 0xFFFFFFFF
+    return value
+
+
+def fw_name_hash(name):
+    return fnv1a(name.encode())
+
+
+def fw_name_slot(hash, displacement, shift):
+    return (((hash ^ displacement) * SLOT_MULTIPLIER) & 0xFFFFFFFF) >> shift
+
+
+def build_index(names):
+    """Hash and displace: each bucket of names gets the displacement that moves all of them to free slots."""
+    hashes = [fw_name_hash(name) for name in names]
+    assert len(set(hashes)) == len(hashes), "Firmware name hash collision"
+    assert len(names) < EMPTY_SLOT, "Too many firmware files for the index"
+    slot_bits = max(1, (len(names) - 1).bit_length())
+    while True:
+        bucket_count = 1 << (slot_bits - 1)
+        buckets = [[] for _ in range(bucket_count)]
+        for i, hash in enumerate(hashes):
+            buckets[hash & (bucket_count - 1)].append(i)
+        slots = [EMPTY_SLOT] * (1 << slot_bits)
+        displacements = [0] * bucket_count
+        shift = 32 - slot_bits
+        for bucket in sorted(range(bucket_count), key=lambda b: -len(buckets[b])):
+            for displacement in range(0x10000):
+                targets = {fw_name_slot(hashes[i], displacement, shift) for i in buckets[bucket]}
+                if len(targets) == len(buckets[bucket]) and all(slots[t] == EMPTY_SLOT for t in targets):
+                    break
+            else:
+                break
+            displacements[bucket] = displacement
+            for i in buckets[bucket]:
+                slots[fw_name_slot(hashes[i], displacement, shift)] = i
+        else:
+            for i, hash in enumerate(hashes):
+                assert slots[fw_name_slot(hash, displacements[hash & (bucket_count - 1)], shift)] == i
+            return displacements, slots, shift
+        slot_bits += 1
+
+
+def c_array(values):
+    return "{" + ", ".join(str(v) for v in values) + "}"
+
+
+# libkern/c++/OSSerializeBinary.cpp
+OSB_SIGNATURE = b"\xD3\0\0\0"
+OSB_DICTIONARY = 0x01000000
+OSB_ARRAY = 0x02000000
+OSB_NUMBER = 0x04000000
+OSB_SYMBOL = 0x08000000
+OSB_STRING = 0x09000000
+OSB_DATA = 0x0A000000
+OSB_BOOLEAN = 0x0B000000
+OSB_TYPE_MASK = 0x7F000000
+OSB_DATA_MASK = 0x00FFFFFF
+OSB_END = 0x80000000
+
+
+def osb_serialize(root):
+    """Serialises a plist the way `OSSerialize::binarySerialize` does, for `OSUnserializeBinary`."""
+    out = bytearray(OSB_SIGNATURE)
+
+    def payload(data):
+        out.extend(data)
+        out.extend(b"\0" * (-len(data) % 4))
+
+    def add(obj, end):
+        flag = OSB_END if end else 0
+        if isinstance(obj, dict):
+            out.extend(struct.pack("<I", OSB_DICTIONARY | len(obj) | flag))
+            for i, (key, value) in enumerate(obj.items()):
+                key = key.encode() + b"\0"
+                out.extend(struct.pack("<I", OSB_SYMBOL | len(key)))
+                payload(key)
+                add(value, i == len(obj) - 1)
+        elif isinstance(obj, list):
+            out.extend(struct.pack("<I", OSB_ARRAY | len(obj) | flag))
+            for i, value in enumerate(obj):
+                add(value, i == len(obj) - 1)
+        elif isinstance(obj, bool):
+            out.extend(struct.pack("<I", OSB_BOOLEAN | int(obj) | flag))
+        elif isinstance(obj, int):
+            # `OSUnserializeXML` makes every integer 64 bits wide.
+            out.extend(struct.pack("<IQ", OSB_NUMBER | 64 | flag, obj & 0xFFFFFFFFFFFFFFFF))
+        elif isinstance(obj, str):
+            data = obj.encode()
+            out.extend(struct.pack("<I", OSB_STRING | len(data) | flag))
+            payload(data)
+        elif isinstance(obj, bytes):
+            out.extend(struct.pack("<I", OSB_DATA | len(obj) | flag))
+            payload(obj)
+        else:
+            raise TypeError(f"Cannot serialise {type(obj).__name__}")
+
+    add(root, True)
+    return bytes(out)
+
+
+def osb_unserialize(data):
+    """Follows `OSUnserializeBinary` closely enough to check what `osb_serialize` wrote."""
+    assert data[:4] == OSB_SIGNATURE
+    pos = 4
+    result = None
+    stack = []
+    parent = None
+    key = None
+    while pos < len(data):
+        (header,) = struct.unpack_from("<I", data, pos)
+        pos += 4
+        kind, length, end = header & OSB_TYPE_MASK, header & OSB_DATA_MASK, bool(header & OSB_END)
+        words = (length + 3) // 4 * 4
+        collection = False
+        if kind == OSB_DICTIONARY:
+            obj, collection = {}, length != 0
+        elif kind == OSB_ARRAY:
+            obj, collection = [], length != 0
+        elif kind == OSB_NUMBER:
+            (obj,) = struct.unpack_from("<Q", data, pos)
+            pos += 8
+        elif kind == OSB_SYMBOL:
+            assert data[pos + length - 1] == 0, "Symbol is not terminated"
+            obj = ("symbol", data[pos : pos + length - 1].decode())
+            pos += words
+        elif kind == OSB_STRING:
+            obj = data[pos : pos + length].decode()
+            pos += words
+        elif kind == OSB_DATA:
+            obj = bytes(data[pos : pos + length])
+            pos += words
+        elif kind == OSB_BOOLEAN:
+            obj = bool(length)
+        else:
+            raise ValueError(f"Unexpected object 0x{header:08X}")
+
+        if isinstance(parent, dict):
+            if key is None:
+                assert isinstance(obj, tuple), "Dictionary key is not a symbol"
+                key = obj[1]
+            else:
+                parent[key] = obj
+                key = None
+        elif isinstance(parent, list):
+            parent.append(obj)
+        else:
+            assert result is None, "More than one root object"
+            result = obj
+
+        # A collection ending its parent pushes nothing to return to, so the parent is closed along with it.
+        if end:
+            parent = None
+        if collection:
+            stack.append(parent)
+            parent = obj
+            end = False
+        if end:
+            while stack and parent is None:
+                parent = stack.pop()
+            if parent is None:
+                break
+    assert pos == len(data), "Trailing data"
+    return result
+
+
+def same_plist(a, b):
+    if type(a) is not type(b):
+        return False
+    if isinstance(a, dict):
+        return a.keys() == b.keys() and all(same_plist(a[k], b[k]) for k in a)
+    if isinstance(a, list):
+        return len(a) == len(b) and all(same_plist(x, y) for x, y in zip(a, b))
+    return a == b
+
+
+def personality_to_osb(xml):
+    """Driver personalities are plain plist fragments; returns them in binary form, checked against the XML."""
+    root = plistlib.loads(b'<plist version="1.0">' + xml + b"</plist>", fmt=plistlib.FMT_XML)
+    data = osb_serialize(root)
+    assert same_plist(osb_unserialize(data), root), "Binary personalities do not match the XML"
+    return data
+
+
+def file_asics(name):
+    for pattern, asics in ASIC_TAGS:
+        if re.search(pattern, name):
+            return asics
+    return ASIC_ALL
+
+
 def is_file_excluded(name: str) -> bool:
     return name.startswith(".") or name == "LICENSE"
 
 
 def is_file_text(name: str) -> bool:
-    return not name.endswith(".dat") and not name.endswith(".bin")
+    return not name.endswith((".dat", ".bin", ".osb"))
+
 
+def write_if_changed(path, data):
+    """Leaves the file and its timestamp alone if it already has the contents, so unchanged firmware is not rebuilt."""
+    if os.path.exists(path):
+        with open(path, "rb") as file:
+            if file.read() == data:
+                return
+    with open(path, "wb") as file:
+        file.write(data)
 
-def process_files(target_file, dir):
+
+def process_files(target_file, dir, backend="incbin", blob_dir=None, index_file=None, source_root=None):
     os.makedirs(os.path.dirname(target_file), exist_ok=True)
-    lines = header.splitlines(keepends=True) + ["\n"]
-    file_list_content = []
-    files = filter(
-        lambda v: not is_file_excluded(os.path.basename(v[1])),
-        [(root, file) for root, _, files in os.walk(dir) for file in files],
-    )
-    for root, file in files:
-        with open(os.path.join(root, file), "rb") as src_file:
-            src_data = src_file.read()
-        is_text = is_file_text(os.path.basename(file))
-        var_ident = file.replace(".", "_").replace("-", "_")
-        var_contents = bytes_to_cstr(src_data, is_text)
-        lines += [f"A({var_ident}, {var_contents});\n"]
-        file_list_content += [
-            f'    F("{file}", {var_ident}, sizeof({var_ident}){"" if is_text else " - 1"}),\n'
-        ]
+    index_file = index_file or os.path.join(os.path.dirname(target_file), "PrivateHeaders", "FirmwareIndex.hpp")
+    os.makedirs(os.path.dirname(index_file), exist_ok=True)
+    lines = header.splitlines(keepends=True)
+    if backend == "incbin":
+        # `.incbin` paths are relative to the source root, the directory the compiler runs in, so the generated source
+        # holds no host paths.
+        source_root = os.path.abspath(source_root or os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+        blob_dir = os.path.abspath(blob_dir or os.path.splitext(target_file)[0] + "Blobs")
+        assert os.path.commonpath([source_root, blob_dir]) == source_root, "The blobs must be under the source root"
+        os.makedirs(blob_dir, exist_ok=True)
+        lines += incbin_header.splitlines(keepends=True)
+    else:
+        lines += cstring_header.splitlines(keepends=True)
+    lines += ["\n"]
+    blob_digest = hashlib.sha256()
+
+    # Identical files are stored once, serving the ASICs of all of them.
+    names = []
+    blobs = {}
+    for root, _, files in os.walk(dir):
+        for file in sorted(files):
+            if is_file_excluded(file):
+                continue
+            with open(os.path.join(root, file), "rb") as src_file:
+                src_data = src_file.read()
+            entries = [(file, src_data)]
+            # Driver personalities are injected from their binary form, the XML is the fallback of DEBUG builds.
+            if file.endswith(".xml"):
+                entries.append((file[: -len(".xml")] + ".osb", personality_to_osb(src_data)))
+            for name, data in entries:
+                # Text files are handed out with their terminator, as they used to be when stored as string literals.
+                if is_file_text(name):
+                    data += b"\0"
+                digest = hashlib.sha256(data).digest()
+                if digest not in blobs:
+                    blobs[digest] = {"data": data, "asics": 0, "names": []}
+                blobs[digest]["asics"] |= file_asics(name)
+                blobs[digest]["names"].append(name)
+                names.append((name, digest))
+    names.sort()
+
+    # Blobs serving the same ASICs share a page-aligned group, so the groups an ASIC never uses are disabled whole.
+    groups = {}
+    for digest, blob in blobs.items():
+        groups.setdefault(blob["asics"], []).append(digest)
+    group_list = sorted(groups, reverse=True)
+    assert len(group_list) <= 32, "Too many firmware groups"
+
+    total_size = sum(len(blob["data"]) for blob in blobs.values())
+    total_stored = 0
+    groups_hash = FNV_BASIS
+    group_content = []
+    group_sizes = []
+    for index, asics in enumerate(group_list):
+        group_ident = f"fw_group_{ASIC_NAMES.get(asics, asics)}"
+        group_data = b""
+        for digest in sorted(groups[asics], key=lambda d: blobs[d]["names"][0]):
+            blob = blobs[digest]
+            stored, compressed_len = compress_file(blob["data"])
+            blob.update(ident=group_ident, offset=len(group_data), compressed_len=compressed_len, group=index)
+            # Kept 4-byte aligned for the consumers that need it, like `OSUnserializeBinary`.
+            group_data += stored + b"\0" * (-len(stored) % 4)
+        total_stored += len(group_data)
+        groups_hash = fnv1a(group_data, groups_hash)
+        group_sizes.append(len(group_data))
+        if backend == "incbin":
+            blob_path = os.path.join(blob_dir, f"{group_ident}.bin")
+            write_if_changed(blob_path, group_data)
+            blob_digest.update(group_data)
+            lines += [f"G({group_ident}, {json.dumps(os.path.relpath(blob_path, source_root))});\n"]
+        else:
+            lines += [f"G({group_ident}, {bytes_to_cstr(group_data)});\n"]
+        group_content += [f"    {{.data = {group_ident}, .size = {len(group_data)}, .asics = {asics}}},\n"]
 
     lines += ["\n", "const struct FWDescriptor firmware[] = {\n"]
-    lines += file_list_content
+    for file, digest in names:
+        blob = blobs[digest]
+        lines += [
+            f'    F("{file}", {blob["ident"]} + {blob["offset"]}, {len(blob["data"])}, {blob["compressed_len"]}, '
+            f'{blob["group"]}),\n'
+        ]
     lines += ["};\n", "const size_t firmwareCount = arrsize(firmware);\n"]
+    index_lines = index_header.splitlines(keepends=True)
+    index_lines += [f'    "{file}",\n' for file, _ in names]
+    index_lines += ["};\n"]
+    # Both backends must embed exactly these bytes, see Scripts/HostTests/FirmwareStore.cpp.
+    index_lines += ["\n", "// `fnv1a` of the contents of `firmwareGroups`, one after the other.\n"]
+    index_lines += [f"inline constexpr UInt32 firmwareGroupsHash = 0x{groups_hash:08X};\n"]
+
+    lines += ["\n", "const struct FWGroup firmwareGroups[] = {\n"]
+    lines += group_content
+    lines += ["};\n", "const size_t firmwareGroupCount = arrsize(firmwareGroups);\n"]
+    lines += ["UInt32 firmwareDisabledGroups = 0;\n"]
+
+    displacements, slots, shift = build_index([file for file, _ in names])
+    lines += [
+        "\n",
+        f"const UInt16 firmwareDisplacements[] = {c_array(displacements)};\n",
+        f"const UInt8 firmwareSlots[] = {c_array(slots)};\n",
+        f"const UInt32 firmwareBucketMask = {len(displacements) - 1};\n",
+        f"const UInt32 firmwareSlotShift = {shift};\n",
+    ]
 
-    with open(target_file, "w") as file:
-        file.writelines(lines)
+    # The compiler does not track `.incbin` inputs, so any change to them has to change this file too.
+    if backend == "incbin":
+        lines += ["\n", f"// Blobs: {blob_digest.hexdigest()}\n"]
+    write_if_changed(index_file, "".join(index_lines).encode())
+    write_if_changed(target_file, "".join(lines).encode())
+    print(f"Firmware: {total_size} bytes stored in {total_stored} ({100 * total_stored // max(total_size, 1)}%)")
+    for index, asics in enumerate(group_list):
+        name = ASIC_NAMES.get(asics, asics)
+        print(f"  group {index} ({name}): {len(groups[asics])} files, {group_sizes[index]} bytes")
 
 
 if __name__ == "__main__":
-    process_files(sys.argv[1], sys.argv[2])
+    parser = argparse.ArgumentParser(description="Generate the firmware store embedded in NootedRed.")
+    parser.add_argument("target", help="Generated C++ source")
+    parser.add_argument("dir", help="Firmware directory")
+    parser.add_argument("-b", "--backend", choices=["incbin", "cstring"], default="incbin")
+    parser.add_argument("-o", "--blobs", help="Where the incbin backend puts the group files")
+    parser.add_argument("-i", "--index", help="Name index header, PrivateHeaders/FirmwareIndex.hpp by default")
+    parser.add_argument("-r", "--root", help="Source root the compiler runs in, the repository by default")
+    args = parser.parse_args()
+    process_files(args.target, args.dir, args.backend, args.blobs, args.index, args.root)
@@ -0,0 +1,73 @@
+// Sources: NootedRed/PatcherPlus.cpp NootedRed/OffsetCache.cpp Scripts/HostTests/Stubs/PatchTelemetry.cpp
+//
+// `PatcherPlus::findPattern` must return the offsets `KernelPatcher::findPattern` does, for any pattern, mask, start
+// offset and data. Also times both on a stripped kext sized buffer, as the symbol fallbacks scan whole kexts.
+
+#include <PrivateHeaders/PatcherPlus.hpp>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using Bytes = std::vector<UInt8>;
+
+static int differential() {
+    std::mt19937 rng(2);
+    for (int iter = 0; iter < 300000; iter++) {
+        size_t size = rng() % 300;
+        size_t alphabet = 1 + rng() % 6;
+        // Mostly a few values, so matches and near misses are common, with some noise.
+        auto byte = [&] { return rng() % 5 ? static_cast<UInt8>(rng() % alphabet * 0x47) : static_cast<UInt8>(rng()); };
+        Bytes data(size);
+        for (auto &b : data) { b = byte(); }
+        size_t patternSize = rng() % 8;
+        Bytes pattern(patternSize), mask(patternSize);
+        for (auto &b : pattern) { b = byte(); }
+        for (auto &b : mask) { b = rng() % 3 ? 0xFF : static_cast<UInt8>(rng()); }
+        auto *maskPtr = rng() % 2 ? mask.data() : nullptr;
+
+        size_t start = rng() % (size + 2);
+        size_t lilu = start, ours = start;
+        bool liluFound = KernelPatcher::findPattern(pattern.data(), maskPtr, patternSize, data.data(), size, &lilu);
+        bool found = PatcherPlus::findPattern(pattern.data(), maskPtr, patternSize, data.data(), size, &ours);
+        if (found != liluFound || (found && ours != lilu)) {
+            printf("Differential: iteration %d: Lilu %d at %zu, PatcherPlus %d at %zu\n", iter, liluFound, lilu,
+                found, ours);
+            return 1;
+        }
+    }
+    printf("Differential: 300000 random searches match Lilu\n");
+    return 0;
+}
+
+static int benchmark() {
+    static constexpr size_t Size = 16 * 1024 * 1024;
+    std::mt19937 rng(3);
+    Bytes data(Size);
+    static const UInt8 common[] = {0x00, 0x48, 0x89, 0x8B, 0xFF, 0x0F, 0xE8, 0x24, 0x45, 0x4C, 0xC3, 0x85, 0x74};
+    for (auto &b : data) { b = rng() % 4 ? common[rng() % arrsize(common)] : rng() % 256; }
+
+    // Shaped like `kPspCmdKmSubmitPattern1404`: common opcodes, masked displacements, near the end of the kext.
+    static const UInt8 pattern[] = {0x55, 0x48, 0x89, 0xE5, 0x41, 0x57, 0x41, 0x56, 0x53, 0x50, 0x49, 0x89, 0xD6, 0x48,
+        0x8B, 0x87, 0x00, 0x00, 0x00, 0x00, 0x8B, 0x40, 0x00};
+    static const UInt8 mask[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0x00};
+    memcpy(data.data() + Size - Size / 16, pattern, sizeof(pattern));
+
+    size_t lilu = 0, ours = 0;
+    auto start = std::chrono::steady_clock::now();
+    bool liluFound = KernelPatcher::findPattern(pattern, mask, sizeof(pattern), data.data(), Size, &lilu);
+    auto middle = std::chrono::steady_clock::now();
+    bool found = PatcherPlus::findPattern(pattern, mask, sizeof(pattern), data.data(), Size, &ours);
+    auto end = std::chrono::steady_clock::now();
+    if (!found || !liluFound || ours != lilu) {
+        printf("Benchmark: results differ\n");
+        return 1;
+    }
+    auto liluMs = std::chrono::duration<double, std::milli>(middle - start).count();
+    auto oursMs = std::chrono::duration<double, std::milli>(end - middle).count();
+    printf("Benchmark: %zu MiB: Lilu %.1f ms, PatcherPlus %.1f ms (%.1fx)\n", Size >> 20, liluMs, oursMs,
+        liluMs / oursMs);
+    return 0;
+}
+
+int main() { return differential() | benchmark(); }
@@ -0,0 +1,81 @@
+// Firmware: incbin cstring
+//
+// Every file in NootedRed/Firmware must come back out of the generated store as it went in, found both by its name at
+// run time and through `fwLiteral`, while unknown and disabled names panic. Built once per backend, each of which must
+// embed the page-aligned groups byte for byte as the generator packed them.
+
+#include <PrivateHeaders/Firmware.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#define CHECK(cond)                                        \
+    do {                                                   \
+        if (!(cond)) {                                     \
+            printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            return 1;                                      \
+        }                                                  \
+    } while (0)
+
+static std::vector<UInt8> contents(const FWDescriptor &fw) {
+    std::vector<UInt8> data(fw.metadata.length);
+    fw.metadata.copyTo(data.data());
+    return data;
+}
+
+static bool panics(const char *name) {
+    try {
+        getFWDescriptorByName(name);
+    } catch (const HostPanic &) { return true; }
+    return false;
+}
+
+int main() {
+    UInt32 groupsHash = FNV1aBasis;
+    for (size_t i = 0; i < firmwareGroupCount; i++) {
+        CHECK((reinterpret_cast<uintptr_t>(firmwareGroups[i].data) & (PAGE_SIZE - 1)) == 0);
+        groupsHash = fnv1a(firmwareGroups[i].data, firmwareGroups[i].size, groupsHash);
+    }
+    CHECK(groupsHash == firmwareGroupsHash);
+
+    static constexpr FWName vcnRaven = fwLiteral("ativvaxy_rv.dat");
+    CHECK(!strcmp(firmware[vcnRaven.index].name, "ativvaxy_rv.dat"));
+    CHECK(&getFWDescriptorByName(vcnRaven) == &firmware[vcnRaven.index]);
+    CHECK(arrsize(firmwareNames) == firmwareCount);
+
+    std::string source = __FILE__;
+    auto dir = std::filesystem::path(source.substr(0, source.rfind("Scripts/"))) / "NootedRed" / "Firmware";
+    size_t files = 0;
+    for (auto &entry : std::filesystem::directory_iterator(dir)) {
+        auto name = entry.path().filename().string();
+        if (name[0] == '.' || name == "LICENSE") { continue; }
+        std::ifstream file(entry.path(), std::ios::binary);
+        std::vector<UInt8> expected {std::istreambuf_iterator<char>(file), {}};
+        if (!name.ends_with(".dat") && !name.ends_with(".bin")) { expected.push_back(0); }
+
+        auto &fw = getFWDescriptorByName(name.c_str());
+        CHECK(name == fw.name && !strcmp(firmwareNames[&fw - firmware], fw.name));
+        CHECK(contents(fw) == expected);
+        files += 1;
+
+        // Driver personalities are also stored in binary form.
+        if (name.ends_with(".xml")) {
+            auto osb = name.substr(0, name.size() - 4) + ".osb";
+            auto binary = contents(getFWDescriptorByName(osb.c_str()));
+            CHECK(binary.size() > 4 && binary[0] == 0xD3 && !binary[1] && !binary[2] && !binary[3]);
+            files += 1;
+        }
+    }
+    CHECK(files == firmwareCount);
+
+    CHECK(panics("missing.bin"));
+    CHECK(panics("ativvaxy_rv.da"));
+    firmwareDisabledGroups = 1U << firmware[vcnRaven.index].group;
+    CHECK(panics("ativvaxy_rv.dat"));
+    firmwareDisabledGroups = 0;
+
+    printf("%zu firmware files in %zu groups round-trip through the store\n", files, firmwareGroupCount);
+    return 0;
+}
@@ -0,0 +1,146 @@
+// Sources: NootedRed/MMIO.cpp
+// Includes: Stubs/MMIO
+//
+// Threads reading, writing and modifying registers through `MMIO` at once, in the BAR and behind the
+// `mmPCIE_INDEX2/DATA2` pair, must never follow one's index with another's data, and each must read back what it
+// wrote. The same accesses made without the lock do tear, which shows the simulated pair notices. `modifyRegs32` must
+// write the index once per run of indirect registers that share it, and read only what a partial mask keeps.
+// Also counts the BAR accesses of a batch against the same changes made one by one.
+
+#include <PrivateHeaders/MMIO.hpp>
+#include <PrivateHeaders/MMIOAccess.hpp>
+#include <vector>
+
+#define CHECK(cond)                                        \
+    do {                                                   \
+        if (!(cond)) {                                     \
+            printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            return 1;                                      \
+        }                                                  \
+    } while (0)
+
+static constexpr UInt32 Threads = 8;
+static constexpr UInt32 DirectBase = 0x100;      // Two registers per thread.
+static constexpr UInt32 IndirectBase = 0x1A000;    // Two registers per thread.
+
+static MMIO mmio {};
+
+struct Counts {
+    size_t reads, writes, indexWrites;
+
+    static Counts now() { return {hostBAR.reads, hostBAR.writes, hostBAR.indexWrites}; }
+    Counts operator-(const Counts &other) const {
+        return {this->reads - other.reads, this->writes - other.writes, this->indexWrites - other.indexWrites};
+    }
+    size_t total() const { return this->reads + this->writes; }
+};
+
+static int batches() {
+    const UInt32 a = IndirectBase + 0x100, b = IndirectBase + 0x101, c = DirectBase + 0x80, d = DirectBase + 0x81;
+    for (auto reg : {a, b, c, d}) { hostBAR.set(reg, 0xFFFF0000); }
+
+    // Two runs of indirect registers around the direct ones: the index is written again after the pair was let go.
+    const RegRMW ops[] = {
+        {a, 0xFFFFFFFF, 0x11},
+        {a, 0x0000FF00, 0x2200},
+        {b, 0xFFFFFFFF, 0x33},
+        {c, 0xFFFFFFFF, 0x44},
+        {d, 0x000000FF, 0x55},
+        {b, 0x0000FF00, 0x6600},
+        {b, 0x000000FF, 0x77},
+    };
+    const auto before = Counts::now();
+    mmio.modifyRegs32(ops, arrsize(ops));
+    const auto used = Counts::now() - before;
+    CHECK(hostBAR.get(a) == 0x2211 && hostBAR.get(b) == 0x6677 && hostBAR.get(c) == 0x44);
+    CHECK(hostBAR.get(d) == 0xFFFF0055);
+    CHECK(used.indexWrites == 3);
+    CHECK(used.reads == 4 && used.writes == 3 + arrsize(ops));
+    CHECK(hostBAR.torn == 0);
+
+    // Eight fields of one indirect register, as a batch and one by one.
+    RegRMW fields[8];
+    for (UInt32 i = 0; i < arrsize(fields); i++) { fields[i] = {a, 0xFU << (i * 4), i << (i * 4)}; }
+    auto start = Counts::now();
+    mmio.modifyRegs32(fields, arrsize(fields));
+    const auto batched = Counts::now() - start;
+    CHECK(hostBAR.get(a) == 0x76543210);
+    start = Counts::now();
+    for (auto &field : fields) { mmio.writeReg32(a, (mmio.readReg32(a) & ~field.mask) | field.value); }
+    const auto single = Counts::now() - start;
+    CHECK(batched.total() == 1 + 2 * arrsize(fields) && single.total() == 4 * arrsize(fields));
+    printf("Benchmark: a mixed batch of %zu ops took %zu BAR accesses with %zu index writes; 8 fields of an indirect "
+           "register took %zu as a batch, %zu one by one\n",
+        arrsize(ops), used.total(), used.indexWrites, batched.total(), single.total());
+    return 0;
+}
+
+// Each thread owns its registers, so a value read back that it did not write came through another thread's index.
+static int concurrency() {
+    static constexpr UInt32 Rounds = 20000;
+    std::atomic<int> mismatches {0};
+    std::atomic<UInt32> started {0};
+    std::vector<std::thread> threads;
+    const size_t accesses = hostBAR.reads + hostBAR.writes;
+    for (UInt32 thread = 0; thread < Threads; thread++) {
+        threads.emplace_back([&, thread] {
+            const UInt32 direct = DirectBase + thread * 2, indirect = IndirectBase + thread * 2;
+            started += 1;
+            while (started != Threads) {}
+            for (UInt32 i = 0; i < Rounds; i++) {
+                const UInt32 value = (thread << 24) | i;
+                mmio.writeReg32(indirect, value);
+                mmio.writeReg32(direct, ~value);
+                if (mmio.readReg32(indirect) != value || mmio.readReg32(direct) != ~value) { mismatches += 1; }
+
+                const RegRMW ops[] = {
+                    {indirect, 0x00FF0000, i << 16},
+                    {direct, 0xFFFFFFFF, value},
+                    {indirect + 1, 0xFFFFFFFF, ~value},
+                    {indirect, 0x000000FF, i},
+                };
+                mmio.modifyRegs32(ops, arrsize(ops));
+                const UInt32 expected = (value & 0xFF00FF00) | ((i << 16) & 0x00FF0000) | (i & 0xFF);
+                if (mmio.readReg32(indirect) != expected || mmio.readReg32(indirect + 1) != ~value ||
+                    mmio.readReg32(direct) != value) {
+                    mismatches += 1;
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) { thread.join(); }
+    CHECK(hostBAR.torn == 0 && mismatches == 0);
+    printf("Concurrency: %u threads made %zu BAR accesses, no torn index/data pair\n", Threads,
+        hostBAR.reads + hostBAR.writes - accesses);
+    return 0;
+}
+
+// The pair used without the lock, as two drivers sharing it without agreeing on one would. Each yields between the
+// index and the data, as if preempted there.
+static int unlocked() {
+    static constexpr UInt32 Rounds = 2000;
+    std::atomic<UInt32> started {0};
+    std::vector<std::thread> threads;
+    for (UInt32 thread = 0; thread < Threads; thread++) {
+        threads.emplace_back([&, thread] {
+            started += 1;
+            while (started != Threads) {}
+            for (UInt32 i = 0; i < Rounds; i++) {
+                mmioWrite32(hostBAR.slots, mmPCIE_INDEX2, IndirectBase + thread * 2);
+                std::this_thread::yield();
+                mmioRead32(hostBAR.slots, mmPCIE_DATA2);
+            }
+        });
+    }
+    for (auto &thread : threads) { thread.join(); }
+    CHECK(hostBAR.torn > 0);
+    printf("Unlocked: %zu torn pairs without the lock\n", hostBAR.torn.load());
+    return 0;
+}
+
+int main() {
+    hostQuiet = true;
+    mmio.init();
+    mmio.map(hostBAR.slots, HostBAR::DirectRegs);
+    return batches() | concurrency() | unlocked();
+}
@@ -0,0 +1,201 @@
+// Sources: NootedRed/PatcherPlus.cpp NootedRed/OffsetCache.cpp Scripts/HostTests/Stubs/PatchTelemetry.cpp
+//
+// `LookupPatchPlus::applyAll` must leave an image exactly as applying the patches one by one with Lilu does, and
+// report the same result, writing the image in a single window. A batch that fails leaves the image untouched, where
+// Lilu kept the patches before the failing one. Also checks that overlapping code and data ranges are
+// scanned once, and times a batch of patches against the one-by-one loop it replaced.
+
+#include "Stubs/HostTelemetry.hpp"
+#include <PrivateHeaders/PatcherPlus.hpp>
+#include <chrono>
+#include <mach-o/loader.h>
+#include <random>
+#include <vector>
+
+using Bytes = std::vector<UInt8>;
+
+// What the modules did before batching: one Lilu call, and so one full scan, per patch.
+static bool applySequential(KernelPatcher &patcher, const LookupPatchPlus *patches, size_t count, UInt8 *data,
+    size_t size, bool force) {
+    for (size_t i = 0; i < count; i++) {
+        auto &patch = patches[i];
+        bool applied;
+        if (!patch.findMask && !patch.replaceMask && !patch.skip) {
+            patcher.clearError();
+            patcher.applyLookupPatch(&patch, data, size);
+            applied = patcher.getError() == KernelPatcher::Error::NoError;
+        } else {
+            applied = KernelPatcher::findAndReplaceWithMask(data, size, patch.find, patch.size, patch.findMask,
+                patch.findMask ? patch.size : 0, patch.replace, patch.size, patch.replaceMask,
+                patch.replaceMask ? patch.size : 0, patch.count, patch.skip);
+        }
+        if (!applied && !force) { return false; }
+    }
+    return true;
+}
+
+static int differential() {
+    std::mt19937 rng(1);
+    KernelPatcher patcher;
+    hostQuiet = true;
+    for (int iter = 0; iter < 20000; iter++) {
+        size_t size = 50 + rng() % 400;
+        size_t alphabet = 2 + rng() % 4;
+        Bytes data(size);
+        for (auto &b : data) { b = rng() % alphabet; }
+
+        size_t count = 2 + rng() % 6;
+        std::vector<Bytes> store;
+        std::vector<LookupPatchPlus> patches;
+        for (size_t k = 0; k < count; k++) {
+            size_t len = 1 + rng() % 4;
+            Bytes find(len), findMask(len), replace(len), replaceMask(len);
+            for (auto &b : find) { b = rng() % alphabet; }
+            for (auto &b : findMask) { b = (rng() % 3) ? 0xFF : (rng() % 2 ? 0 : 0x1); }
+            for (auto &b : replace) { b = rng() % alphabet; }
+            for (auto &b : replaceMask) { b = rng() % 2 ? 0xFF : 0x02; }
+            store.push_back(find);
+            store.push_back(findMask);
+            store.push_back(replace);
+            store.push_back(replaceMask);
+            auto *f = store[store.size() - 4].data(), *fm = store[store.size() - 3].data();
+            auto *r = store[store.size() - 2].data(), *rm = store[store.size() - 1].data();
+            size_t n = rng() % 4, skip = rng() % 2;
+            switch (rng() % 3) {
+                case 0:
+                    patches.emplace_back(nullptr, f, r, len, n ? n : 1);
+                    break;
+                case 1:
+                    patches.emplace_back(nullptr, f, fm, r, len, n, skip);
+                    break;
+                default:
+                    patches.emplace_back(nullptr, f, fm, r, rm, len, n, skip);
+                    break;
+            }
+        }
+
+        bool force = rng() % 2;
+        auto batched = data, sequential = data;
+        auto windows = MachInfo::writeWindows;
+        bool batchedRet = LookupPatchPlus::applyAll(patcher, patches.data(), patches.size(),
+            reinterpret_cast<mach_vm_address_t>(batched.data()), size, force);
+        if (MachInfo::writeWindows - windows > 1) {
+            printf("Differential: iteration %d opened %zu write windows\n", iter, MachInfo::writeWindows - windows);
+            return 1;
+        }
+        bool sequentialRet = applySequential(patcher, patches.data(), patches.size(), sequential.data(), size, force);
+        if (batched != (sequentialRet ? sequential : data) || batchedRet != sequentialRet) {
+            printf("Differential: iteration %d differs from Lilu\n", iter);
+            return 1;
+        }
+    }
+    hostQuiet = false;
+    printf("Differential: 20000 random batches match Lilu, each in one write window\n");
+    return 0;
+}
+
+// More code sections than `ImageSections::MaxRanges`, interleaved with data, so the last code range is grown over data.
+static int overlappingRanges() {
+    static constexpr size_t Sections = 40;
+    static constexpr size_t SectionSize = 0x100;
+    static constexpr size_t ImageSize = 0x1000 + Sections * SectionSize;
+    alignas(16) static UInt8 image[ImageSize] {};
+
+    auto *mh = reinterpret_cast<mach_header_64 *>(image);
+    mh->magic = MH_MAGIC_64;
+    mh->ncmds = 1;
+    auto *seg = reinterpret_cast<segment_command_64 *>(mh + 1);
+    seg->cmd = LC_SEGMENT_64;
+    seg->cmdsize = sizeof(segment_command_64) + Sections * sizeof(section_64);
+    seg->vmaddr = 0x10000;
+    seg->filesize = ImageSize;
+    seg->nsects = Sections;
+    mh->sizeofcmds = seg->cmdsize;
+    auto *sects = reinterpret_cast<section_64 *>(seg + 1);
+    for (size_t i = 0; i < Sections; i++) {
+        sects[i].addr = seg->vmaddr + 0x1000 + i * SectionSize;
+        sects[i].size = SectionSize;
+        sects[i].flags = i % 2 ? 0 : S_ATTR_PURE_INSTRUCTIONS;
+    }
+
+    static const UInt8 code[] = {0xC0, 0xDE, 0x11, 0x22}, codeNew[] = {0xC0, 0xDE, 0x33, 0x44};
+    static const UInt8 data[] = {0xDA, 0x7A, 0x11, 0x22}, dataNew[] = {0xDA, 0x7A, 0x33, 0x44};
+    memcpy(image + 0x1000 + (Sections - 2) * SectionSize + 0x10, code, sizeof(code));
+    memcpy(image + 0x1000 + (Sections - 1) * SectionSize + 0x10, data, sizeof(data));
+    const LookupPatchPlus patches[] = {
+        {nullptr, PatcherPlus::Section::Code, code, codeNew, 1},
+        {nullptr, PatcherPlus::Section::Data, data, dataNew, 1},
+    };
+
+    KernelPatcher patcher;
+    hostTelemetry.clear();
+    if (!LookupPatchPlus::applyAll(patcher, patches, reinterpret_cast<mach_vm_address_t>(image), ImageSize)) {
+        printf("Overlapping ranges: patches not applied\n");
+        return 1;
+    }
+    for (auto &record : hostTelemetry) {
+        if (record.method == PatchMethod::Batch && record.bytesScanned > Sections * SectionSize) {
+            printf("Overlapping ranges: scanned %u bytes of %zu bytes of sections\n", record.bytesScanned,
+                Sections * SectionSize);
+            return 1;
+        }
+    }
+    printf("Overlapping ranges: every byte scanned once\n");
+    return 0;
+}
+
+// A kext sized image with patches spread through it, like the X5000HWLibs and X6000 batches.
+static int benchmark() {
+    static constexpr size_t ImageSize = 16 * 1024 * 1024;
+    static constexpr size_t PatchCount = 25;
+    std::mt19937 rng(2);
+    Bytes image(ImageSize);
+    // Skewed towards the bytes common in x86-64 code, so anchors are not trivially unique.
+    static const UInt8 common[] = {0x00, 0x48, 0x89, 0x8B, 0xFF, 0x0F, 0xE8, 0x24, 0x45, 0x4C, 0xC3, 0x85, 0x74};
+    for (auto &b : image) { b = rng() % 4 ? common[rng() % arrsize(common)] : rng() % 256; }
+
+    std::vector<Bytes> store;
+    std::vector<LookupPatchPlus> patches;
+    for (size_t i = 0; i < PatchCount; i++) {
+        size_t len = 8 + rng() % 9;
+        Bytes find(len), replace(len);
+        for (auto &b : find) { b = common[rng() % arrsize(common)]; }
+        find[rng() % len] = 0xA0 + static_cast<UInt8>(i);
+        for (auto &b : replace) { b = 0x90; }
+        memcpy(image.data() + (i + 1) * (ImageSize / (PatchCount + 1)), find.data(), len);
+        store.push_back(find);
+        store.push_back(replace);
+        patches.emplace_back(nullptr, store[store.size() - 2].data(), store[store.size() - 1].data(), len, 1);
+    }
+
+    KernelPatcher patcher;
+    hostQuiet = true;
+    auto batched = image, sequential = image;
+    auto start = std::chrono::steady_clock::now();
+    bool batchedRet = LookupPatchPlus::applyAll(patcher, patches.data(), patches.size(),
+        reinterpret_cast<mach_vm_address_t>(batched.data()), ImageSize);
+    auto middle = std::chrono::steady_clock::now();
+    bool sequentialRet =
+        applySequential(patcher, patches.data(), patches.size(), sequential.data(), ImageSize, false);
+    auto end = std::chrono::steady_clock::now();
+    hostQuiet = false;
+
+    if (!batchedRet || !sequentialRet || batched != sequential) {
+        printf("Benchmark: results differ\n");
+        return 1;
+    }
+    auto batchedMs = std::chrono::duration<double, std::milli>(middle - start).count();
+    auto sequentialMs = std::chrono::duration<double, std::milli>(end - middle).count();
+    printf("Benchmark: %zu patches over %zu MiB: batched %.1f ms, one by one %.1f ms (%.1fx)\n", PatchCount,
+        ImageSize >> 20, batchedMs, sequentialMs, sequentialMs / batchedMs);
+    return 0;
+}
+
+int main() {
+    try {
+        return differential() | overlappingRanges() | benchmark();
+    } catch (const HostPanic &panic) {
+        printf("Panic: %s\n", panic.message);
+        return 1;
+    }
+}
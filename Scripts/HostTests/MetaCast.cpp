@@ -0,0 +1,183 @@
+// Sources: NootedRed/MetaCast.cpp
+// Includes: Stubs/NRed
+//
+// `MetaCast::wrapSafeMetaCast` must retry a failed cast to one class of a pair in `classMap` with the other one once
+// both are solved, and leave every other cast as the original made it, a null target included. Remaps counted by many
+// threads at once are all in the snapshot published after the burst, and the burst publishes once. Also times the
+// hook against the original alone and the walk of `classMap` it replaced, on successful, failed and remapped casts.
+
+#include <PrivateHeaders/MetaCast.hpp>
+#include <PrivateHeaders/NRed.hpp>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#define CHECK(cond)                                        \
+    do {                                                   \
+        if (!(cond)) {                                     \
+            printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            return 1;                                      \
+        }                                                  \
+    } while (0)
+
+static constexpr size_t Unrelated = 2000;
+static constexpr UInt32 Threads = 8;
+
+struct Object : OSMetaClassBase {
+    const OSMetaClass *meta;
+
+    explicit Object(const OSMetaClass *meta) : meta {meta} {}
+};
+
+// Stands in for `OSMetaClassBase::safeMetaCast`, without inheritance.
+__attribute__((noinline)) static OSMetaClassBase *original(const OSMetaClassBase *anObject, const OSMetaClass *toMeta) {
+    auto *object = static_cast<const Object *>(anObject);
+    return object->meta == toMeta ? const_cast<OSMetaClassBase *>(anObject) : nullptr;
+}
+
+// The hook before the filter: every failed cast walks the whole map.
+static OSMetaClassBase *walk(const OSMetaClassBase *anObject, const OSMetaClass *toMeta) {
+    auto &metaCast = MetaCast::singleton();
+    auto ret = FunctionCast(walk, metaCast.orgSafeMetaCast)(anObject, toMeta);
+
+    if (LIKELY(ret)) { return ret; }
+
+    for (const auto &ent : metaCast.classMap) {
+        if (UNLIKELY(ent[0] == toMeta)) {
+            return FunctionCast(walk, metaCast.orgSafeMetaCast)(anObject, ent[1]);
+        } else if (UNLIKELY(ent[1] == toMeta)) {
+            return FunctionCast(walk, metaCast.orgSafeMetaCast)(anObject, ent[0]);
+        }
+    }
+
+    return nullptr;
+}
+
+static UInt64 publishedRemaps() {
+    auto *number = static_cast<OSNumber *>(NRed::singleton().properties->getObject("NRed,MetaCastRemaps"));
+    return number ? number->unsigned64BitValue() : UINT64_MAX;
+}
+
+static std::vector<OSMetaClass *> unrelated;
+static std::vector<Object *> objects;    // One per unrelated class.
+static std::vector<Object *> paired;     // One per class of `classMap`, by pair and side.
+
+static int remaps() {
+    auto &metaCast = MetaCast::singleton();
+    auto &map = metaCast.classMap;
+    for (auto &ent : map) {
+        for (auto &meta : ent) { meta = new OSMetaClass; }
+    }
+
+    // Until the other kext is processed, nothing is remapped.
+    OSMetaClass *x6000[arrsize(map)][2];
+    memcpy(x6000, map, sizeof(map));
+    for (auto &ent : map) { ent[1] = nullptr; }
+    metaCast.rebuildFilter();
+    CHECK(NRed::singleton().properties->getObject("NRed,MetaCastRemaps") == nullptr);
+    for (size_t i = 0; i < arrsize(map); i++) {
+        paired.push_back(new Object(map[i][0]));
+        paired.push_back(new Object(x6000[i][1]));
+        CHECK(!MetaCast::wrapSafeMetaCast(paired[i * 2 + 1], map[i][0]));
+    }
+    memcpy(map, x6000, sizeof(map));
+    metaCast.rebuildFilter();
+    CHECK(publishedRemaps() == 0);
+
+    for (size_t i = 0; i < arrsize(map); i++) {
+        auto *x5000 = paired[i * 2], *x6000 = paired[i * 2 + 1];
+        CHECK(MetaCast::wrapSafeMetaCast(x5000, map[i][0]) == x5000);
+        CHECK(MetaCast::wrapSafeMetaCast(x5000, map[i][1]) == x5000);
+        CHECK(MetaCast::wrapSafeMetaCast(x6000, map[i][0]) == x6000);
+        CHECK(!MetaCast::wrapSafeMetaCast(x6000, map[(i + 1) % arrsize(map)][0]));
+        CHECK(!MetaCast::wrapSafeMetaCast(x6000, nullptr));
+    }
+    for (size_t i = 0; i < Unrelated; i++) {
+        CHECK(MetaCast::wrapSafeMetaCast(objects[i], unrelated[i]) == objects[i]);
+        CHECK(!MetaCast::wrapSafeMetaCast(objects[i], unrelated[(i + 1) % Unrelated]));
+        CHECK(!MetaCast::wrapSafeMetaCast(objects[i], map[i % arrsize(map)][i % 2]));
+    }
+    // A retry is counted whether or not the original then succeeds.
+    CHECK(thread_call_run_delayed() == 1);
+    CHECK(publishedRemaps() == arrsize(map) * 3 + Unrelated);
+    printf("Remaps: %zu class pairs remapped both ways, %zu unrelated classes left alone\n", arrsize(map), Unrelated);
+    return 0;
+}
+
+static int counters() {
+    static constexpr UInt32 Casts = 100000;
+    auto &map = MetaCast::singleton().classMap;
+    const auto before = publishedRemaps();
+
+    std::vector<std::thread> threads;
+    for (UInt32 thread = 0; thread < Threads; thread++) {
+        threads.emplace_back([&, thread] {
+            for (UInt32 i = 0; i < Casts; i++) {
+                auto pair = (thread + i) % arrsize(map);
+                MetaCast::wrapSafeMetaCast(paired[pair * 2 + 1], map[pair][0]);
+            }
+        });
+    }
+    for (auto &thread : threads) { thread.join(); }
+
+    CHECK(thread_call_run_delayed() == 1);
+    CHECK(thread_call_run_delayed() == 0);
+    CHECK(publishedRemaps() - before == static_cast<UInt64>(Threads) * Casts);
+    printf("Counters: %u threads remapped %u casts each, none lost, published once\n", Threads, Casts);
+    return 0;
+}
+
+using Cast = OSMetaClassBase *(*)(const OSMetaClassBase *, const OSMetaClass *);
+
+// Nanoseconds per cast, over `Rounds` passes of `cast` on every unrelated object.
+template<typename F>
+static double timeCasts(Cast cast, F target) {
+    static constexpr UInt32 Rounds = 200;
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (UInt32 round = 0; round < Rounds; round++) {
+        for (size_t i = 0; i < Unrelated; i++) { sink += reinterpret_cast<uintptr_t>(cast(objects[i], target(i))); }
+    }
+    auto end = std::chrono::steady_clock::now();
+    if (sink == 1) { printf("\n"); }
+    return std::chrono::duration<double, std::nano>(end - start).count() / (Rounds * Unrelated);
+}
+
+static int benchmark() {
+    auto &map = MetaCast::singleton().classMap;
+    auto same = [](size_t i) { return unrelated[i]; };
+    auto other = [](size_t i) { return unrelated[(i + 1) % Unrelated]; };
+
+    const double originalNs = timeCasts(original, other);
+    const double walkNs = timeCasts(walk, other), hookNs = timeCasts(MetaCast::wrapSafeMetaCast, other);
+    const double okWalkNs = timeCasts(walk, same), okHookNs = timeCasts(MetaCast::wrapSafeMetaCast, same);
+    printf("Benchmark: failed cast %.1f ns in the original, %.1f ns with the map walk, %.1f ns with the filter; "
+           "successful cast %.1f / %.1f ns\n",
+        originalNs, walkNs, hookNs, okWalkNs, okHookNs);
+
+    // Remapped casts, on the objects of the pairs.
+    static constexpr UInt32 Rounds = 100000;
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (UInt32 i = 0; i < Rounds; i++) {
+        auto pair = i % arrsize(map);
+        sink += reinterpret_cast<uintptr_t>(MetaCast::wrapSafeMetaCast(paired[pair * 2 + 1], map[pair][0]));
+    }
+    auto end = std::chrono::steady_clock::now();
+    thread_call_run_delayed();
+    printf("Benchmark: remapped cast %.1f ns, counted\n",
+        std::chrono::duration<double, std::nano>(end - start).count() / Rounds);
+    return sink == 0;
+}
+
+int main() {
+    hostQuiet = true;
+    auto &metaCast = MetaCast::singleton();
+    metaCast.init();
+    metaCast.orgSafeMetaCast = reinterpret_cast<mach_vm_address_t>(original);
+    for (size_t i = 0; i < Unrelated; i++) {
+        unrelated.push_back(new OSMetaClass);
+        objects.push_back(new Object(unrelated.back()));
+    }
+    return remaps() | counters() | benchmark();
+}
@@ -0,0 +1,100 @@
+// Sources: NootedRed/PatcherPlus.cpp NootedRed/OffsetCache.cpp Scripts/HostTests/Stubs/PatchTelemetry.cpp
+//
+// The offset cache is written to NVRAM once the kexts stop loading, with the records of kexts that did not load this
+// boot kept. A patch replayed from it is rolled back when a later patch of its batch fails.
+
+#include <Headers/kern_api.hpp>
+#include <Headers/kern_nvram.hpp>
+#include <PrivateHeaders/OffsetCache.hpp>
+#include <PrivateHeaders/PatcherPlus.hpp>
+#include <kern/thread_call.h>
+#include <mach-o/loader.h>
+
+#define CHECK(cond)                                        \
+    do {                                                   \
+        if (!(cond)) {                                     \
+            printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            return 1;                                      \
+        }                                                  \
+    } while (0)
+
+static constexpr size_t ImageSize = 0x2000;
+alignas(16) static UInt8 images[3][ImageSize];
+
+static mach_vm_address_t buildImage(size_t index) {
+    auto *image = images[index];
+    memset(image, 0x90, ImageSize);
+    auto *mh = reinterpret_cast<mach_header_64 *>(image);
+    memset(mh, 0, 0x400);
+    mh->magic = MH_MAGIC_64;
+    mh->ncmds = 2;
+    auto *seg = reinterpret_cast<segment_command_64 *>(mh + 1);
+    seg->cmd = LC_SEGMENT_64;
+    seg->cmdsize = sizeof(segment_command_64) + sizeof(section_64);
+    seg->vmaddr = 0x10000;
+    seg->filesize = ImageSize;
+    seg->nsects = 1;
+    auto *sect = reinterpret_cast<section_64 *>(seg + 1);
+    sect->addr = 0x10800;
+    sect->size = 0x1800;
+    sect->flags = S_ATTR_PURE_INSTRUCTIONS;
+    auto *uuid = reinterpret_cast<uuid_command *>(image + sizeof(mach_header_64) + seg->cmdsize);
+    uuid->cmd = LC_UUID;
+    uuid->cmdsize = sizeof(uuid_command);
+    memset(uuid->uuid, 0xA0 + static_cast<int>(index), sizeof(uuid->uuid));
+    mh->sizeofcmds = seg->cmdsize + uuid->cmdsize;
+    return reinterpret_cast<mach_vm_address_t>(image);
+}
+
+static const UInt8 find[] = {0xAA, 0xBB, 0xCC, 0xDD}, replace[] = {0x01, 0x02, 0x03, 0x04};
+
+int main() {
+    // The previous boot stored a record for a kext that has not loaded yet.
+    OffsetCacheRecord previous {};
+    memset(previous.uuid, 0xEE, sizeof(previous.uuid));
+    previous.entries.push_back({0x1234, 0x900});
+    const OffsetCacheRecord *previousRecords[] = {&previous};
+    hostNVRAM.size = static_cast<UInt32>(OffsetCache::serialise(previousRecords, 1, hostNVRAM.data, 0));
+    OffsetCache::serialise(previousRecords, 1, hostNVRAM.data, sizeof(hostNVRAM.data));
+    hostNVRAM.present = true;
+
+    OffsetCache::singleton().init();
+    KernelPatcher patcher;
+    for (size_t i = 0; i < 3; i++) {
+        auto address = buildImage(i);
+        memcpy(images[i] + 0x900 + i * 0x10, find, sizeof(find));
+        const LookupPatchPlus patches[] = {{nullptr, find, replace, 1}, {nullptr, replace, find, 1}};
+        CHECK(LookupPatchPlus::applyAll(patcher, patches, address, ImageSize));
+        lilu.runKextLoad(patcher, i, address, ImageSize);
+        CHECK(hostNVRAM.writes == 0);
+    }
+    lilu.runKextLoad(patcher, 3);
+
+    CHECK(thread_call_run_delayed() == 1);
+    CHECK(hostNVRAM.writes == 1);
+    OffsetCacheRecord stored[8] {};
+    size_t storedCount = 0;
+    CHECK(OffsetCache::deserialise(hostNVRAM.data, hostNVRAM.size, stored, 8, storedCount));
+    CHECK(storedCount == 4);
+    for (size_t i = 0; i < 3; i++) {
+        CHECK(stored[i].uuid[0] == 0xA0 + i);
+        CHECK(stored[i].entries.size() == 2);
+    }
+    CHECK(stored[3].uuid[0] == 0xEE && stored[3].entries.size() == 1);
+
+    // Nothing changed since, so there is nothing more to write.
+    lilu.runKextLoad(patcher, 4);
+    CHECK(thread_call_run_delayed() == 0);
+    CHECK(hostNVRAM.writes == 1);
+
+    // A batch that fails once its cached patches were replayed puts them back.
+    static const UInt8 missing[] = {0x55, 0x66, 0x77, 0x88};
+    const LookupPatchPlus failing[] = {{nullptr, find, replace, 1}, {nullptr, missing, replace, 1}};
+    auto windows = MachInfo::writeWindows;
+    CHECK(!LookupPatchPlus::applyAll(patcher, failing, reinterpret_cast<mach_vm_address_t>(images[0]), ImageSize));
+    CHECK(MachInfo::writeWindows - windows == 2);
+    CHECK(!memcmp(images[0] + 0x900, find, sizeof(find)));
+
+    printf("Stored %zu records in %u bytes with one NVRAM write\n", storedCount, hostNVRAM.size);
+    return 0;
+}
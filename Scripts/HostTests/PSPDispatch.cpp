@@ -0,0 +1,210 @@
+// Sources: NootedRed/iVega/PSPDispatch.cpp
+// Firmware: incbin
+//
+// `PSPDispatch` must select what the switch in `wrapPspCmdKmSubmit` used to, for every ASIC and PCI revision that
+// changes the selection, on every UCode ID, trusted application and ASD, without reaching a disabled file. Also times a
+// lookup in the table against building the filename and looking it up on every load, as the switch did.
+
+#include <PrivateHeaders/iVega/PSPDispatch.hpp>
+#include <chrono>
+#include <string>
+
+using namespace iVega;
+
+// The switch, transcribed. "" is a skip, "!" is unexpected and "-" is a pass through.
+static std::string legacy(const NRedAttributes &attributes, UInt32 pciRevision, UInt32 ucodeID) {
+    const auto *prefix = attributes.getGCPrefix();
+    const auto renoir = attributes.isRenoir();
+    const char *suffix;
+    switch (ucodeID) {
+        case kUCodeCE:
+            suffix = "ce_ucode.bin";
+            break;
+        case kUCodePFP:
+            suffix = "pfp_ucode.bin";
+            break;
+        case kUCodeME:
+            suffix = "me_ucode.bin";
+            break;
+        case kUCodeMEC1JT:
+            suffix = "mec_jt_ucode.bin";
+            break;
+        case kUCodeMEC2JT:
+            if (renoir) { return ""; }
+            suffix = "mec_jt_ucode.bin";
+            break;
+        case kUCodeMEC1:
+            suffix = "mec_ucode.bin";
+            break;
+        case kUCodeMEC2:
+            if (renoir) { return ""; }
+            suffix = "mec_ucode.bin";
+            break;
+        case kUCodeRLC:
+            if ((!attributes.isPicasso() && !attributes.isRaven2() && attributes.isRaven()) ||
+                (attributes.isPicasso() &&
+                    ((pciRevision >= 0xC8 && pciRevision <= 0xCC) || (pciRevision >= 0xD8 && pciRevision <= 0xDD)))) {
+                suffix = "rlc_fake_cgpg_ucode.bin";
+            } else {
+                suffix = "rlc_ucode.bin";
+            }
+            break;
+        case kUCodeSDMA0:
+            return "sdma_4_1_ucode.bin";
+        case kUCodeDMCUERAM:
+            return renoir ? "dmcu_eram_dcn21.bin" : "dmcu_eram_dcn10.bin";
+        case kUCodeDMCUISR:
+            return renoir ? "dmcu_intvectors_dcn21.bin" : "dmcu_intvectors_dcn10.bin";
+        case kUCodeRLCV:
+            if (renoir) { return ""; }
+            suffix = "rlcv_ucode.bin";
+            break;
+        case kUCodeRLCSRListGPM:
+            suffix = "rlc_srlist_gpm_mem.bin";
+            break;
+        case kUCodeRLCSRListSRM:
+            suffix = "rlc_srlist_srm_mem.bin";
+            break;
+        case kUCodeRLCSRListCntl:
+            suffix = "rlc_srlist_cntl.bin";
+            break;
+        case kUCodeDMCUB:
+            return renoir ? "atidmcub_rn.dat" : "!";
+        default:
+            return "-";
+    }
+    return std::string(prefix) + suffix;
+}
+
+static std::string show(const PSPLoadEntry &entry) {
+    switch (entry.action) {
+        case PSPLoadAction::PassThrough:
+            return "-";
+        case PSPLoadAction::Skip:
+            return "";
+        case PSPLoadAction::Unexpected:
+            return "!";
+        default:
+            return entry.fw->name;
+    }
+}
+
+// Disables what `NRed::processPatcher` does for the device, as the table is built after that.
+static void disable(const NRedAttributes &attributes) {
+    UInt8 asics = kFWASICRenoir;
+    if (!attributes.isRenoir()) { asics = kFWASICRaven2 | (attributes.isPicasso() ? kFWASICPicasso : kFWASICRaven); }
+    firmwareDisabledGroups = 0;
+    for (size_t i = 0; i < firmwareGroupCount; i++) {
+        if ((firmwareGroups[i].asics & asics) == 0) { firmwareDisabledGroups |= (1U << i); }
+    }
+}
+
+static const struct {
+    const char *name;
+    UInt32 deviceID;
+    UInt16 devRevision;
+    UInt32 pciRevision;
+} Devices[] = {
+    {"Raven", 0x15DD, 0x1, 0xC1},
+    {"Raven 2", 0x15DD, 0x8, 0xC1},
+    {"Picasso", 0x15D8, 0x1, 0xC1},
+    {"Picasso C8", 0x15D8, 0x1, 0xC8},
+    {"Picasso CC", 0x15D8, 0x1, 0xCC},
+    {"Picasso CD", 0x15D8, 0x1, 0xCD},
+    {"Picasso D8", 0x15D8, 0x1, 0xD8},
+    {"Picasso DD", 0x15D8, 0x1, 0xDD},
+    {"Picasso DE", 0x15D8, 0x1, 0xDE},
+    {"Raven 2 (15D8) C8", 0x15D8, 0x8, 0xC8},
+    {"Raven 2 (15D8) E0", 0x15D8, 0x8, 0xE0},
+    {"Renoir", 0x1636, 0x0, 0xC1},
+    {"Renoir E", 0x1636, 0x0, 0x80},
+    {"Green Sardine", 0x1638, 0x0, 0xC1},
+};
+
+static const char *const TrustedApplications[][2] = {
+    {"AMD DTM Application", "psp_dtm.bin"},
+    {"AMD HDCP Application", "psp_hdcp.bin"},
+    {"AMD AUC Application", "psp_auc.bin"},
+    {"AMD FP Application", "psp_fp.bin"},
+    {"AMD FP Applicationx", "-"},
+    {"AMD RAP Application", "-"},
+};
+
+static int selection() {
+    int checks = 0, mismatches = 0;
+    for (auto &device : Devices) {
+        NRedAttributes attributes {};
+        attributes.setDevice(device.deviceID);
+        attributes.setRevision(device.devRevision, device.pciRevision);
+        disable(attributes);
+        PSPDispatch dispatch {};
+        try {
+            dispatch.build(attributes, device.pciRevision);
+        } catch (const HostPanic &panic) {
+            printf("%s: %s\n", device.name, panic.message);
+            return 1;
+        }
+
+        auto check = [&](const std::string &got, const std::string &want, const char *what, UInt32 id) {
+            checks += 1;
+            if (got == want) { return; }
+            printf("%s %s %u: want '%s', got '%s'\n", device.name, what, id, want.c_str(), got.c_str());
+            mismatches += 1;
+        };
+        for (UInt32 id = 0; id < 64; id++) {
+            check(show(dispatch.getIPFW(id)), legacy(attributes, device.pciRevision, id), "UCode", id);
+        }
+        for (UInt32 i = 0; i < arrsize(TrustedApplications); i++) {
+            check(show(dispatch.getTA(TrustedApplications[i][0])), TrustedApplications[i][1], "TA", i);
+        }
+        check(show(dispatch.getASD()), "psp_asd.bin", "ASD", 0);
+    }
+    firmwareDisabledGroups = 0;
+
+    // A skipped trusted application is acknowledged without a load.
+    NRedAttributes attributes {};
+    attributes.setDevice(0x1636);
+    PSPDispatch dispatch {};
+    dispatch.build(attributes, 0xC1, kPSPTAHDCP);
+    checks += 2;
+    if (dispatch.getTA("AMD HDCP Application").action != PSPLoadAction::Skip ||
+        dispatch.getTA("AMD DTM Application").action != PSPLoadAction::Load) {
+        printf("NRedSkipTA: HDCP is not skipped alone\n");
+        mismatches += 1;
+    }
+
+    printf("Selection: %d checks over %zu devices, %d mismatches\n", checks, arrsize(Devices), mismatches);
+    return mismatches != 0;
+}
+
+static int benchmark() {
+    static constexpr int Rounds = 200000;
+    static const UInt32 ucodeIDs[] = {kUCodeCE, kUCodePFP, kUCodeME, kUCodeMEC1JT, kUCodeMEC1, kUCodeRLC, kUCodeSDMA0,
+        kUCodeDMCUERAM, kUCodeDMCUISR, kUCodeRLCSRListGPM, kUCodeRLCSRListSRM, kUCodeRLCSRListCntl, kUCodeDMCUB};
+    NRedAttributes attributes {};
+    attributes.setDevice(0x1636);
+    PSPDispatch dispatch {};
+    dispatch.build(attributes, 0xC1);
+
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < Rounds; round++) {
+        for (auto id : ucodeIDs) {
+            auto name = legacy(attributes, 0xC1, id);
+            sink += getFWDescriptorByName(name.c_str()).metadata.length;
+        }
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (int round = 0; round < Rounds; round++) {
+        for (auto id : ucodeIDs) { sink += dispatch.getIPFW(id).fw->metadata.length; }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    const double lookups = Rounds * arrsize(ucodeIDs);
+    auto legacyNs = std::chrono::duration<double, std::nano>(middle - start).count() / lookups;
+    auto tableNs = std::chrono::duration<double, std::nano>(end - middle).count() / lookups;
+    printf("Benchmark: filename and lookup %.1f ns, table %.1f ns per load\n", legacyNs, tableNs);
+    return sink == 0;
+}
+
+int main() { return selection() | benchmark(); }
@@ -0,0 +1,77 @@
+// Sources: NootedRed/PatcherPlus.cpp NootedRed/OffsetCache.cpp Scripts/HostTests/Stubs/PatchTelemetry.cpp
+//
+// `PatcherPlus::remapDisplacements` scans bytes, so it must tolerate matches it cannot tell apart from real call sites:
+// extra occurrences, including ones past the end of the function, only replace the first `count`, fewer than `count`
+// are all replaced, and a missing one queues nothing.
+
+#include <PrivateHeaders/PatcherPlus.hpp>
+
+#define CHECK(cond)                                        \
+    do {                                                   \
+        if (!(cond)) {                                     \
+            printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            return 1;                                      \
+        }                                                  \
+    } while (0)
+
+static UInt8 code[PAGE_SIZE];
+
+// `call qword ptr [rax + disp32]`, or `jmp` with `jump`.
+static void emit(size_t offset, UInt32 disp, bool jump = false) {
+    code[offset] = 0xFF;
+    code[offset + 1] = jump ? 0xA0 : 0x90;
+    memcpy(code + offset + 2, &disp, sizeof(disp));
+}
+
+static UInt32 displacement(size_t offset) {
+    UInt32 disp;
+    memcpy(&disp, code + offset + 2, sizeof(disp));
+    return disp;
+}
+
+int main() {
+    auto &transaction = KernelWriteTransaction::singleton();
+    const PatcherPlus::DisplacementFix fixes[] = {{0x1B8, 0x1B0, 2}, {0x218, 0x210, 1}};
+
+    // The function is 0x100 bytes; the next one has the same calls, and a constant in the first one looks like one.
+    memset(code, 0x90, sizeof(code));
+    emit(0x10, 0x1B8);
+    emit(0x40, 0x218, true);
+    emit(0x80, 0x1B8);
+    code[0xC0] = 0x48;
+    code[0xC1] = 0xB8;
+    emit(0xC2, 0x218);
+    emit(0x140, 0x1B8);
+    emit(0x180, 0x218, true);
+    CHECK(PatcherPlus::remapDisplacements(code, sizeof(code), fixes, arrsize(fixes)));
+    CHECK(transaction.pending() == 3);
+    CHECK(transaction.commit());
+    CHECK(displacement(0x10) == 0x1B0 && displacement(0x40) == 0x210 && displacement(0x80) == 0x1B0);
+    CHECK(displacement(0xC2) == 0x218 && displacement(0x140) == 0x1B8 && displacement(0x180) == 0x218);
+
+    // Fewer than `count`, as in a build that inlined one of the calls differently.
+    memset(code, 0x90, sizeof(code));
+    emit(0x10, 0x1B8);
+    emit(0x40, 0x218);
+    CHECK(PatcherPlus::remapDisplacements(code, sizeof(code), fixes, arrsize(fixes)));
+    CHECK(transaction.pending() == 2);
+    CHECK(transaction.commit());
+    CHECK(displacement(0x10) == 0x1B0 && displacement(0x40) == 0x210);
+
+    // One displacement missing: nothing is queued, and the caller decides whether to panic.
+    memset(code, 0x90, sizeof(code));
+    emit(0x10, 0x1B8);
+    emit(0x80, 0x1B8);
+    CHECK(!PatcherPlus::remapDisplacements(code, sizeof(code), fixes, arrsize(fixes)));
+    CHECK(transaction.pending() == 0);
+
+    // The window ends at the image end; a call site cut off by it does not count.
+    emit(sizeof(code) - 6, 0x218);
+    CHECK(!PatcherPlus::remapDisplacements(code, sizeof(code) - 1, fixes, arrsize(fixes)));
+    CHECK(PatcherPlus::remapDisplacements(code, sizeof(code), fixes, arrsize(fixes)));
+    CHECK(transaction.commit());
+    CHECK(displacement(sizeof(code) - 6) == 0x210);
+
+    printf("Displacements remapped with extra and cut off matches\n");
+    return 0;
+}
@@ -0,0 +1,95 @@
+#!/bin/bash
+
+# Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+# See LICENSE for details.
+
+# Builds the parts of NootedRed that do not touch the hardware against Shim/, a small stand-in for Lilu and the kernel
+# headers, and runs the tests and benchmarks in this directory on the build host (macOS or Linux).
+#
+# Usage: Scripts/HostTests/Run.sh [test...]
+#        Scripts/HostTests/Run.sh --build Tools/<name>
+#
+# Each test lists what it is built from in its first comment lines:
+#   // Sources: <files, relative to the repository root>
+#   // Includes: <directories searched before Shim/, relative to this directory>
+#   // Firmware: <GenerateFirmware.py backends; the test is built and run once with the store of each>
+
+set -u
+
+here="$(cd "$(dirname "$0")" && pwd)"
+root="$(cd "${here}/../.." && pwd)"
+build="${HOST_TEST_BUILD:-${root}/build/HostTests}"
+cxx="${CXX:-c++}"
+mkdir -p "${build}"
+
+directive() {
+    sed -n "s|^// $2: ||p" "$1" | head -n 1
+}
+
+# Builds a test or tool into the build directory, as its name, or as `<name>-<backend>` with a firmware store.
+build_test() {
+    local test="$1" backend="${2:-}" name sources includes flags
+    name="$(basename "${test}" .cpp)${backend:+-${backend}}"
+    sources="$(directive "${test}" Sources)"
+    includes="$(directive "${test}" Includes)"
+
+    flags=(-std=c++20 -O2 -g -pthread -Wall -Wno-unused-function -Wno-unused-variable -Wno-trigraphs)
+    for dir in ${includes}; do flags+=(-I "${here}/${dir}"); done
+    local files=("${test}")
+    if [ -n "${backend}" ]; then
+        local store="${build}/${name}.fw"
+        python3 "${root}/Scripts/GenerateFirmware.py" -b "${backend}" -r "${root}" -o "${store}/Blobs" \
+            -i "${store}/PrivateHeaders/FirmwareIndex.hpp" "${store}/Firmware.cpp" "${root}/NootedRed/Firmware" \
+            >/dev/null || return 1
+        flags+=(-I "${store}")
+        files+=("${store}/Firmware.cpp")
+    fi
+    flags+=(-I "${here}/Shim" -I "${root}/NootedRed")
+    for file in ${sources}; do files+=("${root}/${file}"); done
+
+    # From the root, which the `.incbin` paths of a firmware store are relative to.
+    (cd "${root}" && "${cxx}" "${flags[@]}" "${files[@]}" -o "${build}/${name}")
+}
+
+run_test() {
+    local test="$1" backends backend name
+    read -r -a backends <<<"$(directive "${test}" Firmware)"
+    [ ${#backends[@]} -gt 0 ] || backends=("")
+    for backend in "${backends[@]}"; do
+        name="$(basename "${test}" .cpp)${backend:+-${backend}}"
+        if ! build_test "${test}" "${backend}"; then
+            echo "FAIL ${name}: build"
+            return 1
+        fi
+        if ! "${build}/${name}"; then
+            echo "FAIL ${name}"
+            return 1
+        fi
+        echo "PASS ${name}"
+    done
+}
+
+# Tools/ holds programs the other scripts run; `--build Tools/<name>` builds one and prints its path.
+if [ "${1:-}" = "--build" ]; then
+    [ $# -eq 2 ] || { echo "Usage: $0 --build <source>" >&2; exit 2; }
+    build_test "${here}/${2%.cpp}.cpp" >&2 || exit 1
+    echo "${build}/$(basename "${2%.cpp}")"
+    exit 0
+fi
+
+tests=()
+if [ $# -gt 0 ]; then
+    for arg in "$@"; do tests+=("${here}/${arg%.cpp}.cpp"); done
+else
+    tests=("${here}"/*.cpp)
+fi
+
+failed=0
+for test in "${tests[@]}"; do
+    echo "=== $(basename "${test}" .cpp)"
+    run_test "${test}" || failed=$((failed + 1))
+done
+
+echo
+echo "${#tests[@]} tests, ${failed} failed"
+[ "${failed}" -eq 0 ]
@@ -0,0 +1,241 @@
+// Sources: NootedRed/SMU.cpp
+// Includes: Stubs/NRed
+//
+// Threads sending through `SMU` at once, synchronously and queued, must never overlap two exchanges on the mailbox, and
+// each must get the answer to its own message. Queued messages complete in the order they were queued, and a
+// synchronous one only after those its thread queued before it. A completion cannot send synchronously, and a full
+// queue rejects the message. The firmware version is only asked for by `queryVersion`, and a message the firmware
+// does not know is sent once, both until the capabilities are reset. The published trace is a copy holding only whole
+// records, even while threads send, and is published again after a burst of exchanges. Also times an exchange alone
+// and under contention.
+
+#include <PrivateHeaders/NRed.hpp>
+#include <PrivateHeaders/SMU.hpp>
+#include <chrono>
+#include <kern/thread_call.h>
+#include <vector>
+
+#define CHECK(cond)                                        \
+    do {                                                   \
+        if (!(cond)) {                                     \
+            printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            return 1;                                      \
+        }                                                  \
+    } while (0)
+
+static constexpr UInt32 Threads = 8;
+
+static UInt32 expected(UInt32 msg, UInt32 param) { return msg * 31 + param; }
+
+// Waits for the queue to drain.
+static void drain() {
+    for (auto *call : hostThreadCalls) { thread_call_join(call); }
+}
+
+struct Producer {
+    std::atomic<UInt32> done {0};    // Sequence number of the last completed message.
+    std::atomic<int> errors {0};
+};
+
+static void completed(void *owner, UInt32 msg, CAILResult result, UInt32 outParam) {
+    auto *producer = static_cast<Producer *>(owner);
+    const auto seq = msg & 0xFFFF;
+    if (result != kCAILResultSuccess || outParam != expected(msg, seq)) { producer->errors += 1; }
+    if (producer->done != seq - 1) { producer->errors += 1; }
+    producer->done = seq;
+}
+
+static OSNumber *publishedVersion() {
+    return static_cast<OSNumber *>(NRed::singleton().properties->getObject("NRed,SMUVersion"));
+}
+
+static int capabilities() {
+    auto &smu = SMU::singleton();
+    auto &nred = NRed::singleton();
+    nred.unknownMessages = 1ULL << PPSMC_MSG_PowerGateAtHub;
+
+    CHECK(smu.send(PPSMC_MSG_PowerUpSdma) == kCAILResultSuccess);
+    CHECK(nred.sent[PPSMC_MSG_GetSmuVersion] == 0 && publishedVersion() == nullptr);
+    smu.queryVersion();
+    CHECK(nred.sent[PPSMC_MSG_GetSmuVersion] == 1);
+    CHECK(publishedVersion() && publishedVersion()->unsigned64BitValue() == nred.version);
+    // Known until a reset, as on a resume without one.
+    smu.queryVersion();
+    CHECK(nred.sent[PPSMC_MSG_GetSmuVersion] == 1);
+
+    CHECK(smu.send(PPSMC_MSG_PowerGateAtHub) == kCAILResultUnsupported);
+    CHECK(smu.send(PPSMC_MSG_PowerGateAtHub) == kCAILResultUnsupported);
+    CHECK(nred.sent[PPSMC_MSG_PowerGateAtHub] == 1);
+
+    // The firmware after a full ASIC reset knows it.
+    smu.resetCapabilities();
+    nred.unknownMessages = 0;
+    nred.version += 1;
+    smu.queryVersion();
+    CHECK(publishedVersion()->unsigned64BitValue() == nred.version);
+    CHECK(smu.send(PPSMC_MSG_PowerGateAtHub) == kCAILResultSuccess);
+    CHECK(nred.sent[PPSMC_MSG_PowerGateAtHub] == 2 && nred.sent[PPSMC_MSG_GetSmuVersion] == 2);
+    printf("Capabilities: version queried on request, unknown message sent once until a reset\n");
+    return 0;
+}
+
+static int stress() {
+    static constexpr UInt32 Messages = 400;
+    auto &smu = SMU::singleton();
+    auto &nred = NRed::singleton();
+    nred.latencyUsec = 5;
+
+    // Two in three messages are queued; a full queue falls back to a synchronous send.
+    std::vector<Producer> producers(Threads);
+    std::atomic<int> errors {0};
+    std::vector<std::thread> threads;
+    for (UInt32 thread = 0; thread < Threads; thread++) {
+        threads.emplace_back([&, thread] {
+            auto &producer = producers[thread];
+            for (UInt32 seq = 1; seq <= Messages; seq++) {
+                const auto msg = ((thread + 1) << 16) | seq;
+                if ((seq % 3) != 0 && smu.sendAsync(msg, seq, completed, &producer)) { continue; }
+                UInt32 out = 0;
+                if (smu.send(msg, seq, &out) != kCAILResultSuccess || out != expected(msg, seq)) { errors += 1; }
+                if (producer.done != seq - 1) { errors += 1; }
+                producer.done = seq;
+            }
+        });
+    }
+    for (auto &thread : threads) { thread.join(); }
+    drain();
+
+    for (auto &producer : producers) {
+        CHECK(producer.done == Messages);
+        errors += producer.errors;
+    }
+    CHECK(errors == 0);
+    CHECK(nred.violations == 0);
+    printf("Stress: %u threads sent %u messages each in order, without overlapping exchanges\n", Threads, Messages);
+    return 0;
+}
+
+static std::atomic<CAILResult> nestedResult {kCAILResultSuccess};
+
+static int reentrancy() {
+    auto &smu = SMU::singleton();
+    auto &nred = NRed::singleton();
+    nred.latencyUsec = 200;
+
+    // Sent from the completion, while the mailbox is held.
+    const auto nested = nred.sent[3].load();
+    CHECK(smu.sendAsync(0x10001, 0,
+        [](void *, UInt32, CAILResult, UInt32) { nestedResult = SMU::singleton().send(0x10003); }));
+    UInt32 out = 0;
+    CHECK(smu.send(0x10002, 7, &out) == kCAILResultSuccess && out == expected(0x10002, 7));
+    drain();
+    CHECK(nestedResult == kCAILResultFailed);
+    CHECK(nred.sent[3] == nested);
+
+    // Filled while the drain waits on a slow exchange, so some are rejected; the accepted ones are all sent.
+    const auto before = nred.sent[4].load();
+    int rejected = 0;
+    for (UInt32 i = 0; i < 40; i++) { rejected += !smu.sendAsync(0x10004, i); }
+    CHECK(rejected > 0);
+    CHECK(smu.send(0x10005) == kCAILResultSuccess);
+    CHECK(nred.sent[4] - before == 40 - rejected);
+    drain();
+    CHECK(nred.violations == 0);
+    printf("Reentrancy: a send from a completion fails, a full queue rejected %d of 40 messages\n", rejected);
+    return 0;
+}
+
+// `trace` tags its messages with the sender past this, so its records can be told apart from the earlier ones.
+static constexpr UInt32 TraceTag = 0x100000;
+
+// Checks the records `trace` sent in a copy of the trace. Returns how many there are.
+static int checkTrace(const OSData *records, int &torn) {
+    const auto *trace = static_cast<const SMUTraceRecord *>(records->getBytesNoCopy());
+    int used = 0;
+    for (size_t i = 0; i < records->getLength() / sizeof(SMUTraceRecord); i++) {
+        if (!trace[i].seq || trace[i].msg < TraceTag) { continue; }
+        used += 1;
+        if ((trace[i].msg & 0xFFFF) != trace[i].param || trace[i].response != kSMUFWResponseSuccess ||
+            trace[i].result != kCAILResultSuccess) {
+            torn += 1;
+        }
+    }
+    return used;
+}
+
+static const OSData *publishedRecords() {
+    auto *trace = static_cast<OSDictionary *>(NRed::singleton().properties->getObject("NRed,SMUTrace"));
+    return trace ? static_cast<const OSData *>(trace->getObject("Records")) : nullptr;
+}
+
+static int trace() {
+    static constexpr UInt32 Messages = 20000;
+    auto &smu = SMU::singleton();
+    NRed::singleton().latencyUsec = 0;
+
+    // Published after a burst, rather than when the caller asks.
+    smu.send(0x10007, 7);
+    CHECK(thread_call_run_delayed() == 1);
+    CHECK(thread_call_run_delayed() == 0);
+    const auto *records = publishedRecords();
+    CHECK(records != nullptr && records->getLength() == sizeof(SMUTraceRecord) * 128);
+
+    std::atomic<bool> sending {true};
+    std::vector<std::thread> threads;
+    for (UInt32 thread = 0; thread < Threads; thread++) {
+        threads.emplace_back([&, thread] {
+            for (UInt32 seq = 1; seq <= Messages; seq++) { smu.send(TraceTag + (thread << 16) + seq, seq); }
+        });
+    }
+    std::thread stopper([&] {
+        for (auto &thread : threads) { thread.join(); }
+        sending = false;
+    });
+    int snapshots = 0, torn = 0, changed = 0;
+    while (sending) {
+        smu.publish();
+        records = publishedRecords();
+        const auto *bytes = static_cast<const UInt8 *>(records->getBytesNoCopy());
+        std::vector<UInt8> taken(bytes, bytes + records->getLength());
+        checkTrace(records, torn);
+        // Unchanged by the exchanges made since.
+        std::this_thread::yield();
+        changed += memcmp(taken.data(), records->getBytesNoCopy(), taken.size()) != 0;
+        snapshots += 1;
+    }
+    stopper.join();
+    thread_call_run_delayed();
+    CHECK(torn == 0 && changed == 0);
+    CHECK(checkTrace(publishedRecords(), torn) == 128 && torn == 0);
+    printf("Trace: %d snapshots taken while %u threads sent, none torn\n", snapshots, Threads);
+    return 0;
+}
+
+static int benchmark() {
+    static constexpr UInt32 Rounds = 20000;
+    auto &smu = SMU::singleton();
+    NRed::singleton().latencyUsec = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (UInt32 i = 0; i < Rounds; i++) { smu.send(0x10006, i); }
+    auto middle = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (UInt32 thread = 0; thread < Threads; thread++) {
+        threads.emplace_back([&] {
+            for (UInt32 i = 0; i < Rounds / Threads; i++) { smu.send(0x10006, i); }
+        });
+    }
+    for (auto &thread : threads) { thread.join(); }
+    auto end = std::chrono::steady_clock::now();
+
+    auto aloneNs = std::chrono::duration<double, std::nano>(middle - start).count() / Rounds;
+    auto contendedNs = std::chrono::duration<double, std::nano>(end - middle).count() / Rounds;
+    printf("Benchmark: %.0f ns per exchange alone, %.0f ns with %u threads\n", aloneNs, contendedNs, Threads);
+    return NRed::singleton().violations != 0;
+}
+
+int main() {
+    hostQuiet = true;
+    SMU::singleton().init();
+    return capabilities() | stress() | reentrancy() | trace() | benchmark();
+}
@@ -0,0 +1,33 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+// Lilu's kext load hooks. A test runs the registered hooks itself with `runKextLoad`, as Lilu would after each kext.
+
+#pragma once
+#include <Headers/kern_patcher.hpp>
+
+class LiluAPI {
+    public:
+    using t_kextLoadCallback = void (*)(void *user, KernelPatcher &patcher, size_t id, mach_vm_address_t slide,
+        size_t size);
+
+    void onKextLoadForce(KernelPatcher::KextInfo *, size_t, t_kextLoadCallback callback, void *user = nullptr) {
+        PANIC_COND(this->callbackCount == arrsize(this->callbacks), "Lilu", "Too many kext load hooks");
+        this->callbacks[this->callbackCount++] = {callback, user};
+    }
+
+    void runKextLoad(KernelPatcher &patcher, size_t id, mach_vm_address_t slide = 0, size_t size = 0) {
+        for (size_t i = 0; i < this->callbackCount; i++) {
+            this->callbacks[i].callback(this->callbacks[i].user, patcher, id, slide, size);
+        }
+    }
+
+    private:
+    struct {
+        t_kextLoadCallback callback;
+        void *user;
+    } callbacks[16] {};
+    size_t callbackCount {0};
+};
+
+inline LiluAPI lilu;
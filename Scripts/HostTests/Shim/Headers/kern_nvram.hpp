@@ -0,0 +1,49 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+// Lilu's NVRAM access, backed by one in-memory variable so a test can inspect what was written and when.
+
+#pragma once
+#include <Headers/kern_util.hpp>
+
+#define LILU_VENDOR_GUID "E09B9297-7928-4440-9AAB-D1F8536FBF0A"
+#define NVRAM_PREFIX(x, y) x ":" y
+
+struct HostNVRAM {
+    UInt8 data[0x10000];
+    UInt32 size;
+    bool present;
+    size_t writes;
+};
+inline HostNVRAM hostNVRAM {};
+
+class NVStorage {
+    public:
+    enum Options {
+        OptAuthenticate = 1,
+        OptEncrypted = 2,
+        OptChecksum = 4,
+        OptCompressed = 8,
+    };
+
+    bool init() { return true; }
+    void deinit() {}
+
+    UInt8 *read(const char *, UInt32 &size, UInt8) {
+        if (!hostNVRAM.present) { return nullptr; }
+        auto *buf = Buffer::create<UInt8>(hostNVRAM.size);
+        if (!buf) { return nullptr; }
+        memcpy(buf, hostNVRAM.data, hostNVRAM.size);
+        size = hostNVRAM.size;
+        return buf;
+    }
+
+    bool write(const char *, const UInt8 *src, UInt32 size, UInt8) {
+        if (size > sizeof(hostNVRAM.data)) { return false; }
+        memcpy(hostNVRAM.data, src, size);
+        hostNVRAM.size = size;
+        hostNVRAM.present = true;
+        hostNVRAM.writes += 1;
+        return true;
+    }
+};
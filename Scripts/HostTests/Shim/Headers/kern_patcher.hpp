@@ -0,0 +1,177 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+// The parts of Lilu's `KernelPatcher` the host tests need. Pattern searches and lookup patches follow Lilu's own
+// implementation, as they are the reference the optimised paths are compared with. Symbols are solved from
+// `hostSymbols`, set by the test; routing only records the request.
+
+#pragma once
+#include <Headers/kern_util.hpp>
+
+struct MachInfo {
+    static inline size_t writeWindows = 0;
+    static inline bool writing = false;
+
+    static kern_return_t setKernelWriting(bool enable, void *) {
+        if (enable == writing) { return KERN_FAILURE; }
+        writing = enable;
+        if (enable) { writeWindows += 1; }
+        return KERN_SUCCESS;
+    }
+};
+
+class KernelPatcher {
+    public:
+    enum class Error {
+        NoError,
+        NoKinfoFound,
+        MemoryIssue,
+    };
+
+    static inline void *kernelWriteLock = nullptr;
+    static constexpr size_t KernelID = 0;
+
+    struct KextInfo {
+        static constexpr size_t Unloaded = static_cast<size_t>(-1);
+
+        const char *id;
+        const char **paths;
+        size_t pathNum;
+        bool sys[2];
+        bool user[2];
+        size_t loadIndex;
+    };
+
+    struct SolveRequest {
+        const char *symbol {nullptr};
+        mach_vm_address_t *address {nullptr};
+
+        template<typename T>
+        SolveRequest(const char *s, T &addr) : symbol {s}, address {reinterpret_cast<mach_vm_address_t *>(&addr)} {}
+    };
+
+    struct RouteRequest {
+        const char *symbol {nullptr};
+        mach_vm_address_t to {0};
+        mach_vm_address_t *org {nullptr};
+
+        RouteRequest() = default;
+
+        template<typename T>
+        RouteRequest(const char *s, T t, mach_vm_address_t &o)
+            : symbol {s}, to {reinterpret_cast<mach_vm_address_t>(t)}, org {&o} {}
+
+        template<typename T, typename O>
+        RouteRequest(const char *s, T t, O &o)
+            : symbol {s}, to {reinterpret_cast<mach_vm_address_t>(t)},
+              org {reinterpret_cast<mach_vm_address_t *>(&o)} {}
+
+        template<typename T>
+        RouteRequest(const char *s, T t) : symbol {s}, to {reinterpret_cast<mach_vm_address_t>(t)} {}
+    };
+
+    struct LookupPatch {
+        KextInfo *kext;
+        const UInt8 *find;
+        const UInt8 *replace;
+        size_t size;
+        size_t count;
+    };
+
+    // Resolves a symbol of the image being patched to its address, or 0.
+    static inline mach_vm_address_t (*hostSymbols)(const char *symbol) = nullptr;
+
+    Error getError() { return this->error; }
+    void clearError() { this->error = Error::NoError; }
+
+    mach_vm_address_t solveSymbol(size_t, const char *symbol) {
+        auto ret = hostSymbols ? hostSymbols(symbol) : 0;
+        if (!ret) { this->error = Error::NoKinfoFound; }
+        return ret;
+    }
+
+    mach_vm_address_t solveSymbol(size_t id, const char *symbol, mach_vm_address_t, size_t, bool = false) {
+        return this->solveSymbol(id, symbol);
+    }
+
+    bool routeMultiple(size_t id, RouteRequest *requests, size_t num, mach_vm_address_t = 0, size_t = 0,
+        bool = true, bool = false) {
+        for (size_t i = 0; i < num; i++) {
+            auto from = this->solveSymbol(id, requests[i].symbol);
+            if (!from) { return false; }
+            if (requests[i].org) { *requests[i].org = from; }
+        }
+        return true;
+    }
+
+    bool routeMultipleLong(size_t id, RouteRequest *requests, size_t num, mach_vm_address_t address = 0,
+        size_t size = 0, bool kernelRoute = true, bool force = false) {
+        return this->routeMultiple(id, requests, num, address, size, kernelRoute, force);
+    }
+
+    mach_vm_address_t routeFunction(mach_vm_address_t from, mach_vm_address_t, bool = false, bool = true,
+        bool = false) {
+        return from;
+    }
+
+    void applyLookupPatch(const LookupPatch *patch, UInt8 *startingAddress, size_t maxSize) {
+        size_t changes = 0;
+        for (size_t i = 0; i + patch->size <= maxSize; i++) {
+            if (memcmp(startingAddress + i, patch->find, patch->size)) { continue; }
+            memcpy(startingAddress + i, patch->replace, patch->size);
+            changes += 1;
+            if (changes == patch->count) { break; }
+        }
+        if (changes != patch->count) { this->error = Error::MemoryIssue; }
+    }
+
+    static bool findPattern(const void *pattern, const void *patternMask, size_t patternSize, const void *data,
+        size_t dataSize, size_t *dataOffset) {
+        auto *pattern8 = static_cast<const UInt8 *>(pattern);
+        auto *mask8 = static_cast<const UInt8 *>(patternMask);
+        auto *data8 = static_cast<const UInt8 *>(data);
+        if (!patternSize || dataSize < patternSize) { return false; }
+        for (size_t i = *dataOffset; i <= dataSize - patternSize; i++) {
+            size_t j = 0;
+            for (; j < patternSize; j++) {
+                UInt8 mask = mask8 ? mask8[j] : 0xFF;
+                if ((data8[i + j] & mask) != (pattern8[j] & mask)) { break; }
+            }
+            if (j == patternSize) {
+                *dataOffset = i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool findAndReplaceWithMask(void *data, size_t dataSize, const void *find, size_t findSize,
+        const void *findMask, size_t, const void *replace, size_t replaceSize, const void *replaceMask, size_t,
+        size_t count, size_t skip) {
+        auto *data8 = static_cast<UInt8 *>(data);
+        auto *replace8 = static_cast<const UInt8 *>(replace);
+        auto *replaceMask8 = static_cast<const UInt8 *>(replaceMask);
+        size_t offset = 0, replaced = 0;
+        while (findPattern(find, findMask, findSize, data, dataSize, &offset)) {
+            if (skip) {
+                skip -= 1;
+                offset += findSize;
+                continue;
+            }
+            if (replaceMask8) {
+                for (size_t i = 0; i < findSize; i++) {
+                    data8[offset + i] = (data8[offset + i] & ~replaceMask8[i]) | (replace8[i] & replaceMask8[i]);
+                }
+            } else {
+                memcpy(data8 + offset, replace8, replaceSize);
+            }
+            replaced += 1;
+            offset += replaceSize;
+            if (count && replaced == count) { break; }
+        }
+        return replaced > 0;
+    }
+
+    private:
+    Error error {Error::NoError};
+};
@@ -0,0 +1,186 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+// The parts of Lilu's kern_util.hpp the host tests need. A panic throws `HostPanic`, so a test can check for one.
+
+#pragma once
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+using UInt8 = uint8_t;
+using UInt16 = uint16_t;
+using UInt32 = uint32_t;
+using UInt64 = unsigned long long;
+using SInt8 = int8_t;
+using SInt16 = int16_t;
+using SInt32 = int32_t;
+using SInt64 = long long;
+// As on Darwin, so the format strings of the sources match.
+using mach_vm_address_t = unsigned long long;
+using vm_address_t = uintptr_t;
+using vm_offset_t = uintptr_t;
+using vm_size_t = uintptr_t;
+using kern_return_t = int;
+
+#define KERN_SUCCESS 0
+#define KERN_FAILURE 5
+#ifndef PAGE_SIZE
+#define PAGE_SIZE 4096
+#endif
+
+enum KernelVersion {
+    Unsupported = 0,
+    Catalina = 19,
+    BigSur = 20,
+    Monterey = 21,
+    Ventura = 22,
+    Sonoma = 23,
+    Sequoia = 24,
+};
+using KernelMinor = int;
+
+// Silenced by `hostQuiet`, so benchmarks do not measure the terminal.
+inline bool hostQuiet = false;
+
+// Not checked as a printf format, like Lilu's logging.
+inline void hostLog(const char *format, ...) {
+    if (hostQuiet) { return; }
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+#define SYSLOG(module, str, ...) hostLog("%s: " str "\n", module __VA_OPT__(, ) __VA_ARGS__)
+#define DBGLOG SYSLOG
+#define SYSLOG_COND(cond, module, str, ...)                                  \
+    do {                                                                     \
+        if (cond) { SYSLOG(module, str __VA_OPT__(, ) __VA_ARGS__); } \
+    } while (0)
+#define DBGLOG_COND SYSLOG_COND
+
+struct HostPanic {
+    char message[256];
+};
+
+#define PANIC(module, str, ...)                                                              \
+    do {                                                                                     \
+        HostPanic panic {};                                                                  \
+        snprintf(panic.message, sizeof(panic.message), "%s: " str, module __VA_OPT__(, ) __VA_ARGS__); \
+        throw panic;                                                                         \
+    } while (0)
+#define PANIC_COND(cond, module, str, ...)                                  \
+    do {                                                                    \
+        if (cond) { PANIC(module, str __VA_OPT__(, ) __VA_ARGS__); } \
+    } while (0)
+
+#define LIKELY(x) __builtin_expect(!!(x), 1)
+#define UNLIKELY(x) __builtin_expect(!!(x), 0)
+
+#define lilu_os_memcpy memcpy
+#define lilu_os_memmove memmove
+#define lilu_os_strlen strlen
+
+template<typename T, size_t N>
+constexpr size_t arrsize(const T (&)[N]) {
+    return N;
+}
+
+inline const char *safeString(const char *str) { return str ? str : "(null)"; }
+
+template<typename T>
+inline T &getMember(void *that, size_t off) {
+    return *reinterpret_cast<T *>(static_cast<UInt8 *>(that) + off);
+}
+
+template<typename T>
+inline T FunctionCast(T, mach_vm_address_t org) {
+    return reinterpret_cast<T>(org);
+}
+
+namespace Buffer {
+    template<typename T>
+    inline T *create(size_t size) {
+        return static_cast<T *>(malloc(sizeof(T) * size));
+    }
+
+    template<typename T>
+    inline bool resize(T *&buf, size_t size) {
+        auto *nbuf = static_cast<T *>(realloc(buf, sizeof(T) * size));
+        if (!nbuf) { return false; }
+        buf = nbuf;
+        return true;
+    }
+
+    template<typename T>
+    inline void deleter(T *buf) {
+        free(buf);
+    }
+}    // namespace Buffer
+
+template<typename T>
+inline void emptyDeleter(T) {}
+
+template<typename T, void (*deleter)(T) = emptyDeleter<T>>
+class evector {
+    T *ptr {nullptr};
+    size_t cnt {0};
+    size_t rsvd {0};
+
+    public:
+    size_t size() const { return this->cnt; }
+    T *data() const { return this->ptr; }
+    T &operator[](size_t index) { return this->ptr[index]; }
+    const T &operator[](size_t index) const { return this->ptr[index]; }
+    T &last() { return this->ptr[this->cnt - 1]; }
+
+    bool push_back(T &element) {
+        if (this->cnt == this->rsvd) {
+            size_t rsvd = this->rsvd ? this->rsvd * 2 : 4;
+            if (!Buffer::resize(this->ptr, rsvd)) { return false; }
+            this->rsvd = rsvd;
+        }
+        this->ptr[this->cnt++] = element;
+        return true;
+    }
+
+    bool push_back(T &&element) { return this->push_back(element); }
+
+    void erase(size_t index, bool = true) {
+        deleter(this->ptr[index]);
+        memmove(this->ptr + index, this->ptr + index + 1, (this->cnt - index - 1) * sizeof(T));
+        this->cnt -= 1;
+    }
+
+    void deinit() {
+        for (size_t i = 0; i < this->cnt; i++) { deleter(this->ptr[i]); }
+        Buffer::deleter(this->ptr);
+        this->ptr = nullptr;
+        this->cnt = this->rsvd = 0;
+    }
+};
+
+// Boot arguments given to a test, as `name` or `name=value`.
+inline const char *hostBootArgs[16] {};
+
+inline const char *hostBootArg(const char *name) {
+    auto len = strlen(name);
+    for (auto *arg : hostBootArgs) {
+        if (arg && !strncmp(arg, name, len) && (arg[len] == '\0' || arg[len] == '=')) { return arg + len; }
+    }
+    return nullptr;
+}
+
+inline bool checkKernelArgument(const char *name) { return hostBootArg(name) != nullptr; }
+
+inline bool PE_parse_boot_argn(const char *name, void *value, int size) {
+    auto *arg = hostBootArg(name);
+    if (!arg || *arg != '=' || size != sizeof(UInt32)) { return false; }
+    *static_cast<UInt32 *>(value) = static_cast<UInt32>(strtoul(arg + 1, nullptr, 0));
+    return true;
+}
@@ -0,0 +1,25 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+// Delays spin and sleeps block, as in the kernel. `hostDelays` and `hostSleeps` count the calls, so a test can tell
+// how a wait was spent.
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <kern/clock.h>
+#include <thread>
+
+inline std::atomic<size_t> hostDelays {0};
+inline std::atomic<size_t> hostSleeps {0};
+
+inline void IODelay(unsigned int microseconds) {
+    hostDelays += 1;
+    const auto end = mach_absolute_time() + microseconds * NSEC_PER_USEC;
+    while (mach_absolute_time() < end) {}
+}
+
+inline void IOSleep(unsigned int milliseconds) {
+    hostSleeps += 1;
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
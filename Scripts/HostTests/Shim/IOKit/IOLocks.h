@@ -0,0 +1,64 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+// IOKit locks on top of the standard library. There are no interrupts on the host, so disabling them does nothing.
+
+#pragma once
+#include <IOKit/IOTypes.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+struct IOLock {
+    std::mutex mutex;
+};
+
+inline IOLock *IOLockAlloc() { return new IOLock; }
+inline void IOLockFree(IOLock *lock) { delete lock; }
+inline void IOLockLock(IOLock *lock) { lock->mutex.lock(); }
+inline void IOLockUnlock(IOLock *lock) { lock->mutex.unlock(); }
+
+struct IOSimpleLock {
+    std::atomic_flag flag = ATOMIC_FLAG_INIT;
+};
+using IOInterruptState = int;
+
+inline IOSimpleLock *IOSimpleLockAlloc() { return new IOSimpleLock; }
+inline void IOSimpleLockFree(IOSimpleLock *lock) { delete lock; }
+
+inline void IOSimpleLockLock(IOSimpleLock *lock) {
+    while (lock->flag.test_and_set(std::memory_order_acquire)) {}
+}
+
+inline void IOSimpleLockUnlock(IOSimpleLock *lock) { lock->flag.clear(std::memory_order_release); }
+
+inline IOInterruptState IOSimpleLockLockDisableInterrupt(IOSimpleLock *lock) {
+    IOSimpleLockLock(lock);
+    return 0;
+}
+
+inline void IOSimpleLockUnlockEnableInterrupt(IOSimpleLock *lock, IOInterruptState) { IOSimpleLockUnlock(lock); }
+
+struct IORecursiveLock {
+    std::recursive_mutex mutex;
+    std::atomic<std::thread::id> owner {};
+    size_t depth {0};
+};
+
+inline IORecursiveLock *IORecursiveLockAlloc() { return new IORecursiveLock; }
+inline void IORecursiveLockFree(IORecursiveLock *lock) { delete lock; }
+
+inline void IORecursiveLockLock(IORecursiveLock *lock) {
+    lock->mutex.lock();
+    lock->owner = std::this_thread::get_id();
+    lock->depth += 1;
+}
+
+inline void IORecursiveLockUnlock(IORecursiveLock *lock) {
+    if (--lock->depth == 0) { lock->owner = std::thread::id {}; }
+    lock->mutex.unlock();
+}
+
+inline bool IORecursiveLockHaveLock(const IORecursiveLock *lock) { return lock->owner == std::this_thread::get_id(); }
+
+inline bool ml_at_interrupt_context() { return false; }
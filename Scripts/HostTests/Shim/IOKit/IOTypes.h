@@ -0,0 +1,10 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+#pragma once
+#include <Headers/kern_util.hpp>
+
+using IOReturn = kern_return_t;
+using IOOptionBits = UInt32;
+
+#define kIOReturnSuccess KERN_SUCCESS
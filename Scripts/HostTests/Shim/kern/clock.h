@@ -0,0 +1,21 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+// Absolute time is in nanoseconds on the host.
+
+#pragma once
+#include <Headers/kern_util.hpp>
+#include <ctime>
+
+#define NSEC_PER_USEC 1000ULL
+#define NSEC_PER_MSEC 1000000ULL
+#define NSEC_PER_SEC 1000000000ULL
+
+inline UInt64 mach_absolute_time() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<UInt64>(ts.tv_sec) * NSEC_PER_SEC + static_cast<UInt64>(ts.tv_nsec);
+}
+
+inline void absolutetime_to_nanoseconds(UInt64 abstime, UInt64 *result) { *result = abstime; }
+inline void nanoseconds_to_absolutetime(UInt64 nanosecs, UInt64 *result) { *result = nanosecs; }
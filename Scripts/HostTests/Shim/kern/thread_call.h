@@ -0,0 +1,75 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+// Thread calls on host threads. As in xnu, entering a call that is pending does not queue it twice, while a running
+// call may be entered again. Delayed calls do not run on their own; `thread_call_run_delayed` runs the ones that are
+// pending, as if their deadline had passed, and `thread_call_join` waits for the threads a call was run on.
+// Calls are never freed, so `hostThreadCalls` lists every call allocated so far.
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using thread_call_param_t = void *;
+using thread_call_func_t = void (*)(thread_call_param_t param0, thread_call_param_t param1);
+
+struct thread_call {
+    thread_call_func_t func;
+    thread_call_param_t param0;
+    std::atomic<bool> pending {false};
+    std::atomic<bool> delayed {false};
+    UInt64 deadline {0};
+    size_t delayedEntries {0};
+    std::mutex mutex;
+    std::vector<std::thread> threads;
+};
+using thread_call_t = thread_call *;
+
+inline std::vector<thread_call_t> hostThreadCalls;
+
+inline thread_call_t thread_call_allocate(thread_call_func_t func, thread_call_param_t param0) {
+    auto *call = new thread_call;
+    call->func = func;
+    call->param0 = param0;
+    hostThreadCalls.push_back(call);
+    return call;
+}
+
+inline bool thread_call_enter(thread_call_t call) {
+    if (call->pending.exchange(true)) { return true; }
+    std::lock_guard<std::mutex> guard(call->mutex);
+    call->threads.emplace_back([call] {
+        call->pending = false;
+        call->func(call->param0, nullptr);
+    });
+    return false;
+}
+
+inline bool thread_call_enter_delayed(thread_call_t call, UInt64 deadline) {
+    std::lock_guard<std::mutex> guard(call->mutex);
+    call->deadline = deadline;
+    call->delayedEntries += 1;
+    return call->delayed.exchange(true);
+}
+
+inline bool thread_call_run_delayed(thread_call_t call) {
+    if (!call->delayed.exchange(false)) { return false; }
+    call->func(call->param0, nullptr);
+    return true;
+}
+
+// Returns how many calls ran.
+inline size_t thread_call_run_delayed() {
+    size_t ran = 0;
+    for (auto *call : hostThreadCalls) { ran += thread_call_run_delayed(call); }
+    return ran;
+}
+
+inline void thread_call_join(thread_call_t call) {
+    std::lock_guard<std::mutex> guard(call->mutex);
+    for (auto &thread : call->threads) { thread.join(); }
+    call->threads.clear();
+}
@@ -0,0 +1,100 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+// The libkern containers the host tests need, reference counted as in the kernel. A dictionary holds the objects it is
+// given, so a test can inspect a published property after the sources released it.
+
+#pragma once
+#include <Headers/kern_util.hpp>
+#include <map>
+#include <string>
+
+class OSObject {
+    int refs {1};
+
+    protected:
+    virtual ~OSObject() {}
+
+    public:
+    void retain() { this->refs += 1; }
+    void release() {
+        if (--this->refs == 0) { delete this; }
+    }
+};
+
+#define OSSafeReleaseNULL(obj) \
+    do {                       \
+        if (obj) {             \
+            (obj)->release();  \
+            (obj) = nullptr;   \
+        }                      \
+    } while (0)
+
+class OSNumber : public OSObject {
+    UInt64 value {0};
+
+    public:
+    static OSNumber *withNumber(UInt64 value, unsigned int) {
+        auto *number = new OSNumber;
+        number->value = value;
+        return number;
+    }
+
+    UInt64 unsigned64BitValue() const { return this->value; }
+};
+
+class OSData : public OSObject {
+    void *bytes {nullptr};
+    unsigned int length {0};
+    bool owned {false};
+
+    protected:
+    ~OSData() override {
+        if (this->owned) { free(this->bytes); }
+    }
+
+    public:
+    static OSData *withBytes(const void *bytes, unsigned int length) {
+        auto *data = new OSData;
+        data->bytes = malloc(length);
+        data->length = length;
+        data->owned = true;
+        memcpy(data->bytes, bytes, length);
+        return data;
+    }
+
+    static OSData *withBytesNoCopy(void *bytes, unsigned int length) {
+        auto *data = new OSData;
+        data->bytes = bytes;
+        data->length = length;
+        return data;
+    }
+
+    const void *getBytesNoCopy() const { return this->bytes; }
+    unsigned int getLength() const { return this->length; }
+};
+
+class OSDictionary : public OSObject {
+    std::map<std::string, OSObject *> objects;
+
+    protected:
+    ~OSDictionary() override {
+        for (auto &[key, object] : this->objects) { object->release(); }
+    }
+
+    public:
+    static OSDictionary *withCapacity(unsigned int) { return new OSDictionary; }
+
+    bool setObject(const char *key, OSObject *object) {
+        object->retain();
+        auto &slot = this->objects[key];
+        if (slot) { slot->release(); }
+        slot = object;
+        return true;
+    }
+
+    OSObject *getObject(const char *key) const {
+        auto it = this->objects.find(key);
+        return it == this->objects.end() ? nullptr : it->second;
+    }
+};
@@ -0,0 +1,13 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+// Only the types; a test casting objects supplies its own `safeMetaCast`.
+
+#pragma once
+
+class OSMetaClassBase {
+    public:
+    virtual ~OSMetaClassBase() {}
+};
+
+class OSMetaClass : public OSMetaClassBase {};
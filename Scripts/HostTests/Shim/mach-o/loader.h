@@ -0,0 +1,79 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+// The Mach-O definitions NootedRed uses, for hosts without the Darwin headers.
+
+#pragma once
+#include <cstdint>
+
+struct mach_header_64 {
+    uint32_t magic;
+    int32_t cputype;
+    int32_t cpusubtype;
+    uint32_t filetype;
+    uint32_t ncmds;
+    uint32_t sizeofcmds;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+struct load_command {
+    uint32_t cmd;
+    uint32_t cmdsize;
+};
+
+struct segment_command_64 {
+    uint32_t cmd;
+    uint32_t cmdsize;
+    char segname[16];
+    UInt64 vmaddr;
+    UInt64 vmsize;
+    UInt64 fileoff;
+    UInt64 filesize;
+    int32_t maxprot;
+    int32_t initprot;
+    uint32_t nsects;
+    uint32_t flags;
+};
+
+struct section_64 {
+    char sectname[16];
+    char segname[16];
+    UInt64 addr;
+    UInt64 size;
+    uint32_t offset;
+    uint32_t align;
+    uint32_t reloff;
+    uint32_t nreloc;
+    uint32_t flags;
+    uint32_t reserved1;
+    uint32_t reserved2;
+    uint32_t reserved3;
+};
+
+struct uuid_command {
+    uint32_t cmd;
+    uint32_t cmdsize;
+    uint8_t uuid[16];
+};
+
+struct symtab_command {
+    uint32_t cmd;
+    uint32_t cmdsize;
+    uint32_t symoff;
+    uint32_t nsyms;
+    uint32_t stroff;
+    uint32_t strsize;
+};
+
+#define MH_MAGIC_64 0xFEEDFACF
+#define LC_SEGMENT_64 0x19
+#define LC_UUID 0x1B
+#define LC_SYMTAB 0x2
+#define SECTION_TYPE 0x000000FF
+#define S_ZEROFILL 0x1
+#define S_GB_ZEROFILL 0xC
+#define S_THREAD_LOCAL_ZEROFILL 0x12
+#define S_ATTR_PURE_INSTRUCTIONS 0x80000000
+#define S_ATTR_SOME_INSTRUCTIONS 0x00000400
+#define SEG_LINKEDIT "__LINKEDIT"
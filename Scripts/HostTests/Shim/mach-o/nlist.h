@@ -0,0 +1,20 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+#pragma once
+#include <cstdint>
+
+struct nlist_64 {
+    union {
+        uint32_t n_strx;
+    } n_un;
+    uint8_t n_type;
+    uint8_t n_sect;
+    uint16_t n_desc;
+    UInt64 n_value;
+};
+
+#define N_STAB 0xE0
+#define N_TYPE 0x0E
+#define N_SECT 0xE
+#define N_EXT 0x01
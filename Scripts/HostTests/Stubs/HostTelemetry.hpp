@@ -0,0 +1,11 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+// `PatchTelemetry` without the IGPU: records are kept here for the test to inspect.
+
+#pragma once
+#include <PrivateHeaders/PatchTelemetry.hpp>
+#include <vector>
+
+inline std::vector<PatchTelemetryRecord> hostTelemetry;
+inline const char *hostTelemetryKexts[64] {};
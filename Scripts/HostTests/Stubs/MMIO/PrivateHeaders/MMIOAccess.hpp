@@ -0,0 +1,74 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+// A simulated register BAR behind `MMIO`, which is to be mapped at `hostBAR.slots`. The first `DirectRegs` registers
+// are in the BAR, and `mmPCIE_INDEX2/DATA2` reach all of them. A register can be set to read as 0 until a deadline, as
+// one the firmware sets later would. Every access is counted, and so is a torn pair: a data access from another
+// thread than the one that wrote the index.
+
+#pragma once
+#include <IOKit/IOTypes.h>
+#include <PrivateHeaders/iVega/Regs/NBIO.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <kern/clock.h>
+#include <thread>
+
+struct HostBAR {
+    static constexpr UInt32 DirectRegs = 0x400;
+    static constexpr UInt32 Regs = 0x20000;
+
+    volatile UInt32 slots[DirectRegs] {};    // Only its address is used.
+    std::atomic<UInt32> values[Regs] {};
+    std::atomic<UInt64> readyAt[Regs] {};    // `mach_absolute_time` from which the value reads back; 0 for always.
+    std::atomic<UInt32> index {0};
+    std::atomic<std::thread::id> indexOwner {};
+    std::atomic<size_t> reads {0};
+    std::atomic<size_t> writes {0};
+    std::atomic<size_t> indexWrites {0};
+    std::atomic<size_t> torn {0};
+
+    UInt32 indexed() {
+        if (this->indexOwner != std::this_thread::get_id()) { this->torn += 1; }
+        return this->index;
+    }
+
+    static UInt32 checked(UInt32 reg) {
+        if (reg >= Regs) { abort(); }
+        return reg;
+    }
+
+    // The deadline is stored first and loaded last, so the new value is never read before it.
+    void setLater(UInt32 reg, UInt32 value, UInt64 usec) {
+        this->readyAt[checked(reg)] = mach_absolute_time() + usec * NSEC_PER_USEC;
+        this->values[reg] = value;
+    }
+
+    UInt32 get(UInt32 reg) const {
+        const UInt32 value = this->values[checked(reg)];
+        return mach_absolute_time() < this->readyAt[reg] ? 0 : value;
+    }
+
+    void set(UInt32 reg, UInt32 value) {
+        this->readyAt[checked(reg)] = 0;
+        this->values[reg] = value;
+    }
+};
+
+inline HostBAR hostBAR {};
+
+inline UInt32 mmioRead32(volatile UInt32 *, UInt32 slot) {
+    hostBAR.reads += 1;
+    return hostBAR.get(slot == mmPCIE_DATA2 ? hostBAR.indexed() : slot);
+}
+
+inline void mmioWrite32(volatile UInt32 *, UInt32 slot, UInt32 val) {
+    hostBAR.writes += 1;
+    if (slot == mmPCIE_INDEX2) {
+        hostBAR.indexWrites += 1;
+        hostBAR.indexOwner = std::this_thread::get_id();
+        hostBAR.index = val;
+    } else {
+        hostBAR.set(slot == mmPCIE_DATA2 ? hostBAR.indexed() : slot, val);
+    }
+}
@@ -0,0 +1,104 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+// `NRed` with a simulated MP1 mailbox in place of the registers, checking the protocol the SMU module must follow:
+// `C2PMSG_82` and `C2PMSG_90` are only written while the firmware is idle, and `C2PMSG_66` only once `C2PMSG_90` was
+// cleared. The firmware answers `msg * 31 + param` after `latencyUsec`, from a thread of its own unless that is 0,
+// and the version for `GetSmuVersion`. Properties are kept in `properties` for the test to inspect.
+
+#pragma once
+#include <Headers/kern_util.hpp>
+#include <PrivateHeaders/GPUDriversAMD/CAIL/Result.hpp>
+#include <PrivateHeaders/iVega/IPOffset.hpp>
+#include <PrivateHeaders/iVega/Regs/SMU.hpp>
+#include <PrivateHeaders/iVega/RenoirPPSMC.hpp>
+#include <atomic>
+#include <chrono>
+#include <libkern/c++/OSContainers.h>
+#include <thread>
+
+class NRed {
+    std::atomic<UInt32> argument {0};
+    std::atomic<UInt32> response {kSMUFWResponseSuccess};
+    std::atomic<bool> busy {false};
+
+    void answer(UInt32 msg, UInt32 param) {
+        this->argument = msg == PPSMC_MSG_GetSmuVersion ? this->version : msg * 31 + param;
+        this->busy = false;
+        const auto unknown = msg < 64 && (this->unknownMessages & (1ULL << msg)) != 0;
+        this->response = unknown ? kSMUFWResponseUnknownCommand : kSMUFWResponseSuccess;
+    }
+
+    public:
+    UInt32 latencyUsec {0};
+    UInt32 version {0x2E1200};
+    UInt64 unknownMessages {0};    // Bit per message ID answered with "unknown command".
+    std::atomic<int> violations {0};
+    std::atomic<int> sent[256] {};    // By the low byte of the message.
+    OSDictionary *properties {OSDictionary::withCapacity(0)};
+
+    static NRed &singleton() {
+        static NRed instance {};
+        return instance;
+    }
+
+    void setProp32(const char *key, UInt32 value) { setNumber(this->properties, key, value); }
+    void setProp(const char *key, OSObject *value) { this->properties->setObject(key, value); }
+
+    static void setNumber(OSDictionary *dict, const char *key, UInt64 value) {
+        auto *number = OSNumber::withNumber(value, 64);
+        dict->setObject(key, number);
+        number->release();
+    }
+
+    UInt32 readReg32(UInt32 reg) const {
+        switch (reg - MP_BASE) {
+            case mmMP1_SMN_C2PMSG_82:
+                return this->argument;
+            case mmMP1_SMN_C2PMSG_90:
+                return this->response;
+            default:
+                return 0;
+        }
+    }
+
+    void writeReg32(UInt32 reg, UInt32 val) {
+        switch (reg - MP_BASE) {
+            case mmMP1_SMN_C2PMSG_82:
+                if (this->busy) { this->violations += 1; }
+                this->argument = val;
+                break;
+            case mmMP1_SMN_C2PMSG_90:
+                if (this->busy) { this->violations += 1; }
+                this->response = val;
+                break;
+            case mmMP1_SMN_C2PMSG_66: {
+                if (this->busy.exchange(true) || this->response != 0) { this->violations += 1; }
+                this->sent[val & 0xFF] += 1;
+                const UInt32 param = this->argument;
+                if (this->latencyUsec == 0) {
+                    this->answer(val, param);
+                    break;
+                }
+                std::thread([this, val, param] {
+                    std::this_thread::sleep_for(std::chrono::microseconds(this->latencyUsec));
+                    this->answer(val, param);
+                }).detach();
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // Gives up after a second, so a lost answer fails the test rather than hanging it.
+    UInt32 waitForReg32(UInt32 reg, UInt32 mask, UInt32 = 0) const {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        UInt32 val;
+        while (((val = this->readReg32(reg)) & mask) == 0) {
+            if (std::chrono::steady_clock::now() > deadline) { return val; }
+            std::this_thread::yield();
+        }
+        return val;
+    }
+};
@@ -0,0 +1,20 @@
+// Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+// See LICENSE for details.
+
+#include "HostTelemetry.hpp"
+
+static PatchTelemetry instance {};
+
+PatchTelemetry &PatchTelemetry::singleton() { return instance; }
+
+PatchTelemetry::Scope PatchTelemetry::begin() const { return {0, this->bytesScanned}; }
+
+void PatchTelemetry::record(const Scope &scope, size_t kext, PatchKind kind, PatchMethod method, UInt32 key,
+    size_t matches) {
+    hostTelemetry.push_back({key, static_cast<UInt32>(matches),
+        static_cast<UInt32>(this->bytesScanned - scope.bytesScanned), 0, static_cast<UInt16>(kext), kind, method});
+}
+
+void PatchTelemetry::nameKext(size_t kext, const char *name) {
+    if (kext < arrsize(hostTelemetryKexts)) { hostTelemetryKexts[kext] = name; }
+}
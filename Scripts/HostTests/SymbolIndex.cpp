@@ -0,0 +1,192 @@
+// Sources: NootedRed/PatcherPlus.cpp NootedRed/OffsetCache.cpp Scripts/HostTests/Stubs/PatchTelemetry.cpp
+//
+// `PatcherPlus::lookupSymbol` must solve every symbol the modules ask for exactly as a linear walk of the nlist table
+// does, as Lilu's `solveSymbol` did, and find nothing for undefined, debugging or missing symbols. The table is as
+// large as the one of AMDRadeonX5000HWLibs, with the names solved by the sources among names mangled the same way.
+// Also times solving them all through the index, built and freed as for one kext, against the linear walk, and a
+// solve once the index is built.
+
+#include <PrivateHeaders/PatcherPlus.hpp>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mach-o/loader.h>
+#include <mach-o/nlist.h>
+#include <random>
+#include <regex>
+#include <set>
+#include <string>
+#include <vector>
+
+#define CHECK(cond)                                        \
+    do {                                                   \
+        if (!(cond)) {                                     \
+            printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            return 1;                                      \
+        }                                                  \
+    } while (0)
+
+static constexpr size_t SymbolCount = 40000;
+static constexpr UInt64 Base = 0x10000;
+static constexpr size_t TextSize = 0x100000;
+
+// The mangled names in the sources.
+static std::vector<std::string> solvedNames() {
+    std::string source = __FILE__;
+    auto dir = std::filesystem::path(source.substr(0, source.rfind("Scripts/"))) / "NootedRed";
+    std::set<std::string> names;
+    std::regex mangled("\"(__Z[A-Za-z0-9_]+)\"");
+    for (auto &entry : std::filesystem::recursive_directory_iterator(dir)) {
+        if (entry.path().extension() != ".cpp") { continue; }
+        std::ifstream file(entry.path());
+        std::string text {std::istreambuf_iterator<char>(file), {}};
+        for (std::sregex_iterator it(text.begin(), text.end(), mangled), end; it != end; ++it) {
+            names.insert((*it)[1]);
+        }
+    }
+    return {names.begin(), names.end()};
+}
+
+struct Image {
+    std::vector<UInt8> bytes;
+    const nlist_64 *symbols;
+    const char *strings;
+    UInt32 count;
+
+    mach_vm_address_t address() const { return reinterpret_cast<mach_vm_address_t>(this->bytes.data()); }
+};
+
+// __TEXT, then __LINKEDIT with the symbol and string tables, as in a kext of the kernel collection.
+static Image buildImage(const std::vector<std::string> &solved) {
+    std::mt19937 rng(1);
+    static const char *const classes[] = {"AMDRadeonX5000_AMDHardware", "AMDRadeonX6000_AMDHWDisplay",
+        "AMDRadeonX5000_AMDGraphicsAccelerator", "AMDRadeonX6000_AMDAccelChannel", "AMDRadeonX5000_AMDHWChannel"};
+    static const char *const methods[] = {"initialize", "getHWEngine", "submitCommandBuffer", "allocateResource",
+        "dumpASICHangState", "configureDisplay", "getScheduler", "updateUtilizationStatisticsCounter"};
+
+    std::vector<nlist_64> symbols;
+    std::string strings(1, '\0');
+    auto add = [&](const std::string &name, UInt8 type) {
+        nlist_64 sym {};
+        sym.n_un.n_strx = static_cast<UInt32>(strings.size());
+        sym.n_type = type;
+        sym.n_sect = 1;
+        sym.n_value = Base + 0x1000 + (rng() % (TextSize - 0x1000));
+        symbols.push_back(sym);
+        strings += name;
+        strings += '\0';
+    };
+    for (size_t i = symbols.size(); symbols.size() < SymbolCount - solved.size(); i++) {
+        std::string cls = classes[rng() % arrsize(classes)], method = methods[rng() % arrsize(methods)];
+        method += std::to_string(i);
+        add("__ZN" + std::to_string(cls.size()) + cls + std::to_string(method.size()) + method + "Ev",
+            (i % 16) ? N_SECT | N_EXT : N_STAB);
+    }
+    // Spread over the table, rather than all at its end.
+    for (size_t i = 0; i < solved.size(); i++) {
+        add(solved[i], N_SECT | N_EXT);
+        std::swap(symbols.back(), symbols[rng() % symbols.size()]);
+    }
+    add("__ZN14AMDRadeonX500011undefinedEv", N_EXT);
+
+    auto linkeditOff = TextSize;
+    auto symOff = linkeditOff;
+    auto strOff = symOff + symbols.size() * sizeof(nlist_64);
+    Image image {};
+    image.bytes.resize(strOff + strings.size());
+
+    auto *mh = reinterpret_cast<mach_header_64 *>(image.bytes.data());
+    mh->magic = MH_MAGIC_64;
+    mh->ncmds = 3;
+    auto *text = reinterpret_cast<segment_command_64 *>(mh + 1);
+    text->cmd = LC_SEGMENT_64;
+    text->cmdsize = sizeof(segment_command_64);
+    strcpy(text->segname, "__TEXT");
+    text->vmaddr = Base;
+    text->filesize = TextSize;
+    auto *linkedit = text + 1;
+    linkedit->cmd = LC_SEGMENT_64;
+    linkedit->cmdsize = sizeof(segment_command_64);
+    strcpy(linkedit->segname, SEG_LINKEDIT);
+    linkedit->vmaddr = Base + linkeditOff;
+    linkedit->fileoff = 0x40000000;    // Offsets within the collection, not the image.
+    linkedit->filesize = image.bytes.size() - linkeditOff;
+    auto *symtab = reinterpret_cast<symtab_command *>(linkedit + 1);
+    symtab->cmd = LC_SYMTAB;
+    symtab->cmdsize = sizeof(symtab_command);
+    symtab->symoff = static_cast<UInt32>(linkedit->fileoff + (symOff - linkeditOff));
+    symtab->nsyms = static_cast<UInt32>(symbols.size());
+    symtab->stroff = static_cast<UInt32>(linkedit->fileoff + (strOff - linkeditOff));
+    symtab->strsize = static_cast<UInt32>(strings.size());
+    mh->sizeofcmds = 2 * sizeof(segment_command_64) + sizeof(symtab_command);
+
+    memcpy(image.bytes.data() + symOff, symbols.data(), symbols.size() * sizeof(nlist_64));
+    memcpy(image.bytes.data() + strOff, strings.data(), strings.size());
+    image.symbols = reinterpret_cast<const nlist_64 *>(image.bytes.data() + symOff);
+    image.strings = reinterpret_cast<const char *>(image.bytes.data() + strOff);
+    image.count = symtab->nsyms;
+    return image;
+}
+
+// Lilu's `solveSymbol`: every symbol is compared by name, in table order.
+static mach_vm_address_t linearSolve(const Image &image, const char *symbol) {
+    for (UInt32 i = 0; i < image.count; i++) {
+        auto &sym = image.symbols[i];
+        if ((sym.n_type & N_STAB) || (sym.n_type & N_TYPE) != N_SECT) { continue; }
+        if (!strcmp(image.strings + sym.n_un.n_strx, symbol)) { return image.address() + (sym.n_value - Base); }
+    }
+    return 0;
+}
+
+static mach_vm_address_t indexSolve(const Image &image, const char *symbol) {
+    return PatcherPlus::lookupSymbol(symbol, PatcherPlus::symbolHash(symbol), image.address(), image.bytes.size());
+}
+
+int main() {
+    hostQuiet = true;
+    auto solved = solvedNames();
+    CHECK(solved.size() > 50);
+    auto image = buildImage(solved);
+
+    for (auto &name : solved) {
+        auto address = linearSolve(image, name.c_str());
+        CHECK(address != 0 && indexSolve(image, name.c_str()) == address);
+    }
+    static const char undefined[] = "__ZN14AMDRadeonX500011undefinedEv";
+    CHECK(!indexSolve(image, undefined) && !linearSolve(image, undefined));
+    CHECK(!indexSolve(image, "__ZN27AMDRadeonX5000_AMDHardware7missingEv"));
+    CHECK(!indexSolve(image, (solved[0] + "x").c_str()));
+    PatcherPlus::releaseSymbolIndex();
+
+    static constexpr int Rounds = 20;
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < Rounds; round++) {
+        for (auto &name : solved) { sink += linearSolve(image, name.c_str()); }
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (int round = 0; round < Rounds; round++) {
+        for (auto &name : solved) { sink += indexSolve(image, name.c_str()); }
+        PatcherPlus::releaseSymbolIndex();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    // Once built, a solve is a hash probe and one `strcmp`.
+    indexSolve(image, solved[0].c_str());
+    auto built = std::chrono::steady_clock::now();
+    for (int round = 0; round < Rounds * 100; round++) {
+        for (auto &name : solved) { sink += indexSolve(image, name.c_str()); }
+    }
+    auto solvedEnd = std::chrono::steady_clock::now();
+    PatcherPlus::releaseSymbolIndex();
+
+    const double solves = static_cast<double>(Rounds) * solved.size();
+    auto linearUs = std::chrono::duration<double, std::micro>(middle - start).count() / Rounds;
+    auto indexUs = std::chrono::duration<double, std::micro>(end - middle).count() / Rounds;
+    auto probeNs = std::chrono::duration<double, std::nano>(solvedEnd - built).count() / (solves * 100);
+    printf("Benchmark: %zu symbols from %u: linear %.0f us (%.0f ns each), index %.0f us with its build (%.1fx), "
+           "%.0f ns per solve once built\n",
+        solved.size(), image.count, linearUs, linearUs * 1000 * Rounds / solves, indexUs, linearUs / indexUs, probeNs);
+    return sink == 0;
+}
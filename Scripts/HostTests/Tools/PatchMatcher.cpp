@@ -0,0 +1,428 @@
+// Sources: NootedRed/PatcherPlus.cpp NootedRed/OffsetCache.cpp Scripts/HostTests/Stubs/PatchTelemetry.cpp
+//
+// Runs patch requests against kext binaries with the PatcherPlus the kext is built from, for ValidatePatches.py.
+// Commands are read one per line; each prints one line, with tab separated fields.
+//   attributes <kernel major> <kernel minor> <device ID> <device revision> <PCI revision>
+//       The names of the `NRedAttributes` that are set.
+//   kext <path>
+//       Makes the x86_64 slice of a kext binary the image the next requests apply to, loading it the first time, so
+//       that the lookup patches of each kext stay applied; prints `OK` or an error.
+//   solve|route <section> <symbol> <pattern> <mask>
+//   lookup <section> <find> <find mask> <replace> <replace mask> <count> <skip>
+//       Status (OK, WARN or FAIL), expected, found, bytes scanned, nanoseconds and notes separated by `; `.
+// Byte strings are in hex, `-` for none. Each image is loaded twice: as it is, and with its symbol table hidden, to
+// check the patterns the stripped kexts are patched with. Lookup patches are applied to both, in the order given.
+
+#include "../Stubs/HostTelemetry.hpp"
+#include <PrivateHeaders/NRedAttributes.hpp>
+#include <PrivateHeaders/PatcherPlus.hpp>
+#include <chrono>
+#include <iostream>
+#include <mach-o/loader.h>
+#include <mach-o/nlist.h>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using Bytes = std::vector<UInt8>;
+
+struct Image {
+    UInt8 *data {nullptr};
+    size_t size {0};
+    std::unordered_map<std::string, size_t> symbols {};
+
+    mach_vm_address_t address() const { return reinterpret_cast<mach_vm_address_t>(this->data); }
+};
+
+struct Kext {
+    Image full {}, stripped {};
+};
+
+static std::unordered_map<std::string, Kext> kexts {};
+static Image *full = nullptr, *stripped = nullptr;
+static const Image *current = nullptr;
+
+static mach_vm_address_t solveHostSymbol(const char *symbol) {
+    if (current != full) { return 0; }
+    auto it = full->symbols.find(symbol);
+    return it == full->symbols.end() ? 0 : full->address() + it->second;
+}
+
+template<typename T>
+static bool readAt(const Bytes &file, size_t off, T &out) {
+    if (off > file.size() || file.size() - off < sizeof(T)) { return false; }
+    memcpy(&out, file.data() + off, sizeof(T));
+    return true;
+}
+
+static UInt32 swap32(UInt32 v) { return __builtin_bswap32(v); }
+
+static const char *thin(Bytes &file) {
+    UInt32 magic = 0;
+    if (!readAt(file, 0, magic)) { return "empty file"; }
+    if (magic != 0xBEBAFECA) { return nullptr; }
+    UInt32 count = 0;
+    readAt(file, 4, count);
+    for (UInt32 i = 0; i < swap32(count); i++) {
+        UInt32 arch[5] {};
+        if (!readAt(file, 8 + i * sizeof(arch), arch)) { break; }
+        if (swap32(arch[0]) != 0x01000007) { continue; }
+        size_t offset = swap32(arch[2]), size = swap32(arch[3]);
+        if (offset > file.size() || file.size() - offset < size) { return "truncated x86_64 slice"; }
+        file = Bytes(file.begin() + offset, file.begin() + offset + size);
+        return nullptr;
+    }
+    return "no x86_64 slice";
+}
+
+// Maps the segments as they are laid out in memory, so `ImageSections` and the symbol index see a loaded kext.
+static const char *load(const char *path, Image &image, bool hideSymbols) {
+    FILE *f = fopen(path, "rb");
+    if (!f) { return "cannot be opened"; }
+    Bytes file;
+    UInt8 chunk[65536];
+    for (size_t n; (n = fread(chunk, 1, sizeof(chunk), f)) > 0;) { file.insert(file.end(), chunk, chunk + n); }
+    fclose(f);
+    if (auto *error = thin(file)) { return error; }
+
+    mach_header_64 mh {};
+    if (!readAt(file, 0, mh) || mh.magic != MH_MAGIC_64) { return "not a 64-bit Mach-O"; }
+    std::vector<segment_command_64> segments;
+    symtab_command symtab {};
+    size_t symtabOff = 0;
+    for (size_t i = 0, off = sizeof(mh); i < mh.ncmds; i++) {
+        load_command lc {};
+        if (!readAt(file, off, lc) || lc.cmdsize < sizeof(lc)) { return "malformed load commands"; }
+        if (lc.cmd == LC_SEGMENT_64) {
+            segment_command_64 seg {};
+            if (!readAt(file, off, seg)) { return "malformed segment"; }
+            segments.push_back(seg);
+        } else if (lc.cmd == LC_SYMTAB) {
+            if (!readAt(file, off, symtab)) { return "malformed symbol table"; }
+            symtabOff = off;
+        }
+        off += lc.cmdsize;
+    }
+
+    UInt64 base = 0, end = 0;
+    bool haveBase = false;
+    for (auto &seg : segments) {
+        if (seg.fileoff == 0 && seg.filesize && !haveBase) {
+            base = seg.vmaddr;
+            haveBase = true;
+        }
+        if (seg.vmaddr + seg.vmsize > end) { end = seg.vmaddr + seg.vmsize; }
+    }
+    if (!haveBase) { return "no segment maps the header"; }
+
+    image.size = end - base;
+    if (posix_memalign(reinterpret_cast<void **>(&image.data), PAGE_SIZE, image.size)) { return "out of memory"; }
+    memset(image.data, 0, image.size);
+    for (auto &seg : segments) {
+        if (seg.vmaddr < base || seg.fileoff > file.size() || file.size() - seg.fileoff < seg.filesize ||
+            seg.filesize > seg.vmsize) {
+            return "segment outside the file";
+        }
+        memcpy(image.data + (seg.vmaddr - base), file.data() + seg.fileoff, seg.filesize);
+    }
+
+    if (symtabOff && hideSymbols) {
+        auto *mapped = reinterpret_cast<symtab_command *>(image.data + symtabOff);
+        mapped->nsyms = 0;
+    } else if (symtabOff) {
+        for (UInt32 i = 0; i < symtab.nsyms; i++) {
+            nlist_64 sym {};
+            if (!readAt(file, symtab.symoff + i * sizeof(sym), sym)) { return "symbol table outside the file"; }
+            if ((sym.n_type & N_STAB) || !sym.n_value || sym.n_value < base) { continue; }
+            size_t strOff = symtab.stroff + sym.n_un.n_strx;
+            if (strOff >= file.size()) { continue; }
+            auto *name = reinterpret_cast<const char *>(file.data() + strOff);
+            image.symbols.emplace(std::string(name, strnlen(name, file.size() - strOff)), sym.n_value - base);
+        }
+    }
+    return nullptr;
+}
+
+static bool parseBytes(const std::string &hex, Bytes &out) {
+    out.clear();
+    if (hex == "-") { return true; }
+    if (hex.size() % 2) { return false; }
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        char *endp = nullptr;
+        auto byte = std::string(hex, i, 2);
+        out.push_back(static_cast<UInt8>(strtoul(byte.c_str(), &endp, 16)));
+        if (*endp) { return false; }
+    }
+    return true;
+}
+
+static bool parseSection(const std::string &name, PatcherPlus::Section &section) {
+    if (name == "Any") {
+        section = PatcherPlus::Section::Any;
+    } else if (name == "Code") {
+        section = PatcherPlus::Section::Code;
+    } else if (name == "Data") {
+        section = PatcherPlus::Section::Data;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+struct Result {
+    const char *status {"OK"};
+    std::string expected {}, found {}, notes {};
+    UInt64 scanned {0}, nanoseconds {0};
+
+    void note(const std::string &text) { this->notes += (this->notes.empty() ? "" : "; ") + text; }
+
+    void print() const {
+        printf("%s\t%s\t%s\t%llu\t%llu\t%s\n", this->status, this->expected.c_str(), this->found.c_str(),
+            this->scanned, this->nanoseconds, this->notes.c_str());
+    }
+};
+
+static std::string hexOffset(size_t offset) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "0x%zX", offset);
+    return buf;
+}
+
+static size_t countMatches(const Bytes &pattern, const Bytes &mask, PatcherPlus::Section section,
+    const Image &image) {
+    PatcherPlus::Range ranges[PatcherPlus::ImageSections::MaxRanges];
+    auto count = PatcherPlus::getRanges(section, image.address(), image.size, ranges, arrsize(ranges));
+    size_t matches = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t off = 0;
+        while (PatcherPlus::findPattern(pattern.data(), mask.empty() ? nullptr : mask.data(), pattern.size(),
+            image.data + ranges[i].offset, ranges[i].size, &off)) {
+            matches += 1;
+            off += 1;
+        }
+    }
+    return matches;
+}
+
+static void noopRoute() {}
+
+// Address the request resolves to in `image`, by the method the kext would use; 0 if it does not.
+static size_t resolve(KernelPatcher &patcher, bool route, const char *symbol, const Bytes &pattern,
+    const Bytes &mask, PatcherPlus::Section section, const Image &image, PatchMethod &method, UInt64 &scanned) {
+    current = &image;
+    hostTelemetry.clear();
+    mach_vm_address_t address = 0;
+    if (route) {
+        RouteRequestPlus request {symbol, noopRoute, address};
+        request.pattern = pattern.empty() ? nullptr : pattern.data();
+        request.mask = mask.empty() ? nullptr : mask.data();
+        request.patternSize = pattern.size();
+        request.section = section;
+        request.route(patcher, 0, image.address(), image.size);
+    } else {
+        SolveRequestPlus request {symbol, address};
+        request.pattern = pattern.empty() ? nullptr : pattern.data();
+        request.mask = mask.empty() ? nullptr : mask.data();
+        request.patternSize = pattern.size();
+        request.section = section;
+        request.solve(patcher, 0, image.address(), image.size);
+    }
+    patcher.clearError();
+    method = hostTelemetry.empty() ? PatchMethod::Failed : hostTelemetry.back().method;
+    scanned = hostTelemetry.empty() ? 0 : hostTelemetry.back().bytesScanned;
+    return address ? address - image.address() : 0;
+}
+
+static void symbolRequest(KernelPatcher &patcher, bool route, std::istringstream &args) {
+    std::string sectionName, symbol, patternHex, maskHex;
+    Bytes pattern, mask;
+    PatcherPlus::Section section;
+    Result result {.expected = "1"};
+    if (!(args >> sectionName >> symbol >> patternHex >> maskHex) || !parseSection(sectionName, section) ||
+        !parseBytes(patternHex, pattern) || !parseBytes(maskHex, mask) ||
+        (!mask.empty() && mask.size() != pattern.size())) {
+        result.status = "FAIL";
+        result.note("malformed request");
+        result.print();
+        return;
+    }
+
+    PatchMethod method;
+    UInt64 scanned;
+    auto symbolOffset = resolve(patcher, route, symbol.c_str(), {}, {}, section, *full, method, scanned);
+    bool inSymtab = symbolOffset != 0;
+    if (pattern.empty()) {
+        result.found = inSymtab ? "sym" : "0";
+        if (!inSymtab) {
+            result.status = "FAIL";
+            result.note("symbol missing and no pattern");
+        }
+        result.print();
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto patternOffset =
+        resolve(patcher, route, symbol.c_str(), pattern, mask, section, *stripped, method, scanned);
+    result.nanoseconds = static_cast<UInt64>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    result.scanned = scanned;
+    auto matches = countMatches(pattern, mask, section, *stripped);
+    result.found = std::to_string(matches) + (inSymtab ? "+sym" : "");
+    if (!patternOffset) {
+        result.status = inSymtab ? "WARN" : "FAIL";
+        result.note(matches ? "pattern only matches at offset 0, which is rejected" : "pattern not found");
+        result.print();
+        return;
+    }
+    if (matches > 1) {
+        result.status = "WARN";
+        result.note("pattern is ambiguous, first match at " + hexOffset(patternOffset));
+    }
+    if (inSymtab && symbolOffset != patternOffset) {
+        result.status = "WARN";
+        result.note("pattern at " + hexOffset(patternOffset) + ", symbol at " + hexOffset(symbolOffset));
+    }
+    result.print();
+}
+
+static void lookupRequest(KernelPatcher &patcher, std::istringstream &args) {
+    std::string sectionName, findHex, findMaskHex, replaceHex, replaceMaskHex;
+    size_t count, skip;
+    Bytes find, findMask, replace, replaceMask;
+    PatcherPlus::Section section;
+    Result result {};
+    if (!(args >> sectionName >> findHex >> findMaskHex >> replaceHex >> replaceMaskHex >> count >> skip) ||
+        !parseSection(sectionName, section) || !parseBytes(findHex, find) || !parseBytes(findMaskHex, findMask) ||
+        !parseBytes(replaceHex, replace) || !parseBytes(replaceMaskHex, replaceMask) || find.empty() ||
+        replace.size() != find.size() || (!findMask.empty() && findMask.size() != find.size()) ||
+        (!replaceMask.empty() && replaceMask.size() != find.size())) {
+        result.status = "FAIL";
+        result.note("malformed request");
+        result.print();
+        return;
+    }
+
+    auto *findMaskPtr = findMask.empty() ? nullptr : findMask.data();
+    auto *replaceMaskPtr = replaceMask.empty() ? nullptr : replaceMask.data();
+    LookupPatchPlus patch {nullptr, section, find.data(), findMaskPtr, replace.data(), replaceMaskPtr, find.size(),
+        count, skip};
+    bool exact = !findMaskPtr && !replaceMaskPtr && !skip;
+    result.expected = exact ? std::to_string(count) :
+                              ">=1 (count " + std::to_string(count) + ", skip " + std::to_string(skip) + ")";
+
+    hostTelemetry.clear();
+    current = full;
+    auto start = std::chrono::steady_clock::now();
+    bool applied = patch.apply(patcher, full->address(), full->size);
+    result.nanoseconds = static_cast<UInt64>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    patcher.clearError();
+    for (auto &record : hostTelemetry) {
+        result.scanned += record.bytesScanned;
+        if (record.method != PatchMethod::Batch) { result.found = std::to_string(record.matches); }
+    }
+    current = stripped;
+    patch.apply(patcher, stripped->address(), stripped->size);
+    patcher.clearError();
+    if (!applied) { result.status = "FAIL"; }
+    result.print();
+}
+
+static void attributes(std::istringstream &args) {
+    int major, minor;
+    UInt32 deviceID, devRevision, pciRevision;
+    args >> major >> minor >> std::hex >> deviceID >> devRevision >> pciRevision;
+    if (!args) {
+        printf("FAIL\tmalformed attributes command\n");
+        return;
+    }
+    NRedAttributes attributes {};
+    try {
+        attributes.setKernelVersion(static_cast<KernelVersion>(major), minor);
+    } catch (const HostPanic &panic) {
+        printf("FAIL\t%s\n", panic.message);
+        return;
+    }
+    if (!attributes.setDevice(deviceID)) {
+        printf("FAIL\tunsupported device ID 0x%X\n", deviceID);
+        return;
+    }
+    attributes.setRevision(static_cast<UInt16>(devRevision), pciRevision);
+
+    static const struct {
+        const char *name;
+        const bool (NRedAttributes::*get)() const;
+    } getters[] = {
+        {"Catalina", &NRedAttributes::isCatalina},
+        {"BigSurAndLater", &NRedAttributes::isBigSurAndLater},
+        {"Monterey", &NRedAttributes::isMonterey},
+        {"MontereyAndLater", &NRedAttributes::isMontereyAndLater},
+        {"Ventura", &NRedAttributes::isVentura},
+        {"VenturaAndLater", &NRedAttributes::isVenturaAndLater},
+        {"Ventura1304Based", &NRedAttributes::isVentura1304Based},
+        {"Ventura1304AndLater", &NRedAttributes::isVentura1304AndLater},
+        {"Sonoma1404AndLater", &NRedAttributes::isSonoma1404AndLater},
+        {"Raven", &NRedAttributes::isRaven},
+        {"Picasso", &NRedAttributes::isPicasso},
+        {"Raven2", &NRedAttributes::isRaven2},
+        {"Renoir", &NRedAttributes::isRenoir},
+        {"RenoirE", &NRedAttributes::isRenoirE},
+        {"GreenSardine", &NRedAttributes::isGreenSardine},
+    };
+    printf("OK");
+    for (auto &getter : getters) {
+        if ((attributes.*getter.get)()) { printf("\t%s", getter.name); }
+    }
+    printf("\n");
+}
+
+int main() {
+    hostQuiet = true;
+    KernelPatcher::hostSymbols = solveHostSymbol;
+    KernelPatcher patcher;
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::istringstream args(line);
+        std::string command;
+        if (!(args >> command)) { continue; }
+        try {
+            if (command == "attributes") {
+                attributes(args);
+            } else if (command == "kext") {
+                std::string path;
+                std::getline(args >> std::ws, path);
+                const char *error = nullptr;
+                if (!kexts.count(path)) {
+                    Kext kext {};
+                    error = load(path.c_str(), kext.full, false);
+                    if (!error) { error = load(path.c_str(), kext.stripped, true); }
+                    if (!error) { kexts.emplace(path, kext); }
+                }
+                if (error) {
+                    full = stripped = nullptr;
+                    printf("FAIL\t%s\n", error);
+                } else {
+                    full = &kexts[path].full;
+                    stripped = &kexts[path].stripped;
+                    printf("OK\n");
+                }
+            } else if ((command == "solve" || command == "route" || command == "lookup") && !full) {
+                printf("FAIL\t\t\t0\t0\tno kext loaded\n");
+            } else if (command == "solve" || command == "route") {
+                symbolRequest(patcher, command == "route", args);
+            } else if (command == "lookup") {
+                lookupRequest(patcher, args);
+            } else {
+                printf("FAIL\tunknown command %s\n", command.c_str());
+            }
+        } catch (const HostPanic &panic) {
+            Result result {.status = "FAIL"};
+            result.note(std::string("panic: ") + panic.message);
+            result.print();
+        }
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+// Sources: NootedRed/MMIO.cpp
+// Includes: Stubs/MMIO
+//
+// `MMIO::waitForReg32` must return the register once a bit of the mask is set, direct or behind the index/data pair,
+// and give up at its deadline with the last value read, within a backoff step of it. The `NRedSMUSpin`,
+// `NRedSMUBackoff` and `NRedSMUTimeout` boot arguments set the spin window, the longest step and the deadline used
+// when the caller gives none. Also reports how long after the register is set the wait returns, for latencies in the
+// spin window, in the backoff steps and past the point where it sleeps.
+
+#include <IOKit/IOLib.h>
+#include <PrivateHeaders/MMIO.hpp>
+#include <PrivateHeaders/MMIOAccess.hpp>
+#include <algorithm>
+#include <vector>
+
+#define CHECK(cond)                                        \
+    do {                                                   \
+        if (!(cond)) {                                     \
+            printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            return 1;                                      \
+        }                                                  \
+    } while (0)
+
+static constexpr UInt32 DirectReg = 0x16A;
+static constexpr UInt32 IndirectReg = 0x1A000;
+static constexpr UInt32 Ready = 1U << 3;
+
+// Microseconds since `start`.
+static UInt64 since(UInt64 start) { return (mach_absolute_time() - start) / NSEC_PER_USEC; }
+
+static int timeouts() {
+    // A 3 ms deadline, stepping by a microsecond at most, so it never sleeps.
+    hostBootArgs[0] = "NRedSMUSpin=20";
+    hostBootArgs[1] = "NRedSMUBackoff=0";
+    hostBootArgs[2] = "NRedSMUTimeout=3000";
+    MMIO tuned {};
+    tuned.init();
+    tuned.map(hostBAR.slots, HostBAR::DirectRegs);
+    hostBAR.set(DirectReg, ~Ready);
+    const size_t sleeps = hostSleeps;
+    auto start = mach_absolute_time();
+    CHECK(tuned.waitForReg32(DirectReg, Ready) == ~Ready);
+    const auto tunedUs = since(start);
+    CHECK(tunedUs >= 3000 && tunedUs < 3000 + 2000);
+    CHECK(hostSleeps == sleeps);
+
+    // The defaults step up to a millisecond, which sleeps.
+    hostBootArgs[0] = hostBootArgs[1] = hostBootArgs[2] = nullptr;
+    MMIO mmio {};
+    mmio.init();
+    mmio.map(hostBAR.slots, HostBAR::DirectRegs);
+    hostBAR.set(IndirectReg, 0);
+    start = mach_absolute_time();
+    CHECK(mmio.waitForReg32(IndirectReg, Ready, 20000) == 0);
+    const auto defaultUs = since(start);
+    CHECK(defaultUs >= 20000 && defaultUs < 20000 + 1000 + 5000);
+    CHECK(hostSleeps > sleeps);
+    printf("Timeout: %llu us for a 3 ms deadline from the boot arguments, %llu us for 20 ms by default\n", tunedUs,
+        defaultUs);
+    return 0;
+}
+
+static int wakeups() {
+    static constexpr UInt64 Latencies[] = {0, 5, 20, 100, 400, 1500, 5000};
+    MMIO mmio {};
+    mmio.init();
+    mmio.map(hostBAR.slots, HostBAR::DirectRegs);
+
+    printf("Benchmark: wake-up after the register is set, median / max:");
+    for (auto latency : Latencies) {
+        const UInt32 trials = latency < 1000 ? 50 : 10;
+        std::vector<UInt64> wakeups;
+        for (UInt32 trial = 0; trial < trials; trial++) {
+            const auto reg = (trial % 2) ? IndirectReg : DirectReg;
+            hostBAR.setLater(reg, Ready | trial, latency);
+            const UInt64 readyAt = hostBAR.readyAt[reg];
+            CHECK(mmio.waitForReg32(reg, Ready, 100000) == (Ready | trial));
+            wakeups.push_back(since(readyAt));
+        }
+        std::sort(wakeups.begin(), wakeups.end());
+        const auto median = wakeups[wakeups.size() / 2], max = wakeups.back();
+        printf(" %llu us: %llu / %llu us;", latency, median, max);
+        // Spinning notices within a few microseconds; a backoff step or sleep is at most a millisecond, plus wake-up.
+        CHECK(latency > 20 || median < 50);
+        CHECK(median < 1000 + 1000);
+    }
+    printf("\n");
+    return 0;
+}
+
+int main() {
+    hostQuiet = true;
+    return timeouts() | wakeups();
+}
@@ -0,0 +1,876 @@
+#!/usr/bin/python3
+
+# Copyright © 2025 ChefKiss. Licensed under the Thou Shalt Not Profit License version 1.5.
+# See LICENSE for details.
+
+# Checks every solve, route and lookup request of the modules against a set of kext binaries, without booting them.
+#
+# The requests are read from the sources: pattern arrays, request initialisers and the `if` conditions around them,
+# in the order NRed registers the modules in. The conditions are evaluated with the attributes `NRedAttributes`
+# derives for the given kernel version and device, and the requests are run against the kexts by
+# HostTests/Tools/PatchMatcher, which is built from PatcherPlus.cpp, so both follow the kext's own code.
+#
+# A request fails if it does not apply, and so does one that cannot be checked: an unknown or missing target kext, an
+# argument or condition that cannot be evaluated. A run that checks no request fails as well.
+#
+# Usage: ValidatePatches.py -k 23.4 -a renoir -d <directory with the kext binaries> [-b <boot args>] [-s <source root>]
+#        [-v]
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+KERNEL_VERSIONS = {
+    "Catalina": 19,
+    "BigSur": 20,
+    "Monterey": 21,
+    "Ventura": 22,
+    "Sonoma": 23,
+    "Sequoia": 24,
+}
+
+# The device ID, device revision and PCI revision of each ASIC, as `NRed` reads them.
+DEVICES = {
+    "raven": (0x15DD, 0x0, 0x0),
+    "picasso": (0x15D8, 0x0, 0x0),
+    "raven2": (0x15DD, 0x8, 0x0),
+    "renoir": (0x1636, 0x0, 0x0),
+    "renoir-e": (0x1636, 0x0, 0x80),
+    "green-sardine": (0x1638, 0x0, 0x0),
+}
+
+SECTION_ANY, SECTION_CODE, SECTION_DATA = "Any", "Code", "Data"
+
+
+class Unknown(Exception):
+    pass
+
+
+#------ Expressions ------#
+
+
+TOKEN_RE = re.compile(
+    r"\s*(?:(0[xX][0-9A-Fa-f]+|\d+)[uUlL]*|(@?[A-Za-z_][A-Za-z_0-9]*(?:::[A-Za-z_][A-Za-z_0-9]*)*)|"
+    r"(<<|>>|==|!=|<=|>=|&&|\|\||[-+*/%&|^~!?:()<>,]))"
+)
+
+BINARY_OPS = [
+    ["||"],
+    ["&&"],
+    ["|"],
+    ["^"],
+    ["&"],
+    ["==", "!="],
+    ["<", ">", "<=", ">="],
+    ["<<", ">>"],
+    ["+", "-"],
+    ["*", "/", "%"],
+]
+
+
+class ArrayRef:
+    def __init__(self, name):
+        self.name = name
+
+
+class Evaluator:
+    def __init__(self, constants, attrs, major, minor, boot_args=()):
+        self.constants = constants
+        self.attrs = attrs
+        self.major = major
+        self.minor = minor
+        self.boot_args = set(boot_args)
+
+    def evaluate(self, text, locals_={}):
+        text = re.sub(r"NRed::singleton\(\)\.getAttributes\(\)\.is(\w+)\(\)", r"@attr_\1", text)
+        text = re.sub(r"getKernelVersion\(\)", "@kernel", text)
+        text = re.sub(r"getKernelMinorVersion\(\)", "@minor", text)
+        text = re.sub(
+            r'checkKernelArgument\("([^"]*)"\)', lambda m: "true" if m.group(1) in self.boot_args else "false", text
+        )
+        # A route in a condition is a request of its own, checked where it is declared; the branch is the one taken
+        # when it succeeds.
+        text = re.sub(r"patcher\.routeMultiple\([^()]*\)", "true", text)
+        text = re.sub(r"static_cast<[^>]*>", "", text)
+        self.tokens = []
+        pos = 0
+        while pos < len(text):
+            m = TOKEN_RE.match(text, pos)
+            if not m or m.end() == pos:
+                if text[pos:].strip() == "":
+                    break
+                raise Unknown(text)
+            self.tokens.append(m.group(1) or m.group(2) or m.group(3))
+            pos = m.end()
+        self.pos = 0
+        self.locals = locals_
+        value = self.ternary()
+        if self.pos != len(self.tokens):
+            raise Unknown(text)
+        return value
+
+    def peek(self):
+        return self.tokens[self.pos] if self.pos < len(self.tokens) else None
+
+    def take(self, expected=None):
+        token = self.peek()
+        if token is None or (expected and token != expected):
+            raise Unknown(expected)
+        self.pos += 1
+        return token
+
+    def ternary(self):
+        cond = self.binary(0)
+        if self.peek() != "?":
+            return cond
+        self.take("?")
+        lhs = self.ternary()
+        self.take(":")
+        rhs = self.ternary()
+        if isinstance(cond, ArrayRef):
+            raise Unknown("array condition")
+        return lhs if cond else rhs
+
+    def binary(self, level):
+        if level == len(BINARY_OPS):
+            return self.unary()
+        lhs = self.binary(level + 1)
+        while self.peek() in BINARY_OPS[level]:
+            op = self.take()
+            # Short-circuit, so that an unknown operand does not matter when the other one decides.
+            if op in ("&&", "||"):
+                try:
+                    lhs_value = bool(lhs)
+                except Unknown:
+                    lhs_value = None
+                try:
+                    rhs = self.binary(level + 1)
+                except Unknown:
+                    if (op == "&&" and lhs_value is False) or (op == "||" and lhs_value is True):
+                        self.skip_operand(level + 1)
+                        continue
+                    raise
+                lhs = (bool(lhs) and bool(rhs)) if op == "&&" else (bool(lhs) or bool(rhs))
+                continue
+            rhs = self.binary(level + 1)
+            lhs = {
+                "|": lambda a, b: a | b,
+                "^": lambda a, b: a ^ b,
+                "&": lambda a, b: a & b,
+                "==": lambda a, b: a == b,
+                "!=": lambda a, b: a != b,
+                "<": lambda a, b: a < b,
+                ">": lambda a, b: a > b,
+                "<=": lambda a, b: a <= b,
+                ">=": lambda a, b: a >= b,
+                "<<": lambda a, b: a << b,
+                ">>": lambda a, b: a >> b,
+                "+": lambda a, b: a + b,
+                "-": lambda a, b: a - b,
+                "*": lambda a, b: a * b,
+                "/": lambda a, b: a // b,
+                "%": lambda a, b: a % b,
+            }[op](lhs, rhs)
+        return lhs
+
+    def skip_operand(self, level):
+        depth = 0
+        while self.peek() is not None:
+            token = self.peek()
+            if token == "(":
+                depth += 1
+            elif token == ")":
+                if depth == 0:
+                    return
+                depth -= 1
+            elif depth == 0 and token in ("&&", "||", "?", ":"):
+                return
+            self.pos += 1
+
+    def unary(self):
+        token = self.peek()
+        if token in ("!", "~", "-", "+", "&"):
+            self.take()
+            value = self.unary()
+            if token == "&":
+                return value
+            if isinstance(value, ArrayRef):
+                raise Unknown("array operand")
+            return {"!": lambda v: not v, "~": lambda v: ~v & 0xFFFFFFFF, "-": lambda v: -v, "+": lambda v: v}[
+                token
+            ](value)
+        return self.primary()
+
+    def primary(self):
+        token = self.take()
+        if token == "(":
+            value = self.ternary()
+            self.take(")")
+            return value
+        if token[0].isdigit():
+            return int(token, 0)
+        if token.startswith("@attr_"):
+            return token[6:] in self.attrs
+        if token == "@kernel":
+            return self.major
+        if token == "@minor":
+            return self.minor
+        if token.startswith("KernelVersion::"):
+            return KERNEL_VERSIONS[token.split("::")[1]]
+        if token in ("true", "false"):
+            return token == "true"
+        if token in self.locals:
+            return self.locals[token]
+        if token in self.constants.arrays:
+            return ArrayRef(token)
+        if token in self.constants.values:
+            return self.evaluate_constant(token)
+        raise Unknown(token)
+
+    def evaluate_constant(self, name):
+        saved = (self.tokens, self.pos, self.locals)
+        try:
+            return Evaluator(self.constants, self.attrs, self.major, self.minor, self.boot_args).evaluate(
+                self.constants.values[name]
+            )
+        finally:
+            self.tokens, self.pos, self.locals = saved
+
+
+#------ Sources ------#
+
+
+def strip_comments(text):
+    out = []
+    i = 0
+    while i < len(text):
+        c = text[i]
+        if c in "\"'":
+            j = i + 1
+            while j < len(text) and text[j] != c:
+                j += 2 if text[j] == "\\" else 1
+            out.append(text[i : j + 1])
+            i = j + 1
+        elif text.startswith("//", i):
+            j = text.find("\n", i)
+            i = len(text) if j < 0 else j
+        elif text.startswith("/*", i):
+            j = text.find("*/", i + 2)
+            out.append(" ")
+            i = len(text) if j < 0 else j + 2
+        else:
+            out.append(c)
+            i += 1
+    return "".join(out)
+
+
+def parse_c_string(literal):
+    data = bytearray()
+    body = literal[1:-1]
+    i = 0
+    escapes = {"n": 0xA, "t": 0x9, "r": 0xD, "0": 0x0, "a": 0x7, "b": 0x8, "f": 0xC, "v": 0xB}
+    while i < len(body):
+        if body[i] != "\\":
+            data.append(ord(body[i]))
+            i += 1
+            continue
+        c = body[i + 1]
+        if c == "x":
+            m = re.match(r"[0-9A-Fa-f]+", body[i + 2 :])
+            data.append(int(m.group(0), 16) & 0xFF)
+            i += 2 + len(m.group(0))
+        elif c in escapes:
+            data.append(escapes[c])
+            i += 2
+        else:
+            data.append(ord(c))
+            i += 2
+    return bytes(data)
+
+
+def concat_strings(text):
+    return b"".join(parse_c_string(s) for s in re.findall(r'"(?:[^"\\]|\\.)*"', text))
+
+
+class Constants:
+    def __init__(self):
+        self.arrays = {}
+        self.values = {}
+
+    def scan(self, text):
+        for m in re.finditer(r"static\s+const\s+UInt8\s+(\w+)\s*\[\s*\]\s*=?\s*\{([^}]*)\}", text):
+            self.arrays[m.group(1)] = bytes(int(v, 0) for v in re.findall(r"0[xX][0-9A-Fa-f]+|\d+", m.group(2)))
+        for m in re.finditer(r"static\s+const\s+UInt8\s+(\w+)\s*\[\s*\]\s*=\s*((?:\"(?:[^\"\\]|\\.)*\"\s*)+);", text):
+            self.arrays[m.group(1)] = concat_strings(m.group(2)) + b"\0"
+        for m in re.finditer(r"constexpr\s+(?:UInt\d+|SInt\d+|int|unsigned|size_t)\s+(\w+)\s*=\s*([^;{]+);", text):
+            self.values[m.group(1)] = m.group(2)
+        for m in re.finditer(r"^\s*#define\s+(\w+)\s+(\(?[-0-9xXA-Fa-f]+[uUlL]*\)?)\s*$", text, re.M):
+            self.values.setdefault(m.group(1), m.group(2))
+
+
+def match_brace(text, i, open_c="{", close_c="}"):
+    depth = 0
+    j = i
+    while j < len(text):
+        c = text[j]
+        if c in "\"'":
+            k = j + 1
+            while text[k] != c:
+                k += 2 if text[k] == "\\" else 1
+            j = k
+        elif c == open_c:
+            depth += 1
+        elif c == close_c:
+            depth -= 1
+            if depth == 0:
+                return j
+        j += 1
+    raise ValueError("Unbalanced braces")
+
+
+def split_top_level(text, sep=","):
+    parts = []
+    depth = 0
+    start = 0
+    i = 0
+    while i < len(text):
+        c = text[i]
+        if c in "\"'":
+            k = i + 1
+            while text[k] != c:
+                k += 2 if text[k] == "\\" else 1
+            i = k
+        elif c in "([{":
+            depth += 1
+        elif c in ")]}":
+            depth -= 1
+        elif c == sep and depth == 0:
+            parts.append(text[start:i].strip())
+            start = i + 1
+        i += 1
+    if text[start:].strip():
+        parts.append(text[start:].strip())
+    return parts
+
+
+class Request:
+    def __init__(self, kind, module, line, kext, condition, args, locals_):
+        self.kind = kind
+        self.module = module
+        self.line = line
+        self.kext = kext
+        self.condition = condition
+        self.args = args
+        self.locals = locals_
+
+
+class SourceFile:
+    def __init__(self, path, constants):
+        with open(path, encoding="utf-8") as f:
+            raw = f.read()
+        self.path = path
+        self.text = strip_comments(raw)
+        self.constants = constants
+        self.kexts = {}
+        self.functions = {}
+
+        paths = {}
+        for m in re.finditer(r"static\s+const\s+char\s*\*\s*(\w+)\s*=\s*((?:\"(?:[^\"\\]|\\.)*\"\s*)+);", self.text):
+            paths[m.group(1)] = concat_strings(m.group(2)).decode()
+        for m in re.finditer(r"KernelPatcher::KextInfo\s+(\w+)\s*=?\s*\{\s*\"[^\"]*\"\s*,\s*&(\w+)", self.text):
+            self.kexts[m.group(1)] = os.path.basename(paths[m.group(2)])
+        for m in re.finditer(r"\n(?:void|bool|static\s+void)\s+([\w:]+)\s*\([^)]*\)\s*(?:const\s*)?\{", self.text):
+            start = m.end() - 1
+            end = match_brace(self.text, start)
+            self.functions[m.group(1).split("::")[-1]] = (start + 1, end, m.group(1))
+
+    def line_of(self, pos):
+        return self.text.count("\n", 0, pos) + 1
+
+
+# Walks the body of a function, collecting requests together with the kext and condition they are under.
+class Walker:
+    def __init__(self, source, evaluator, module):
+        self.source = source
+        self.text = source.text
+        self.evaluator = evaluator
+        self.module = module
+        self.requests = []
+        self.visited = set()
+
+    def walk_function(self, name, kext, condition):
+        if name not in self.source.functions or name in self.visited:
+            return
+        self.visited.add(name)
+        start, end, _ = self.source.functions[name]
+        self.walk_block(start, end, kext, condition, {})
+
+    def eval_condition(self, text, locals_):
+        try:
+            return bool(self.evaluator.evaluate(text, locals_))
+        except (Unknown, KeyError, TypeError, ZeroDivisionError):
+            return None
+
+    def skip_ws(self, i, end):
+        while i < end and self.text[i].isspace():
+            i += 1
+        return i
+
+    def statement_end(self, i, end):
+        depth = 0
+        while i < end:
+            c = self.text[i]
+            if c in "\"'":
+                k = i + 1
+                while self.text[k] != c:
+                    k += 2 if self.text[k] == "\\" else 1
+                i = k
+            elif c in "([{":
+                depth += 1
+            elif c in ")]}":
+                depth -= 1
+            elif c == ";" and depth == 0:
+                return i
+            i += 1
+        return end
+
+    def body_range(self, i, end):
+        i = self.skip_ws(i, end)
+        if self.text[i] == "{":
+            close = match_brace(self.text, i)
+            return i + 1, close, close + 1
+        stmt_end = self.statement_end(i, end)
+        return i, stmt_end + 1, stmt_end + 1
+
+    def walk_block(self, i, end, kext, condition, locals_):
+        locals_ = dict(locals_)
+        while True:
+            i = self.skip_ws(i, end)
+            if i >= end:
+                return
+            word = re.match(r"[A-Za-z_]\w*", self.text[i:end])
+            word = word.group(0) if word else ""
+            if word == "if":
+                i, kext, condition = self.walk_if(i, end, kext, condition, locals_)
+            elif word in ("for", "while", "switch"):
+                paren = self.text.index("(", i)
+                close = match_brace(self.text, paren, "(", ")")
+                body_start, body_end, i = self.body_range(close + 1, end)
+                self.walk_block(body_start, body_end, kext, None, locals_)
+            elif word == "do":
+                body_start, body_end, i = self.body_range(i + 2, end)
+                self.walk_block(body_start, body_end, kext, None, locals_)
+                i = self.statement_end(i, end) + 1
+            elif word == "else":
+                # Stray else, handled by walk_if.
+                i += 4
+            elif self.text[i] == "{":
+                close = match_brace(self.text, i)
+                self.walk_block(i + 1, close, kext, condition, locals_)
+                i = close + 1
+            else:
+                stmt_end = self.statement_end(i, end)
+                self.statement(i, self.text[i:stmt_end], kext, condition, locals_)
+                i = stmt_end + 1
+
+    def walk_if(self, i, end, kext, condition, locals_):
+        taken = False    # Whether an earlier branch is known to be taken.
+        previous = []    # Conditions of the earlier branches.
+        returns = []
+        while True:
+            paren = self.text.index("(", i)
+            close = match_brace(self.text, paren, "(", ")")
+            cond_text = self.text[paren + 1 : close]
+            body_start, body_end, i = self.body_range(close + 1, end)
+
+            # `kext.loadIndex == id` selects the kext the branch patches, it is not a condition.
+            kext_match = re.fullmatch(r"\s*(\w+)\.loadIndex\s*(==|!=)\s*id\s*", cond_text)
+            body = self.text[body_start:body_end].strip()
+            if kext_match:
+                if body == "return;":
+                    returns.append((kext_match, None))
+                elif kext_match.group(2) == "==" and not taken:
+                    self.walk_block(body_start, body_end, kext_match.group(1), combine(condition, True, previous),
+                        locals_)
+            else:
+                value = self.eval_condition(cond_text, locals_)
+                branch = combine(condition, value, previous)
+                previous.append(value)
+                if body == "return;":
+                    returns.append((None, value))
+                if not taken and branch is not False:
+                    self.walk_block(body_start, body_end, kext, branch, locals_)
+                taken = taken or branch is True
+
+            j = self.skip_ws(i, end)
+            if not self.text.startswith("else", j):
+                break
+            j = self.skip_ws(j + 4, end)
+            if self.text.startswith("if", j) and not (self.text[j + 2].isalnum() or self.text[j + 2] == "_"):
+                i = j
+                continue
+            body_start, body_end, i = self.body_range(j, end)
+            branch = combine(condition, True, previous)
+            if not taken and branch is not False:
+                self.walk_block(body_start, body_end, kext, branch, locals_)
+            break
+
+        # `if (x) { return; }` makes the rest of the block conditional on `!x`.
+        for kext_match, value in returns:
+            if kext_match and kext_match.group(2) == "!=":
+                kext = kext_match.group(1)
+            elif len(returns) == 1 and len(previous) == 1:
+                condition = combine(condition, None if value is None else not value, [])
+        return i, kext, condition
+
+    def statement(self, pos, stmt, kext, condition, locals_):
+        if condition is False:
+            return
+        m = re.match(
+            r"(?:const\s+)?(?:KernelPatcher::)?"
+            r"(SolveRequestPlus|RouteRequestPlus|LookupPatchPlus|SolveRequest|RouteRequest)"
+            r"\s+(\w+)\s*(\[\s*\])?\s*=?\s*\{",
+            stmt,
+        )
+        if m:
+            kind = m.group(1)
+            brace = m.end() - 1
+            body = stmt[brace + 1 : match_brace(stmt, brace)]
+            entries = []
+            if m.group(3):
+                for entry in split_top_level(body):
+                    entries.append((entry.strip()[1:-1], stmt.find(entry)))
+            else:
+                entries.append((body, 0))
+            for entry, offset in entries:
+                line = self.source.line_of(pos + max(offset, 0))
+                self.requests.append(
+                    Request(kind, self.module, line, kext, condition, split_top_level(entry), dict(locals_))
+                )
+            return
+
+        # Local scalars used as patch bytes, e.g. `UInt32 find = X, repl = Y;`.
+        m = re.match(r"(?:const\s+)?(UInt8|UInt16|UInt32|UInt64)\s+(.*)$", stmt, re.S)
+        if m:
+            size = {"UInt8": 1, "UInt16": 2, "UInt32": 4, "UInt64": 8}[m.group(1)]
+            for decl in split_top_level(m.group(2)):
+                if "=" not in decl:
+                    continue
+                name, value = decl.split("=", 1)
+                try:
+                    number = self.evaluator.evaluate(value, locals_)
+                    locals_[name.strip()] = ScalarBytes(int(number), size)
+                except (Unknown, TypeError, KeyError):
+                    pass
+            return
+
+        for call in re.finditer(r"(?:this->)?(\w+)\s*\(\s*patcher\s*,", stmt):
+            self.walk_function(call.group(1), kext, condition)
+
+
+class ScalarBytes(int):
+    def __new__(cls, value, size):
+        obj = int.__new__(cls, value)
+        obj.size = size
+        return obj
+
+    def to_bytes_le(self):
+        return (int(self) & ((1 << (8 * self.size)) - 1)).to_bytes(self.size, "little")
+
+
+def combine(outer, value, previous):
+    if outer is False or value is False or any(p is True for p in previous):
+        return False
+    if outer is None or value is None or any(p is None for p in previous):
+        return None
+    return True
+
+
+#------ Matcher ------#
+
+
+class Matcher:
+    def __init__(self):
+        run = os.path.join(os.path.dirname(os.path.abspath(__file__)), "HostTests", "Run.sh")
+        built = subprocess.run([run, "--build", "Tools/PatchMatcher"], stdout=subprocess.PIPE, text=True)
+        if built.returncode != 0:
+            raise RuntimeError("Failed to build PatchMatcher")
+        self.process = subprocess.Popen(
+            [built.stdout.strip()], stdin=subprocess.PIPE, stdout=subprocess.PIPE, text=True
+        )
+
+    def query(self, *args):
+        self.process.stdin.write(" ".join(str(arg) for arg in args) + "\n")
+        self.process.stdin.flush()
+        line = self.process.stdout.readline()
+        if not line:
+            raise RuntimeError("PatchMatcher exited")
+        return line.rstrip("\n").split("\t")
+
+    def close(self):
+        self.process.stdin.close()
+        self.process.wait()
+
+
+def hex_or_none(data):
+    return "-" if data is None else data.hex()
+
+
+#------ Requests ------#
+
+
+class Result:
+    def __init__(self, request, name):
+        self.request = request
+        self.name = name
+        self.expected = ""
+        self.found = ""
+        self.scanned = 0
+        self.elapsed = 0.0
+        self.status = "OK"
+        self.notes = []
+
+
+def resolve_bytes(evaluator, arg, locals_):
+    arg = arg.strip()
+    m = re.fullmatch(r"reinterpret_cast<const UInt8\s*\*>\(&(\w+)\)", arg)
+    if m:
+        return locals_[m.group(1)].to_bytes_le(), m.group(1)
+    value = evaluator.evaluate(arg, locals_)
+    if isinstance(value, ArrayRef):
+        return evaluator.constants.arrays[value.name], value.name
+    raise Unknown(arg)
+
+
+def apply_result(result, fields):
+    result.status = fields[0]
+    if len(fields) < 6:
+        result.notes.append(fields[1] if len(fields) > 1 else "no result")
+        return
+    result.expected, result.found = fields[1], fields[2]
+    result.scanned, result.elapsed = int(fields[3]), int(fields[4]) / 1e9
+    result.notes += [note for note in fields[5].split("; ") if note]
+
+
+def run_symbol_request(matcher, request, evaluator, result):
+    args = request.args
+    symbol = concat_strings(args[0]).decode()
+    result.name = symbol
+    arrays = []
+    section = SECTION_ANY if request.kind == "SolveRequestPlus" else SECTION_CODE
+    for arg in args[1:]:
+        if arg.startswith("PatcherPlus::Section::"):
+            section = arg.split("::")[-1]
+            continue
+        try:
+            arrays.append(resolve_bytes(evaluator, arg, request.locals)[0])
+        except (Unknown, KeyError, TypeError, AttributeError):
+            # The wrapper or where the result goes; a pattern that cannot be evaluated must not pass for one.
+            if any(name in evaluator.constants.arrays for name in re.findall(r"\w+", arg)):
+                raise Unknown(arg)
+    if len(arrays) > 2:
+        raise Unknown("symbol request arguments")
+    pattern = arrays[0] if arrays else None
+    mask = arrays[1] if len(arrays) > 1 else None
+    kind = "solve" if request.kind.startswith("Solve") else "route"
+    apply_result(result, matcher.query(kind, section, symbol, hex_or_none(pattern), hex_or_none(mask)))
+
+
+def run_lookup_request(matcher, request, evaluator, result):
+    args = request.args[1:]
+    section = SECTION_CODE
+    if args and args[0].startswith("PatcherPlus::Section::"):
+        section = args[0].split("::")[-1]
+        args = args[1:]
+    arrays = []
+    names = []
+    while args:
+        try:
+            data, name = resolve_bytes(evaluator, args[0], request.locals)
+        except (Unknown, KeyError, TypeError, AttributeError):
+            break
+        arrays.append(data)
+        names.append(name)
+        args = args[1:]
+    # The pointer constructors take the size before the count.
+    if args and args[0].startswith(("sizeof", "arrsize")):
+        args = args[1:]
+    numbers = [evaluator.evaluate(arg, request.locals) for arg in args]
+    result.name = names[0] if names else ""
+    if len(arrays) == 2:
+        find, find_mask, replace, replace_mask = arrays[0], None, arrays[1], None
+    elif len(arrays) == 3:
+        find, find_mask, replace, replace_mask = arrays[0], arrays[1], arrays[2], None
+    elif len(arrays) == 4:
+        find, find_mask, replace, replace_mask = arrays
+    else:
+        raise Unknown("lookup patch arguments")
+    if not numbers or len(numbers) > 2:
+        raise Unknown("lookup patch count")
+    count = int(numbers[0])
+    skip = int(numbers[1]) if len(numbers) > 1 else 0
+    apply_result(
+        result,
+        matcher.query(
+            "lookup", section, find.hex(), hex_or_none(find_mask), replace.hex(), hex_or_none(replace_mask), count,
+            skip
+        ),
+    )
+
+
+#------ Driver ------#
+
+
+def module_order(source_root):
+    with open(os.path.join(source_root, "NRed.cpp"), encoding="utf-8") as f:
+        text = strip_comments(f.read())
+    init = text[text.index("void NRed::init()") :]
+    return re.findall(r"([\w:]+)::singleton\(\)\.init\(\);", init[: match_brace(init, init.index("{"))])
+
+
+def find_binary(directory, name):
+    for root, _, files in os.walk(directory):
+        if name in files:
+            return os.path.join(root, name)
+    return None
+
+
+def parse_device(text):
+    if text in DEVICES:
+        return DEVICES[text]
+    parts = text.split(":")
+    if len(parts) != 3:
+        raise argparse.ArgumentTypeError(f"expected one of {', '.join(DEVICES)} or <device>:<revision>:<PCI revision>")
+    return tuple(int(part, 16) for part in parts)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Validate the patch requests against kext binaries.")
+    parser.add_argument("-k", "--kernel", required=True, help="Darwin version, e.g. 23.4")
+    parser.add_argument(
+        "-a", "--asic", required=True, type=parse_device,
+        help=f"{', '.join(DEVICES)}, or the device ID, device revision and PCI revision in hex, e.g. 1636:0:C1",
+    )
+    parser.add_argument("-d", "--kexts", required=True, help="Directory containing the kext binaries")
+    parser.add_argument("-b", "--boot-args", default="", help="Boot arguments, for the requests that depend on them")
+    parser.add_argument("-s", "--sources", default=os.path.join(os.path.dirname(__file__), "..", "NootedRed"))
+    parser.add_argument("-v", "--verbose", action="store_true", help="Also list requests that passed")
+    args = parser.parse_args()
+
+    major, _, minor = args.kernel.partition(".")
+    major, minor = int(major), int(minor or 0)
+    matcher = Matcher()
+    attrs = matcher.query("attributes", major, minor, *(f"{value:X}" for value in args.asic))
+    if attrs[0] != "OK":
+        print(f"Failed to derive the attributes: {attrs[1]}", file=sys.stderr)
+        return 1
+    attrs = set(attrs[1:])
+
+    constants = Constants()
+    sources = []
+    for root, _, files in os.walk(args.sources):
+        for file in sorted(files):
+            if file.endswith((".cpp", ".hpp")):
+                path = os.path.join(root, file)
+                with open(path, encoding="utf-8") as f:
+                    constants.scan(strip_comments(f.read()))
+                if file.endswith(".cpp"):
+                    sources.append(path)
+    evaluator = Evaluator(constants, attrs, major, minor, args.boot_args.split())
+
+    # Modules without a processKext do not patch anything.
+    parsed = [SourceFile(path, constants) for path in sources]
+    requests = []
+    kext_binaries = {}
+    for module in module_order(args.sources):
+        for source in parsed:
+            entry = source.functions.get("processKext")
+            if not entry or entry[2] != f"{module}::processKext":
+                continue
+            kext_binaries.update(source.kexts)
+            walker = Walker(source, evaluator, os.path.relpath(source.path, args.sources))
+            walker.walk_function("processKext", None, True)
+            requests += walker.requests
+            break
+
+    paths = {}
+    current = None
+    results = []
+    for request in requests:
+        if request.kind == "LookupPatchPlus":
+            name = next((arg for arg in request.args[1:] if not arg.startswith("PatcherPlus::")), "")
+        else:
+            name = concat_strings(request.args[0]).decode()
+        result = Result(request, name)
+        results.append(result)
+        kext = request.kext
+        if request.kind == "LookupPatchPlus":
+            kext = request.args[0].lstrip("&").strip()
+        binary_name = kext_binaries.get(kext)
+        if binary_name is None:
+            result.status = "FAIL"
+            result.notes.append("unknown target kext")
+            continue
+        if binary_name not in paths:
+            paths[binary_name] = find_binary(args.kexts, binary_name)
+        path = paths[binary_name]
+        result.kext = binary_name
+        if path is None:
+            result.status = "FAIL"
+            result.notes.append(f"{binary_name} not found")
+            continue
+        # The matcher keeps each kext it loaded, so lookup patches apply on top of the earlier ones like on boot.
+        if current != binary_name:
+            status = matcher.query("kext", path)
+            if status[0] != "OK":
+                current = None
+                result.status = "FAIL"
+                result.notes.append(f"{binary_name}: {status[1]}")
+                continue
+            current = binary_name
+
+        try:
+            if request.kind == "LookupPatchPlus":
+                run_lookup_request(matcher, request, evaluator, result)
+            else:
+                run_symbol_request(matcher, request, evaluator, result)
+        except (Unknown, KeyError, TypeError, IndexError, ValueError) as e:
+            result.status = "FAIL"
+            result.notes.append(f"could not evaluate request ({e})")
+        if request.condition is None:
+            result.notes.append("under a condition that could not be evaluated")
+            result.status = "FAIL"
+    matcher.close()
+
+    failures = 0
+    total_scanned = 0
+    total_time = 0.0
+    print(f"{'Status':<6} {'Location':<28} {'Request':<56} {'Expected':>10} {'Found':>8} {'Scanned':>10} {'ms':>8}")
+    for result in results:
+        total_scanned += result.scanned
+        total_time += result.elapsed
+        failures += result.status == "FAIL"
+        if result.status == "OK" and not args.verbose:
+            continue
+        location = f"{result.request.module}:{result.request.line}"
+        name = result.name if len(result.name) <= 56 else "..." + result.name[-53:]
+        print(
+            f"{result.status:<6} {location:<28} {name:<56} {result.expected:>10} {result.found:>8} "
+            f"{result.scanned:>10} {result.elapsed * 1000:>8.2f}"
+        )
+        for note in result.notes:
+            print(f"{'':<6} {'':<28} {note}")
+
+    print(
+        f"\n{len(results)} requests, {failures} failed, {total_scanned} bytes scanned in {total_time * 1000:.2f} ms"
+    )
+    if not results:
+        print("No request was checked", file=sys.stderr)
+        return 1
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())